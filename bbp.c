@@ -0,0 +1,142 @@
+/* Extração de dígitos hexadecimais de PI (ver bbp.h) */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "bbp.h"
+#include "topologia.h"
+
+#define BBP_BITS 64 // Bits do ponto fixo das somas
+
+/* 2^e mod m por exponenciação binária (produtos de 128 bits, m pode passar de 2^32) */
+static uint64_t bbp_pot2_mod(uint64_t e, uint64_t m){
+	unsigned __int128 r = 1 % m, b = 2 % m;
+	while(e > 0){
+		if(e & 1)
+			r = (r*b) % m;
+		b = (b*b) % m;
+		e >>= 1;
+	}
+	return (uint64_t)r;
+}
+
+/* Parte fracionária de 2^e/m em ponto fixo de 64 bits (truncada), para qualquer expoente e */
+static uint64_t bbp_fracao(int64_t e, uint64_t m){
+	if(e >= 0)
+		return (uint64_t)(((unsigned __int128)bbp_pot2_mod((uint64_t)e, m) << BBP_BITS)/m);
+	if(e > -BBP_BITS)
+		return (uint64_t)(((unsigned __int128)1 << (BBP_BITS + e))/m);
+	return 0; // Abaixo da precisão do ponto fixo
+}
+
+/* Termo k da soma de 2^n * PI (n = 4*posicao), módulo 1 */
+static uint64_t bbp_termo(bbp_formula_t formula, int64_t n, uint64_t k){
+	uint64_t t;
+
+	if(formula == BBP_BBP){
+		int64_t e = n - 4*(int64_t)k; // 16^(d-k)
+		t = bbp_fracao(e + 2, 8*k + 1) // 4/(8k+1)
+		  - bbp_fracao(e + 1, 8*k + 4) // 2/(8k+4)
+		  - bbp_fracao(e, 8*k + 5)
+		  - bbp_fracao(e, 8*k + 6);
+		return t;
+	}
+
+	int64_t e = n - 6 - 10*(int64_t)k; // 1024^-k / 64
+	t = bbp_fracao(e + 8, 10*k + 1) // 256/(10k+1)
+	  - bbp_fracao(e + 5, 4*k + 1) // 32/(4k+1)
+	  - bbp_fracao(e, 4*k + 3)
+	  - bbp_fracao(e + 6, 10*k + 3) // 64/(10k+3)
+	  - bbp_fracao(e + 2, 10*k + 5) // 4/(10k+5)
+	  - bbp_fracao(e + 2, 10*k + 7)
+	  + bbp_fracao(e, 10*k + 9);
+	return (k & 1) ? (uint64_t)0 - t : t; // (-1)^k
+}
+
+/* Quantidade de termos até que todos fiquem abaixo da precisão do ponto fixo */
+uint64_t bbp_num_termos(bbp_formula_t formula, uint64_t posicao){
+	int64_t n = 4*(int64_t)posicao;
+	if(formula == BBP_BBP)
+		return (uint64_t)((n + 2 + BBP_BITS)/4) + 1;
+	return (uint64_t)((n + 2 + BBP_BITS)/10) + 1;
+}
+
+/* Intervalo de termos de uma thread */
+typedef struct{
+	pthread_t thread;
+	int criada; // 0 se a thread não pôde ser criada (o intervalo é somado pela thread atual)
+	int posicao; // Posição da thread (topo_fixar)
+	bbp_formula_t formula;
+	int64_t n;
+	uint64_t k_ini, k_fim;
+	uint64_t soma;
+} bbp_tarefa_t;
+
+static void *bbp_trabalhador(void *arg){
+	bbp_tarefa_t *t = (bbp_tarefa_t *)arg;
+	uint64_t soma = 0;
+	for(uint64_t k=t->k_ini; k<t->k_fim; k++)
+		soma += bbp_termo(t->formula, t->n, k); // Transbordo = parte inteira descartada
+	t->soma = soma;
+	return NULL;
+}
+
+/* Thread criada: fixada conforme a política de topologia.h (a thread atual nunca é fixada) */
+static void *bbp_thread(void *arg){
+	topo_fixar(((bbp_tarefa_t *)arg)->posicao);
+	return bbp_trabalhador(arg);
+}
+
+/* Soma dos termos [k_ini, k_fim) em ponto fixo (módulo 1), dividida entre n_threads threads */
+uint64_t bbp_soma(bbp_formula_t formula, uint64_t posicao, uint64_t k_ini, uint64_t k_fim, int n_threads){
+	bbp_tarefa_t unica, *tarefas = &unica;
+	uint64_t soma = 0;
+
+	if(n_threads > 1)
+		tarefas = (bbp_tarefa_t *)calloc(n_threads, sizeof(bbp_tarefa_t));
+	if(n_threads < 1 || !tarefas){
+		n_threads = 1;
+		tarefas = &unica;
+	}
+
+	uint64_t por_thread = (k_fim - k_ini)/n_threads, resto = (k_fim - k_ini)%n_threads;
+	for(int i=0; i<n_threads; i++){
+		tarefas[i].formula = formula;
+		tarefas[i].n = 4*(int64_t)posicao;
+		tarefas[i].k_ini = k_ini + i*por_thread + ((uint64_t)i < resto ? (uint64_t)i : resto);
+		tarefas[i].k_fim = tarefas[i].k_ini + por_thread + ((uint64_t)i < resto ? 1 : 0);
+		tarefas[i].posicao = i;
+		tarefas[i].criada = (i > 0 && pthread_create(&tarefas[i].thread, NULL, bbp_thread, &tarefas[i]) == 0);
+	}
+
+	/* A thread atual soma o primeiro intervalo e os das threads que não puderam ser criadas */
+	for(int i=0; i<n_threads; i++){
+		if(tarefas[i].criada)
+			pthread_join(tarefas[i].thread, NULL);
+		else
+			bbp_trabalhador(&tarefas[i]);
+		soma += tarefas[i].soma;
+	}
+
+	if(tarefas != &unica)
+		free(tarefas);
+	return soma;
+}
+
+/* Dígitos hexadecimais garantidos: cada fração truncada erra menos de 2^-64 */
+int bbp_digitos_confiaveis(bbp_formula_t formula, uint64_t posicao){
+	uint64_t erro = bbp_num_termos(formula, posicao)*(formula == BBP_BBP ? 4 : 7); // Em unidades de 2^-64
+	int bits = 0;
+	while(erro > 0){
+		bits++;
+		erro >>= 1;
+	}
+	return (BBP_BITS - bits - 4)/4; // Um dígito de folga para o transporte causado pelo erro
+}
+
+/* Escreve os n_digitos hexadecimais mais significativos da fração */
+void bbp_hexadecimal(uint64_t fracao, int n_digitos, char *texto){
+	static const char hex[] = "0123456789ABCDEF";
+	for(int i=0; i<n_digitos; i++)
+		texto[i] = hex[(fracao >> (BBP_BITS - 4*(i + 1))) & 0xF];
+	texto[n_digitos] = '\0';
+}
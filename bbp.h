@@ -0,0 +1,28 @@
+/* Extração de dígitos hexadecimais de PI em posições arbitrárias (fórmulas do tipo BBP)
+
+	Bailey-Borwein-Plouffe: PI = soma_k 16^-k (4/(8k+1) - 2/(8k+4) - 1/(8k+5) - 1/(8k+6))
+	Bellard:          64 PI = soma_k (-1)^k 1024^-k (-32/(4k+1) - 1/(4k+3) + 256/(10k+1) - 64/(10k+3)
+	                                                - 4/(10k+5) - 4/(10k+7) + 1/(10k+9))
+
+Os dígitos a partir da posição d (d = 0 é o primeiro dígito após a vírgula) são a parte
+fracionária de 16^d * PI. Cada termo vira uma fração 2^e mod m / m calculada por exponenciação
+modular, somada em ponto fixo de 64 bits (módulo 1, o transbordo descarta a parte inteira).
+Os termos são independentes, então qualquer divisão entre processos e threads produz a mesma
+soma exata, e a memória utilizada é constante. */
+
+#ifndef BBP_H
+#define BBP_H
+
+#include <stdint.h>
+
+typedef enum{
+	BBP_BBP,
+	BBP_BELLARD // Cerca de 40% menos operações que a fórmula BBP
+} bbp_formula_t;
+
+uint64_t bbp_num_termos(bbp_formula_t formula, uint64_t posicao);
+uint64_t bbp_soma(bbp_formula_t formula, uint64_t posicao, uint64_t k_ini, uint64_t k_fim, int n_threads);
+int bbp_digitos_confiaveis(bbp_formula_t formula, uint64_t posicao);
+void bbp_hexadecimal(uint64_t fracao, int n_digitos, char *texto);
+
+#endif
@@ -0,0 +1,422 @@
+/* COMPILAÇÃO:
+gcc -O2 -pthread -o benchmark benchmark.c montecarlo.c topologia.c chudnovsky.c bigint.c ntt.c memoria.c bbp.c checkpoint.c -lm
+
+EXECUÇÃO:
+./benchmark [-n pontos,...] [-t threads,...] [-d digitos,...] [-b posicoes,...] [-r repeticoes]
+            [-m motores] [-f texto|json|csv] [-a afinidade] [-x nome=comando]...
+(sem -t mede 1, 2, 4, ... threads até a quantidade de processadores da máquina)
+
+Mede cada motor de cálculo de PI com o tempo de parede (mc_relogio), repetindo cada caso e exibindo a
+vazão média, o desvio padrão e, nos motores com threads, a eficiência em relação à menor quantidade de
+threads medida: vazão/(threads*vazão por thread da menor quantidade). Motores (-m, padrão todos):
+	escalar, avx2, avx512  kernel do teste do círculo em uma thread (os não suportados pela CPU são pulados)
+	<kernel>-float         kernels de 32 bits (ex. avx2-float, avx512-inteiro), ver mc_selecionar_precisao
+	<kernel>-inteiro
+	threads                pool de threads com o melhor kernel (mc_pool_executar)
+	serie                  série de Chudnovsky (dígitos/s)
+	bbp                    extração de dígitos hexadecimais pela fórmula de Bellard (termos/s)
+Todos os sorteios usam a mesma semente, então as contagens dos motores de Monte Carlo devem ser iguais para
+a mesma quantidade de pontos e precisão; uma diferença (ou dígitos errados na série) é exibida como AVISO e o
+programa termina com erro.
+
+Afinidade: -a compacta, espalhada ou fisica fixa as threads dos motores threads e bbp (topologia.h); o
+desvio padrão das repetições mostra a variação de cada política, ex. ./benchmark -m threads -r 10 -a fisica
+
+Comandos externos: -x nome=comando mede o tempo de parede de um programa executado pelo shell, com {n}
+substituído por cada quantidade de pontos. Ex. MPI e socket (o servidor já aguardando com os clientes):
+	./benchmark -m - -x "mpi=mpirun -np 4 ./pi_mpi {n}" -x "socket=./submete 5000 -n {n}"
+
+A saída em JSON ou CSV (-f) vai para a saída padrão e o progresso para a saída de erros, ex.
+./benchmark -r 10 -f json > resultado.json */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "montecarlo.h"
+#include "chudnovsky.h"
+#include "bbp.h"
+#include "topologia.h"
+
+#define MAX_LISTA 32 // Valores de cada lista de -n, -t, -d e -b
+#define MAX_COMANDOS 16 // Comandos externos (-x)
+#define REPETICOES 5 // Execuções de cada caso (padrão)
+#define SEMENTE 1 // Semente de todos os sorteios
+#define PI_REFERENCIA "3.14159265358979323846" // Conferência dos dígitos da série
+
+/* Resultado das repetições de um caso */
+typedef struct{
+	const char *motor;
+	const char *unidade; // Unidade da vazão: pontos, digitos ou termos
+	uint64_t tamanho; // Pontos, dígitos ou posição
+	int threads; // 0 = não se aplica (comandos externos)
+	int repeticoes;
+	double segundos; // Tempo médio de uma execução
+	double vazao, desvio, minimo, maximo; // Unidades por segundo
+	double eficiencia; // < 0 = não se aplica
+} medida_t;
+
+/* Caso medido: parâmetros e o resultado da última execução */
+typedef struct{
+	uint64_t tamanho;
+	int threads;
+	mc_pool_t *pool;
+	const char *comando;
+	mc_resultado_t contagem; // Contagem do Monte Carlo
+	uint64_t soma; // Soma da fórmula de Bellard
+	int erro;
+} caso_t;
+
+typedef void (*execucao_t)(caso_t *c);
+
+/* Variáveis globais */
+medida_t *medidas = NULL;
+size_t n_medidas = 0;
+int repeticoes = REPETICOES;
+int avisos = 0;
+
+/* Lê uma lista separada por vírgulas (aceita notação científica, ex. 1e8). Retorna a quantidade de valores */
+int le_lista(const char *texto, uint64_t *v){
+	int n = 0;
+	char *fim;
+
+	while(*texto && n < MAX_LISTA){
+		double x = strtod(texto, &fim);
+		if(fim == texto || x < 1)
+			return -1;
+		v[n++] = (uint64_t)x;
+		texto = (*fim == ',') ? fim + 1 : fim;
+		if(*fim && *fim != ',')
+			return -1;
+	}
+	return n;
+}
+
+/* Verifica se o motor está na lista separada por vírgulas */
+int motor_ativo(const char *lista, const char *motor){
+	size_t n = strlen(motor);
+	for(const char *p=lista; p; p=strchr(p, ',')){
+		if(*p == ',')
+			p++;
+		if(strncmp(p, motor, n) == 0 && (p[n] == ',' || p[n] == '\0'))
+			return 1;
+	}
+	return 0;
+}
+
+/* Sorteia os pontos bloco a bloco na thread atual, com o kernel selecionado */
+void executa_kernel(caso_t *c){
+	mc_resultado_t r = {0, 0};
+	uint64_t n_blocos = mc_num_blocos(c->tamanho);
+	for(uint64_t b=0; b<n_blocos; b++){
+		uint64_t n = mc_tam_bloco(c->tamanho, b);
+		r.dentro += montecarlo_bloco(SEMENTE, b, n);
+		r.total += n;
+	}
+	c->contagem = r;
+}
+
+void executa_pool(caso_t *c){
+	c->contagem = mc_pool_executar(c->pool, SEMENTE, c->tamanho, 0, mc_num_blocos(c->tamanho));
+}
+
+void executa_serie(caso_t *c){
+	char *pi = chudnovsky_pi(c->tamanho, c->threads, NULL, 0);
+	size_t n = (c->tamanho + 2 < strlen(PI_REFERENCIA)) ? c->tamanho + 2 : strlen(PI_REFERENCIA);
+	if(!pi || strncmp(pi, PI_REFERENCIA, n) != 0)
+		c->erro = 1;
+	free(pi);
+}
+
+void executa_bbp(caso_t *c){
+	c->soma = bbp_soma(BBP_BELLARD, c->tamanho, 0, bbp_num_termos(BBP_BELLARD, c->tamanho), c->threads);
+}
+
+/* Executa o comando externo com {n} substituído pelo tamanho do caso */
+void executa_comando(caso_t *c){
+	char linha[4096], n[24];
+	size_t k = 0;
+
+	snprintf(n, sizeof(n), "%llu", (unsigned long long)c->tamanho);
+	k += snprintf(linha, sizeof(linha), "(");
+	for(const char *p=c->comando; *p && k < sizeof(linha) - 64; p++){
+		if(strncmp(p, "{n}", 3) == 0){
+			k += snprintf(linha + k, sizeof(linha) - k, "%s", n);
+			p += 2;
+		} else{
+			linha[k++] = *p;
+		}
+	}
+	snprintf(linha + k, sizeof(linha) - k, ") > /dev/null");
+
+	int status = system(linha);
+	if(status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		c->erro = 1;
+}
+
+/* Executa o caso repetidamente e registra a vazão média. Retorna a medida, ou NULL se alguma execução falhou */
+medida_t *mede(const char *motor, const char *unidade, uint64_t quantidade, execucao_t executa, caso_t *c){
+	double soma = 0, soma_q = 0, tempo = 0, minimo = 0, maximo = 0;
+
+	fprintf(stderr, "[#]%s: %llu, %d threads...\n", motor, (unsigned long long)c->tamanho, c->threads);
+	for(int i=0; i<repeticoes; i++){
+		double inicio = mc_relogio();
+		executa(c);
+		double segundos = mc_relogio() - inicio;
+		if(c->erro){
+			fprintf(stderr, "AVISO: %s falhou (%llu, %d threads)\n", motor, (unsigned long long)c->tamanho, c->threads);
+			avisos++;
+			return NULL;
+		}
+
+		double vazao = segundos > 0 ? quantidade/segundos : 0;
+		soma += vazao;
+		soma_q += vazao*vazao;
+		tempo += segundos;
+		if(i == 0 || vazao < minimo)
+			minimo = vazao;
+		if(i == 0 || vazao > maximo)
+			maximo = vazao;
+	}
+
+	medida_t *novas = (medida_t *)realloc(medidas, (n_medidas + 1)*sizeof(medida_t));
+	if(!novas){
+		fprintf(stderr, "ERROR: memória\n");
+		exit(EXIT_FAILURE);
+	}
+	medidas = novas;
+
+	medida_t *m = &medidas[n_medidas++];
+	double media = soma/repeticoes;
+	m->motor = motor;
+	m->unidade = unidade;
+	m->tamanho = c->tamanho;
+	m->threads = c->threads;
+	m->repeticoes = repeticoes;
+	m->segundos = tempo/repeticoes;
+	m->vazao = media;
+	m->desvio = repeticoes > 1 ? sqrt(fmax(0, (soma_q - repeticoes*media*media)/(repeticoes - 1))) : 0; // Desvio amostral
+	m->minimo = minimo;
+	m->maximo = maximo;
+	m->eficiencia = -1;
+	return m;
+}
+
+/* Eficiência de cada medida do motor e tamanho em relação à de menos threads (medidas consecutivas) */
+void calcula_eficiencia(size_t primeira){
+	for(size_t i=primeira; i<n_medidas; i++){
+		medida_t *base = NULL;
+		for(size_t j=primeira; j<n_medidas; j++)
+			if(medidas[j].tamanho == medidas[i].tamanho && (!base || medidas[j].threads < base->threads))
+				base = &medidas[j];
+		if(base->vazao > 0)
+			medidas[i].eficiencia = (medidas[i].vazao/medidas[i].threads)/(base->vazao/base->threads);
+	}
+}
+
+/* Confere a contagem do Monte Carlo com a primeira obtida para a mesma quantidade de pontos */
+void confere_contagem(const char *motor, uint64_t n, mc_resultado_t r, const uint64_t *pontos, mc_resultado_t *referencia, int n_pontos){
+	for(int i=0; i<n_pontos; i++){
+		if(pontos[i] != n)
+			continue;
+		if(referencia[i].total == 0){
+			referencia[i] = r;
+		} else if(referencia[i].dentro != r.dentro || referencia[i].total != r.total){
+			fprintf(stderr, "AVISO: %s sorteou %llu pontos dentro de %llu, esperado %llu\n", motor, (unsigned long long)r.dentro,
+			        (unsigned long long)n, (unsigned long long)referencia[i].dentro);
+			avisos++;
+		}
+		return;
+	}
+}
+
+void exibe_texto(){
+	printf("\n%-16s %14s %8s %16s %10s %12s %8s %11s\n", "Motor", "Tamanho", "Threads", "Vazão/s", "Unidade", "Desvio/s", "CV", "Eficiência");
+	for(size_t i=0; i<n_medidas; i++){
+		const medida_t *m = &medidas[i];
+		char threads[16] = "-", eficiencia[16] = "-";
+		if(m->threads > 0)
+			snprintf(threads, sizeof(threads), "%d", m->threads);
+		if(m->eficiencia >= 0)
+			snprintf(eficiencia, sizeof(eficiencia), "%.1f%%", 100*m->eficiencia);
+		printf("%-16s %14llu %8s %16.4e %10s %12.3e %7.2f%% %11s\n", m->motor, (unsigned long long)m->tamanho, threads, m->vazao, m->unidade,
+		       m->desvio, m->vazao > 0 ? 100*m->desvio/m->vazao : 0.0, eficiencia);
+	}
+}
+
+void exibe_csv(){
+	printf("motor,unidade,tamanho,threads,repeticoes,segundos,vazao,desvio,minimo,maximo,eficiencia\n");
+	for(size_t i=0; i<n_medidas; i++){
+		const medida_t *m = &medidas[i];
+		printf("%s,%s,%llu,%d,%d,%.9g,%.9g,%.9g,%.9g,%.9g,", m->motor, m->unidade, (unsigned long long)m->tamanho, m->threads,
+		       m->repeticoes, m->segundos, m->vazao, m->desvio, m->minimo, m->maximo);
+		if(m->eficiencia >= 0)
+			printf("%.6f", m->eficiencia);
+		printf("\n");
+	}
+}
+
+void exibe_json(){
+	printf("{\n  \"cpus\": %d,\n  \"kernel\": \"%s\",\n  \"repeticoes\": %d,\n  \"avisos\": %d,\n  \"medidas\": [", mc_num_cpus(),
+	       mc_kernel_nome(), repeticoes, avisos);
+	for(size_t i=0; i<n_medidas; i++){
+		const medida_t *m = &medidas[i];
+		printf("%s\n    {\"motor\": \"%s\", \"unidade\": \"%s\", \"tamanho\": %llu, \"threads\": ", i ? "," : "", m->motor, m->unidade,
+		       (unsigned long long)m->tamanho);
+		if(m->threads > 0)
+			printf("%d", m->threads);
+		else
+			printf("null");
+		printf(", \"repeticoes\": %d, \"segundos\": %.9g, \"vazao\": %.9g, \"desvio\": %.9g, \"minimo\": %.9g, \"maximo\": %.9g, \"eficiencia\": ",
+		       m->repeticoes, m->segundos, m->vazao, m->desvio, m->minimo, m->maximo);
+		if(m->eficiencia >= 0)
+			printf("%.6f}", m->eficiencia);
+		else
+			printf("null}");
+	}
+	printf("\n  ]\n}\n");
+}
+
+int main(int argc, char **argv){
+	uint64_t pontos[MAX_LISTA] = {10000000, 100000000}, threads[MAX_LISTA], digitos[MAX_LISTA] = {10000, 100000}, posicoes[MAX_LISTA] = {100000, 1000000};
+	int n_pontos = 2, n_threads = 0, n_digitos = 2, n_posicoes = 2;
+	const char *motores = "escalar,avx2,avx512,escalar-float,avx2-float,avx512-float,escalar-inteiro,avx2-inteiro,avx512-inteiro,threads,serie,bbp";
+	const char *formato = "texto";
+	char *comandos[MAX_COMANDOS];
+	int n_comandos = 0, invalido = 0;
+	int afinidade = TOPO_NENHUMA;
+	int opt;
+
+	while((opt = getopt(argc, argv, "n:t:d:b:r:m:f:a:x:")) != -1){
+		switch(opt){
+			case 'n': invalido |= (n_pontos = le_lista(optarg, pontos)) < 1; break;
+			case 't': invalido |= (n_threads = le_lista(optarg, threads)) < 1; break;
+			case 'd': invalido |= (n_digitos = le_lista(optarg, digitos)) < 1; break;
+			case 'b': invalido |= (n_posicoes = le_lista(optarg, posicoes)) < 1; break;
+			case 'r': repeticoes = atoi(optarg); break;
+			case 'm': motores = optarg; break;
+			case 'f': formato = optarg; break;
+			case 'a': invalido |= (afinidade = topo_politica_id(optarg)) < 0; break;
+			case 'x':
+				if(n_comandos == MAX_COMANDOS || !strchr(optarg, '='))
+					invalido = 1;
+				else
+					comandos[n_comandos++] = optarg;
+				break;
+			default: invalido = 1; break;
+		}
+	}
+
+	if(invalido || optind != argc || repeticoes < 1 || (strcmp(formato, "texto") && strcmp(formato, "json") && strcmp(formato, "csv"))){
+		printf("Use: %s [-n pontos,...] [-t threads,...] [-d digitos,...] [-b posicoes,...] [-r repeticoes] [-m motores] [-f texto|json|csv] [-a afinidade] [-x nome=comando]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if(topo_configurar((topo_politica_t)afinidade, 0) != 0)
+		fprintf(stderr, "[#]AVISO: topologia indisponível, as threads não serão fixadas\n");
+
+	if(n_threads == 0){ // 1, 2, 4, ... até a quantidade de processadores
+		int cpus = mc_num_cpus();
+		for(int t=1; t<cpus && n_threads<MAX_LISTA-1; t*=2)
+			threads[n_threads++] = t;
+		threads[n_threads++] = cpus;
+	}
+
+	mc_resultado_t referencia[3][MAX_LISTA] = {{{0, 0}}}; // Contagem esperada para cada precisão e quantidade de pontos
+
+	/* Kernels do teste do círculo, uma thread */
+	const char *kernels[] = {"escalar", "avx2", "avx512"};
+	const char *precisoes[] = {"double", "float", "inteiro"};
+	static char nomes[3][3][24]; // Nomes dos motores (as medidas guardam o ponteiro)
+	for(int p=0; p<3; p++){
+		for(int k=0; k<3; k++){
+			snprintf(nomes[p][k], sizeof(nomes[p][k]), p ? "%s-%s" : "%s", kernels[k], precisoes[p]);
+			if(!motor_ativo(motores, nomes[p][k]))
+				continue;
+			if(mc_selecionar_precisao(precisoes[p]) != 0 || mc_selecionar_kernel(kernels[k]) != 0){
+				fprintf(stderr, "[#]%s: não suportado pela CPU\n", nomes[p][k]);
+				continue;
+			}
+			for(int i=0; i<n_pontos; i++){
+				caso_t c = {.tamanho = pontos[i], .threads = 1};
+				if(mede(nomes[p][k], "pontos", pontos[i], executa_kernel, &c))
+					confere_contagem(nomes[p][k], pontos[i], c.contagem, pontos, referencia[p], n_pontos);
+			}
+		}
+	}
+	mc_selecionar_precisao("double");
+	mc_selecionar_kernel("auto");
+
+	/* Pool de threads */
+	if(motor_ativo(motores, "threads")){
+		size_t primeira = n_medidas;
+		for(int t=0; t<n_threads; t++){
+			mc_pool_t *pool = mc_pool_criar((int)threads[t]);
+			if(!pool){
+				fprintf(stderr, "ERROR: pthread\n");
+				return EXIT_FAILURE;
+			}
+			for(int i=0; i<n_pontos; i++){
+				caso_t c = {.tamanho = pontos[i], .threads = (int)threads[t], .pool = pool};
+				if(mede("threads", "pontos", pontos[i], executa_pool, &c))
+					confere_contagem("threads", pontos[i], c.contagem, pontos, referencia[0], n_pontos);
+			}
+			mc_pool_destruir(pool);
+		}
+		calcula_eficiencia(primeira);
+	}
+
+	/* Série de Chudnovsky */
+	if(motor_ativo(motores, "serie")){
+		size_t primeira = n_medidas;
+		for(int t=0; t<n_threads; t++){
+			for(int i=0; i<n_digitos; i++){
+				caso_t c = {.tamanho = digitos[i], .threads = (int)threads[t]};
+				mede("serie", "digitos", digitos[i], executa_serie, &c);
+			}
+		}
+		calcula_eficiencia(primeira);
+	}
+
+	/* Extração de dígitos hexadecimais (a soma não depende da quantidade de threads) */
+	if(motor_ativo(motores, "bbp")){
+		size_t primeira = n_medidas;
+		uint64_t esperada[MAX_LISTA];
+		for(int t=0; t<n_threads; t++){
+			for(int i=0; i<n_posicoes; i++){
+				caso_t c = {.tamanho = posicoes[i], .threads = (int)threads[t]};
+				if(!mede("bbp", "termos", bbp_num_termos(BBP_BELLARD, posicoes[i]), executa_bbp, &c))
+					continue;
+				if(t == 0){
+					esperada[i] = c.soma;
+				} else if(c.soma != esperada[i]){
+					fprintf(stderr, "AVISO: bbp com %d threads difere na posição %llu\n", c.threads, (unsigned long long)posicoes[i]);
+					avisos++;
+				}
+			}
+		}
+		calcula_eficiencia(primeira);
+	}
+
+	/* Comandos externos */
+	for(int x=0; x<n_comandos; x++){
+		char *igual = strchr(comandos[x], '=');
+		*igual = '\0';
+		for(int i=0; i<n_pontos; i++){
+			caso_t c = {.tamanho = pontos[i], .threads = 0};
+			c.comando = igual + 1;
+			mede(comandos[x], "pontos", pontos[i], executa_comando, &c);
+		}
+	}
+
+	if(strcmp(formato, "json") == 0)
+		exibe_json();
+	else if(strcmp(formato, "csv") == 0)
+		exibe_csv();
+	else
+		exibe_texto();
+
+	free(medidas);
+	return avisos ? EXIT_FAILURE : EXIT_SUCCESS;
+}
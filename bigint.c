@@ -0,0 +1,637 @@
+/* Inteiros de precisão arbitrária (ver bigint.h) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "bigint.h"
+#include "ntt.h"
+#include "memoria.h"
+
+#define KARATSUBA_LIMIAR 32 // Abaixo desta quantidade de palavras a multiplicação escolar é mais rápida
+#define TOOM3_LIMIAR 256 // A partir daqui Toom-3 (5 produtos de 1/3 do tamanho) supera Karatsuba
+#define NTT_LIMIAR 2048 // A partir daqui a NTT (ntt.h) supera Toom-3
+#define NEWTON_LIMIAR 32 // Divisões menores (divisor ou quociente) usam o algoritmo escolar
+#define TOOM3_MEMORIA 4 // Memória temporária do Toom-3, em múltiplos do tamanho do produto
+
+static int bigint_threads = 1; // Threads das multiplicações pela NTT
+
+/* Aloca memória (memoria.h) ou encerra o programa (não há como continuar o cálculo sem ela) */
+static void *bigint_alocar(void *p, size_t bytes){
+	p = memoria_realocar(p, bytes ? bytes : 1);
+	if(!p){
+		perror("ERROR: bigint");
+		exit(EXIT_FAILURE);
+	}
+	return p;
+}
+
+/* Garante espaço para n palavras em a->d (o conteúdo e a->n não mudam) */
+void bigint_reservar(bigint_t *a, size_t n){
+	if(n > a->cap){
+		a->d = (uint32_t *)bigint_alocar(a->d, n*sizeof(uint32_t));
+		a->cap = n;
+	}
+}
+
+/* Remove as palavras nulas mais significativas */
+static void bigint_normalizar(bigint_t *a){
+	while(a->n > 0 && a->d[a->n-1] == 0)
+		a->n--;
+	if(a->n == 0)
+		a->neg = 0;
+}
+
+/* Operações sobre vetores de palavras (sem sinal) */
+
+static size_t pal_tamanho(const uint32_t *a, size_t n){
+	while(n > 0 && a[n-1] == 0)
+		n--;
+	return n;
+}
+
+static int pal_comparar(const uint32_t *a, size_t an, const uint32_t *b, size_t bn){
+	an = pal_tamanho(a, an);
+	bn = pal_tamanho(b, bn);
+	if(an != bn)
+		return (an < bn) ? -1 : 1;
+	while(an-- > 0)
+		if(a[an] != b[an])
+			return (a[an] < b[an]) ? -1 : 1;
+	return 0;
+}
+
+/* r[0..an) = a + b, com an >= bn. Retorna o vai-um. r pode ser o próprio a */
+static uint32_t pal_somar(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn){
+	uint32_t carry = 0;
+	for(size_t i=0; i<an; i++){
+		uint32_t t = a[i] + carry + (i < bn ? b[i] : 0);
+		carry = (t >= BIGINT_BASE);
+		r[i] = carry ? t - BIGINT_BASE : t;
+	}
+	return carry;
+}
+
+/* r[0..rn) += t[0..tn), com rn >= tn e sem transbordo; o vai-um é propagado só enquanto existir */
+static void pal_acumular(uint32_t *r, size_t rn, const uint32_t *t, size_t tn){
+	uint32_t carry = pal_somar(r, r, tn, t, tn);
+	for(size_t i=tn; carry && i<rn; i++){
+		carry = (r[i] == BIGINT_BASE - 1);
+		r[i] = carry ? 0 : r[i] + 1;
+	}
+}
+
+/* r[0..an) = a - b, com a >= b. r pode ser o próprio a */
+static void pal_subtrair(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn){
+	uint32_t borrow = 0;
+	for(size_t i=0; i<an; i++){
+		uint32_t s = borrow + (i < bn ? b[i] : 0);
+		borrow = (a[i] < s);
+		r[i] = borrow ? a[i] + BIGINT_BASE - s : a[i] - s;
+	}
+}
+
+/* r[0..an+bn) = a*b pelo algoritmo escolar */
+static void pal_escolar(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn){
+	memset(r, 0, (an + bn)*sizeof(uint32_t));
+	for(size_t i=0; i<an; i++){
+		uint64_t ai = a[i], carry = 0;
+		if(ai == 0)
+			continue;
+		for(size_t j=0; j<bn; j++){
+			uint64_t t = r[i+j] + ai*b[j] + carry; // < BASE^2 + 2*BASE, cabe em 64 bits
+			r[i+j] = (uint32_t)(t % BIGINT_BASE);
+			carry = t / BIGINT_BASE;
+		}
+		r[i+bn] = (uint32_t)carry;
+	}
+}
+
+static void pal_multiplicar(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn);
+
+/* r[0..an+bn) = a*b por Karatsuba: a = a1*B^h + a0, b = b1*B^h + b0 e
+a*b = z2*B^2h + (z1 - z2 - z0)*B^h + z0, com z1 = (a0 + a1)(b0 + b1) */
+static void pal_karatsuba(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn, size_t h){
+	size_t n1 = an - h, m1 = bn - h, tam_z1 = 2*(h + 1);
+	uint32_t *sa = (uint32_t *)bigint_alocar(NULL, (2*(h + 1) + tam_z1)*sizeof(uint32_t));
+	uint32_t *sb = sa + h + 1, *z1 = sb + h + 1;
+
+	sa[h] = pal_somar(sa, a, h, a + h, n1);
+	sb[h] = pal_somar(sb, b, h, b + h, m1);
+	pal_multiplicar(z1, sa, h + 1, sb, h + 1);
+
+	memset(r, 0, (an + bn)*sizeof(uint32_t));
+	pal_multiplicar(r, a, h, b, h); // z0 em r[0..2h)
+	pal_multiplicar(r + 2*h, a + h, n1, b + h, m1); // z2 em r[2h..an+bn)
+
+	pal_subtrair(z1, z1, tam_z1, r, 2*h);
+	pal_subtrair(z1, z1, tam_z1, r + 2*h, n1 + m1);
+	pal_somar(r + h, r + h, an + bn - h, z1, pal_tamanho(z1, tam_z1));
+
+	memoria_liberar(sa);
+}
+
+static void pal_toom3(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn, size_t k);
+static void pal_multiplicar_blocos(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn);
+
+/* r[0..an+bn) = a*b. r não pode coincidir com a nem com b */
+static void pal_multiplicar(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn){
+	if(an < bn){ // a é sempre o maior
+		const uint32_t *t = a; a = b; b = t;
+		size_t tn = an; an = bn; bn = tn;
+	}
+
+	if(bn < KARATSUBA_LIMIAR){
+		pal_escolar(r, a, an, b, bn);
+		return;
+	}
+
+	if(bn >= NTT_LIMIAR && an + bn <= NTT_TAM_MAXIMO){
+		ntt_multiplicar(r, a, an, b, bn, bigint_threads);
+		return;
+	}
+
+	if(bn > NTT_TAM_MAXIMO/2 && !memoria_cabe(TOOM3_MEMORIA*(an + bn)*sizeof(uint32_t))){
+		pal_multiplicar_blocos(r, a, an, b, bn);
+		return;
+	}
+
+	size_t k = (an + 2)/3; // Acima do tamanho máximo da NTT, Toom-3 divide os operandos até caberem
+	if(bn >= TOOM3_LIMIAR && bn > 2*k){
+		pal_toom3(r, a, an, b, bn, k);
+		return;
+	}
+
+	size_t h = (an + 1)/2;
+	if(bn < TOOM3_LIMIAR && bn > h){
+		pal_karatsuba(r, a, an, b, bn, h);
+		return;
+	}
+
+	/* Desbalanceado: a é dividido em partes do tamanho de b */
+	uint32_t *t = (uint32_t *)bigint_alocar(NULL, 2*bn*sizeof(uint32_t));
+	memset(r, 0, (an + bn)*sizeof(uint32_t));
+	for(size_t i=0; i<an; i+=bn){
+		size_t parte = (an - i < bn) ? an - i : bn;
+		pal_multiplicar(t, a + i, parte, b, bn);
+		pal_acumular(r + i, an + bn - i, t, parte + bn);
+	}
+	memoria_liberar(t);
+}
+
+/* r[0..an+bn) = a*b em passagens sequenciais, para operandos que não cabem na RAM: os produtos
+dos blocos de a e b (do tamanho máximo da NTT) são acumulados em r. Cada bloco de a é lido uma vez
+e b é percorrido do início ao fim para cada um, então as páginas em disco são lidas em ordem e a
+memória extra é de apenas um produto de blocos */
+static void pal_multiplicar_blocos(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn){
+	size_t bloco = NTT_TAM_MAXIMO/2;
+	uint32_t *t = (uint32_t *)bigint_alocar(NULL, 2*bloco*sizeof(uint32_t));
+
+	memset(r, 0, (an + bn)*sizeof(uint32_t));
+	for(size_t i=0; i<an; i+=bloco){
+		size_t ai = (an - i < bloco) ? an - i : bloco;
+		for(size_t j=0; j<bn; j+=bloco){
+			size_t bj = (bn - j < bloco) ? bn - j : bloco;
+			pal_multiplicar(t, a + i, ai, b + j, bj);
+			pal_acumular(r + i + j, an + bn - i - j, t, ai + bj);
+		}
+	}
+	memoria_liberar(t);
+}
+
+/* Interface de bigint_t */
+
+/* Threads utilizadas pelas multiplicações grandes (n <= 0 = uma) */
+void bigint_definir_threads(int n){
+	bigint_threads = (n > 0) ? n : 1;
+}
+
+static void bigint_de_palavras(bigint_t *x, const uint32_t *d, size_t n){
+	bigint_reservar(x, n);
+	if(n)
+		memcpy(x->d, d, n*sizeof(uint32_t));
+	x->n = n;
+	x->neg = 0;
+	bigint_normalizar(x);
+}
+
+/* Divisão exata por um inteiro pequeno (interpolação do Toom-3), preservando o sinal */
+static void bigint_dividir_exato(bigint_t *r, const bigint_t *a, uint32_t d){
+	uint64_t resto = 0;
+	bigint_reservar(r, a->n);
+	for(size_t i=a->n; i-- > 0;){
+		uint64_t x = resto*BIGINT_BASE + a->d[i];
+		r->d[i] = (uint32_t)(x / d);
+		resto = x % d;
+	}
+	r->n = a->n;
+	r->neg = a->neg;
+	bigint_normalizar(r);
+}
+
+/* r[0..an+bn) = a*b por Toom-3: os operandos são polinômios de grau 2 em x = B^k, avaliados em
+0, 1, -1, -2 e infinito; os 5 produtos são interpolados pela sequência de Bodrato */
+static void pal_toom3(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn, size_t k){
+	bigint_t a0, a1, a2, b0, b1, b2, pa, pb, r0, r1, rm1, rm2, rinf, t;
+	bigint_t *todos[] = {&a0, &a1, &a2, &b0, &b1, &b2, &pa, &pb, &r0, &r1, &rm1, &rm2, &rinf, &t};
+	for(size_t i=0; i<sizeof(todos)/sizeof(todos[0]); i++)
+		bigint_iniciar(todos[i]);
+
+	bigint_de_palavras(&a0, a, k);
+	bigint_de_palavras(&a1, a + k, k);
+	bigint_de_palavras(&a2, a + 2*k, an - 2*k);
+	bigint_de_palavras(&b0, b, k);
+	bigint_de_palavras(&b1, b + k, k);
+	bigint_de_palavras(&b2, b + 2*k, bn - 2*k);
+
+	bigint_multiplicar(&r0, &a0, &b0); // x = 0
+	bigint_multiplicar(&rinf, &a2, &b2); // x = infinito
+
+	bigint_somar(&t, &a0, &a2); // a(1) = t + a1, a(-1) = t - a1
+	bigint_somar(&pa, &t, &a1);
+	bigint_somar(&t, &b0, &b2);
+	bigint_somar(&pb, &t, &b1);
+	bigint_multiplicar(&r1, &pa, &pb); // x = 1
+
+	bigint_somar(&t, &a0, &a2);
+	bigint_subtrair(&pa, &t, &a1);
+	bigint_somar(&t, &b0, &b2);
+	bigint_subtrair(&pb, &t, &b1);
+	bigint_multiplicar(&rm1, &pa, &pb); // x = -1
+
+	bigint_somar(&pa, &pa, &a2); // a(-2) = 2*(a(-1) + a2) - a0
+	bigint_multiplicar_u32(&pa, &pa, 2);
+	bigint_subtrair(&pa, &pa, &a0);
+	bigint_somar(&pb, &pb, &b2);
+	bigint_multiplicar_u32(&pb, &pb, 2);
+	bigint_subtrair(&pb, &pb, &b0);
+	bigint_multiplicar(&rm2, &pa, &pb); // x = -2
+
+	/* Interpolação: r1..r3 passam a ser os coeficientes de x, x^2 e x^3 */
+	bigint_subtrair(&t, &rm2, &r1); // r3 = (r(-2) - r(1))/3
+	bigint_dividir_exato(&rm2, &t, 3);
+	bigint_subtrair(&t, &r1, &rm1); // r1 = (r(1) - r(-1))/2
+	bigint_dividir_exato(&r1, &t, 2);
+	bigint_subtrair(&rm1, &rm1, &r0); // r2 = r(-1) - r(0)
+	bigint_subtrair(&t, &rm1, &rm2); // r3 = (r2 - r3)/2 + 2*r(inf)
+	bigint_dividir_exato(&rm2, &t, 2);
+	bigint_multiplicar_u32(&t, &rinf, 2);
+	bigint_somar(&rm2, &rm2, &t);
+	bigint_somar(&rm1, &rm1, &r1); // r2 = r2 + r1 - r(inf)
+	bigint_subtrair(&rm1, &rm1, &rinf);
+	bigint_subtrair(&r1, &r1, &rm2); // r1 = r1 - r3
+
+	/* r = r0 + r1*x + r2*x^2 + r3*x^3 + r(inf)*x^4 (coeficientes não negativos) */
+	memset(r, 0, (an + bn)*sizeof(uint32_t));
+	const bigint_t *coef[] = {&r0, &r1, &rm1, &rm2, &rinf};
+	for(size_t i=0; i<5; i++)
+		if(coef[i]->n)
+			pal_somar(r + i*k, r + i*k, an + bn - i*k, coef[i]->d, coef[i]->n);
+
+	for(size_t i=0; i<sizeof(todos)/sizeof(todos[0]); i++)
+		bigint_liberar(todos[i]);
+}
+
+void bigint_iniciar(bigint_t *a){
+	a->d = NULL;
+	a->n = a->cap = 0;
+	a->neg = 0;
+}
+
+void bigint_liberar(bigint_t *a){
+	memoria_liberar(a->d);
+	bigint_iniciar(a);
+}
+
+void bigint_definir_u64(bigint_t *a, uint64_t v){
+	bigint_reservar(a, 3);
+	a->n = 0;
+	a->neg = 0;
+	while(v > 0){
+		a->d[a->n++] = (uint32_t)(v % BIGINT_BASE);
+		v /= BIGINT_BASE;
+	}
+}
+
+void bigint_copiar(bigint_t *r, const bigint_t *a){
+	if(r == a)
+		return;
+	bigint_reservar(r, a->n);
+	if(a->n)
+		memcpy(r->d, a->d, a->n*sizeof(uint32_t));
+	r->n = a->n;
+	r->neg = a->neg;
+}
+
+void bigint_trocar(bigint_t *a, bigint_t *b){
+	bigint_t t = *a;
+	*a = *b;
+	*b = t;
+}
+
+/* Compara os valores (com sinal): -1, 0 ou 1 */
+int bigint_comparar(const bigint_t *a, const bigint_t *b){
+	if(a->neg != b->neg)
+		return a->neg ? -1 : 1;
+	int c = pal_comparar(a->d, a->n, b->d, b->n);
+	return a->neg ? -c : c;
+}
+
+/* r = a + b, considerando o sinal de b como (b->neg ^ inverte) */
+static void bigint_somar_sinal(bigint_t *r, const bigint_t *a, const bigint_t *b, int inverte){
+	int neg_b = b->neg ^ (inverte && b->n > 0);
+	bigint_t t;
+	bigint_iniciar(&t);
+
+	if(a->neg == neg_b){ // Mesmo sinal: soma das magnitudes
+		const bigint_t *x = (a->n >= b->n) ? a : b, *y = (x == a) ? b : a;
+		bigint_reservar(&t, x->n + 1);
+		t.d[x->n] = pal_somar(t.d, x->d, x->n, y->d, y->n);
+		t.n = x->n + 1;
+		t.neg = a->neg;
+	} else{ // Sinais diferentes: diferença das magnitudes, com o sinal da maior
+		int c = pal_comparar(a->d, a->n, b->d, b->n);
+		const bigint_t *x = (c >= 0) ? a : b, *y = (c >= 0) ? b : a;
+		bigint_reservar(&t, x->n);
+		pal_subtrair(t.d, x->d, x->n, y->d, y->n);
+		t.n = x->n;
+		t.neg = (c >= 0) ? a->neg : neg_b;
+	}
+
+	bigint_normalizar(&t);
+	bigint_trocar(r, &t);
+	bigint_liberar(&t);
+}
+
+void bigint_somar(bigint_t *r, const bigint_t *a, const bigint_t *b){
+	bigint_somar_sinal(r, a, b, 0);
+}
+
+void bigint_subtrair(bigint_t *r, const bigint_t *a, const bigint_t *b){
+	bigint_somar_sinal(r, a, b, 1);
+}
+
+void bigint_multiplicar(bigint_t *r, const bigint_t *a, const bigint_t *b){
+	bigint_t t;
+	bigint_iniciar(&t);
+
+	if(a->n && b->n){
+		bigint_reservar(&t, a->n + b->n);
+		pal_multiplicar(t.d, a->d, a->n, b->d, b->n);
+		t.n = a->n + b->n;
+		t.neg = a->neg ^ b->neg;
+		bigint_normalizar(&t);
+	}
+
+	bigint_trocar(r, &t);
+	bigint_liberar(&t);
+}
+
+void bigint_multiplicar_u32(bigint_t *r, const bigint_t *a, uint32_t m){
+	uint64_t carry = 0;
+	size_t n = a->n;
+
+	bigint_reservar(r, n + 2);
+	for(size_t i=0; i<n; i++){
+		uint64_t t = (uint64_t)a->d[i]*m + carry; // < BASE*2^32, cabe em 64 bits
+		r->d[i] = (uint32_t)(t % BIGINT_BASE);
+		carry = t / BIGINT_BASE;
+	}
+	while(carry > 0){
+		r->d[n++] = (uint32_t)(carry % BIGINT_BASE);
+		carry /= BIGINT_BASE;
+	}
+	r->n = n;
+	r->neg = a->neg;
+	bigint_normalizar(r);
+}
+
+/* r = a*B^palavras (palavras < 0 descarta as palavras menos significativas, truncando em direção a zero) */
+void bigint_deslocar(bigint_t *r, const bigint_t *a, long palavras){
+	if(palavras >= 0){
+		size_t k = (size_t)palavras;
+		bigint_reservar(r, a->n + k);
+		memmove(r->d + k, a->d, a->n*sizeof(uint32_t));
+		memset(r->d, 0, k*sizeof(uint32_t));
+		r->n = a->n ? a->n + k : 0;
+	} else{
+		size_t k = (size_t)(-palavras);
+		if(k >= a->n){
+			r->n = 0;
+		} else{
+			bigint_reservar(r, a->n - k);
+			memmove(r->d, a->d + k, (a->n - k)*sizeof(uint32_t));
+			r->n = a->n - k;
+		}
+	}
+	r->neg = a->neg;
+	bigint_normalizar(r);
+}
+
+/* Divisão escolar (Knuth, algoritmo D) das magnitudes: q = a/b */
+static void bigint_dividir_escolar(bigint_t *q, const bigint_t *a, const bigint_t *b){
+	size_t n = b->n, m = a->n - b->n;
+	bigint_t u, v, t;
+	bigint_iniciar(&u);
+	bigint_iniciar(&v);
+	bigint_iniciar(&t);
+
+	bigint_reservar(&t, m + 1);
+	t.n = m + 1;
+
+	if(n == 1){ // Divisor de uma palavra
+		uint64_t resto = 0;
+		for(size_t i=a->n; i-- > 0;){
+			uint64_t x = resto*BIGINT_BASE + a->d[i];
+			t.d[i] = (uint32_t)(x / b->d[0]);
+			resto = x % b->d[0];
+		}
+	} else{
+		/* Normaliza para que a palavra mais significativa do divisor seja >= BASE/2 */
+		uint32_t fator = BIGINT_BASE/(b->d[n-1] + 1);
+		bigint_multiplicar_u32(&u, a, fator);
+		bigint_multiplicar_u32(&v, b, fator);
+		bigint_reservar(&u, a->n + 1);
+		memset(u.d + u.n, 0, (a->n + 1 - u.n)*sizeof(uint32_t));
+
+		uint64_t v1 = v.d[n-1], v2 = v.d[n-2];
+		for(size_t j=m+1; j-- > 0;){
+			uint64_t num = (uint64_t)u.d[j+n]*BIGINT_BASE + u.d[j+n-1];
+			uint64_t qhat = num / v1, rhat = num % v1;
+			while(qhat >= BIGINT_BASE || qhat*v2 > rhat*BIGINT_BASE + u.d[j+n-2]){
+				qhat--;
+				rhat += v1;
+				if(rhat >= BIGINT_BASE)
+					break;
+			}
+
+			/* u[j..j+n] -= qhat*v */
+			int64_t borrow = 0;
+			uint64_t carry = 0;
+			for(size_t i=0; i<=n; i++){
+				uint64_t p = (i < n ? qhat*v.d[i] : 0) + carry;
+				carry = p / BIGINT_BASE;
+				int64_t s = (int64_t)u.d[j+i] - (int64_t)(p % BIGINT_BASE) - borrow;
+				borrow = (s < 0);
+				u.d[j+i] = (uint32_t)(s < 0 ? s + BIGINT_BASE : s);
+			}
+
+			if(borrow){ // qhat uma unidade acima: soma v de volta
+				qhat--;
+				uint32_t c = pal_somar(u.d + j, u.d + j, n, v.d, n);
+				u.d[j+n] = (uint32_t)((u.d[j+n] + c) % BIGINT_BASE);
+			}
+			t.d[j] = (uint32_t)qhat;
+		}
+	}
+
+	bigint_normalizar(&t);
+	bigint_trocar(q, &t);
+	bigint_liberar(&u);
+	bigint_liberar(&v);
+	bigint_liberar(&t);
+}
+
+/* x ~ B^2n/b para b com exatamente n palavras (erro de poucas unidades), pela iteração de Newton
+x' = x + x*(B^2n - b*x)/B^2n, que dobra a precisão a cada passo */
+static void bigint_reciproco(bigint_t *x, const bigint_t *b){
+	size_t n = b->n;
+	bigint_t t, e;
+	bigint_iniciar(&t);
+	bigint_iniciar(&e);
+
+	if(n <= NEWTON_LIMIAR){
+		bigint_definir_u64(&t, 1);
+		bigint_deslocar(&t, &t, 2*n);
+		bigint_dividir_escolar(x, &t, b);
+	} else{
+		size_t h = (n + 1)/2 + 2; // Duas palavras de guarda: a palavra mais significativa de b pode valer 1
+		bigint_deslocar(&t, b, -(long)(n - h)); // Metade mais significativa de b
+		bigint_reciproco(x, &t);
+		bigint_deslocar(x, x, n - h); // Aproximação com metade da precisão
+
+		bigint_multiplicar(&t, b, x);
+		bigint_definir_u64(&e, 1);
+		bigint_deslocar(&e, &e, 2*n);
+		bigint_subtrair(&e, &e, &t); // Erro da aproximação (com sinal)
+		bigint_multiplicar(&t, x, &e);
+		bigint_deslocar(&t, &t, -(long)(2*n));
+		bigint_somar(x, x, &t);
+	}
+
+	bigint_liberar(&t);
+	bigint_liberar(&e);
+}
+
+/* q = a/b (quociente truncado) para a, b >= 0 */
+void bigint_dividir(bigint_t *q, const bigint_t *a, const bigint_t *b){
+	if(b->n == 0){
+		fputs("ERROR: bigint: divisão por zero\n", stderr);
+		exit(EXIT_FAILURE);
+	}
+	if(pal_comparar(a->d, a->n, b->d, b->n) < 0){
+		q->n = 0;
+		q->neg = 0;
+		return;
+	}
+
+	size_t n = b->n, m = a->n;
+	if(n < NEWTON_LIMIAR || m - n < NEWTON_LIMIAR){
+		bigint_dividir_escolar(q, a, b);
+		return;
+	}
+
+	/* Com b' = b*B^k e a' = a*B^k, a' tem no máximo 2n' palavras e q = a'*x/B^2n', x ~ B^2n'/b' */
+	size_t k = (m > 2*n) ? m - 2*n : 0;
+	bigint_t x, t, r;
+	bigint_iniciar(&x);
+	bigint_iniciar(&t);
+	bigint_iniciar(&r);
+
+	bigint_deslocar(&t, b, k);
+	bigint_reciproco(&x, &t);
+	bigint_multiplicar(&t, a, &x);
+	bigint_deslocar(&t, &t, -(long)(2*n + k));
+
+	/* Corrige as poucas unidades de erro do recíproco: 0 <= a - q*b < b */
+	bigint_multiplicar(&x, &t, b);
+	bigint_subtrair(&r, a, &x);
+	bigint_definir_u64(&x, 1);
+	while(r.neg){
+		bigint_subtrair(&t, &t, &x);
+		bigint_somar(&r, &r, b);
+	}
+	while(pal_comparar(r.d, r.n, b->d, b->n) >= 0){
+		bigint_somar(&t, &t, &x);
+		bigint_subtrair(&r, &r, b);
+	}
+
+	bigint_trocar(q, &t);
+	bigint_liberar(&x);
+	bigint_liberar(&t);
+	bigint_liberar(&r);
+}
+
+/* r = floor(sqrt(a)) para a >= 0: raiz da metade mais significativa seguida de passos de Newton x' = (x + a/x)/2 */
+void bigint_raiz(bigint_t *r, const bigint_t *a){
+	bigint_t x, y, t;
+	bigint_iniciar(&x);
+	bigint_iniciar(&y);
+	bigint_iniciar(&t);
+
+	if(a->n <= 2){ // Cabe em 64 bits
+		uint64_t v = a->n ? a->d[0] + (a->n > 1 ? (uint64_t)a->d[1]*BIGINT_BASE : 0) : 0;
+		uint64_t s = (uint64_t)sqrtl((long double)v);
+		while(s*s > v)
+			s--;
+		while((s + 1)*(s + 1) <= v)
+			s++;
+		bigint_definir_u64(r, s);
+	} else{
+		size_t k = (a->n - 1)/2;
+		bigint_deslocar(&t, a, -(long)(2*k));
+		bigint_raiz(&x, &t);
+		bigint_deslocar(&x, &x, k); // Aproximação com metade da precisão
+
+		/* Após o primeiro passo x >= floor(sqrt(a)), e os passos seguintes decrescem até a raiz */
+		bigint_dividir(&t, a, &x);
+		bigint_somar(&x, &x, &t);
+		bigint_multiplicar_u32(&x, &x, BIGINT_BASE/2);
+		bigint_deslocar(&x, &x, -1); // x/2
+		while(1){
+			bigint_dividir(&t, a, &x);
+			bigint_somar(&y, &x, &t);
+			bigint_multiplicar_u32(&y, &y, BIGINT_BASE/2);
+			bigint_deslocar(&y, &y, -1);
+			if(bigint_comparar(&y, &x) >= 0)
+				break;
+			bigint_trocar(&x, &y);
+		}
+		bigint_trocar(r, &x);
+	}
+
+	bigint_liberar(&x);
+	bigint_liberar(&y);
+	bigint_liberar(&t);
+}
+
+/* Representação decimal (alocada com malloc) */
+char *bigint_decimal(const bigint_t *a){
+	char *s = (char *)malloc(a->n*BIGINT_DIGITOS + 3);
+	char *p = s;
+
+	if(!s){
+		perror("ERROR: bigint");
+		exit(EXIT_FAILURE);
+	}
+	if(a->n == 0){
+		strcpy(s, "0");
+		return s;
+	}
+	if(a->neg)
+		*p++ = '-';
+	p += sprintf(p, "%u", a->d[a->n-1]);
+	for(size_t i=a->n-1; i-- > 0;)
+		p += sprintf(p, "%09u", a->d[i]);
+	return s;
+}
@@ -0,0 +1,46 @@
+/* Inteiros de precisão arbitrária
+
+Os números são guardados em palavras de base BIGINT_BASE = 10^9 (9 dígitos decimais por palavra,
+da menos para a mais significativa), o que torna a conversão para texto direta. A multiplicação
+escolhe o algoritmo pelo tamanho dos operandos: escolar, Karatsuba, Toom-3 e, para os maiores,
+a NTT com três primos (ntt.h); a divisão e a raiz quadrada usam a iteração de Newton, então
+custam algumas multiplicações. As palavras são alocadas por memoria.h, que pode mantê-las em
+arquivos mapeados quando excedem o orçamento de RAM; nesse caso os produtos acima do tamanho
+máximo da NTT são feitos em passagens sequenciais por blocos em vez do Toom-3. */
+
+#ifndef BIGINT_H
+#define BIGINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BIGINT_BASE 1000000000u // Base das palavras
+#define BIGINT_DIGITOS 9 // Dígitos decimais por palavra
+
+typedef struct{
+	uint32_t *d; // Palavras, da menos significativa para a mais significativa
+	size_t n; // Palavras em uso (0 = zero)
+	size_t cap; // Palavras alocadas
+	int neg; // 1 se o número é negativo
+} bigint_t;
+
+void bigint_definir_threads(int n);
+void bigint_iniciar(bigint_t *a);
+void bigint_liberar(bigint_t *a);
+void bigint_reservar(bigint_t *a, size_t n);
+void bigint_definir_u64(bigint_t *a, uint64_t v);
+void bigint_copiar(bigint_t *r, const bigint_t *a);
+void bigint_trocar(bigint_t *a, bigint_t *b);
+int bigint_comparar(const bigint_t *a, const bigint_t *b);
+
+void bigint_somar(bigint_t *r, const bigint_t *a, const bigint_t *b);
+void bigint_subtrair(bigint_t *r, const bigint_t *a, const bigint_t *b);
+void bigint_multiplicar(bigint_t *r, const bigint_t *a, const bigint_t *b);
+void bigint_multiplicar_u32(bigint_t *r, const bigint_t *a, uint32_t m);
+void bigint_deslocar(bigint_t *r, const bigint_t *a, long palavras);
+void bigint_dividir(bigint_t *q, const bigint_t *a, const bigint_t *b);
+void bigint_raiz(bigint_t *r, const bigint_t *a);
+
+char *bigint_decimal(const bigint_t *a);
+
+#endif
@@ -0,0 +1,299 @@
+/* Canal de memória compartilhada entre o servidor e os clientes da mesma máquina (ver canal.h) */
+
+#define _GNU_SOURCE // memfd_create
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "canal.h"
+#include "montecarlo.h"
+
+#define CANAL_NOME "pi-canal-%d" // Nome abstrato do socket unix (sem arquivo no disco)
+#define CANAL_VERSAO 1
+
+_Static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "os contadores dos anéis são compartilhados entre processos");
+
+/* Anel de um produtor e um consumidor. Os contadores crescem sem voltar a zero; a posição é o contador
+módulo CANAL_TAM_ANEL */
+typedef struct{
+	_Alignas(MC_LINHA_CACHE) _Atomic uint64_t escrito; // Gravado somente pelo produtor
+	_Alignas(MC_LINHA_CACHE) _Atomic uint64_t lido; // Gravados somente pelo consumidor
+	atomic_int dormindo; // O consumidor aguarda a campainha no socket
+	_Alignas(MC_LINHA_CACHE) uint8_t dados[CANAL_TAM_ANEL];
+} canal_anel_t;
+
+/* Conteúdo do memfd */
+typedef struct{
+	uint32_t versao;
+	canal_anel_t para_cliente, para_servidor;
+} canal_regiao_t;
+
+struct canal{
+	canal_regiao_t *regiao;
+	canal_anel_t *entrada, *saida;
+	uint64_t lido, escrito; // Cópias dos próprios contadores (os da memória compartilhada não são confiáveis)
+	int sock; // Socket unix da conexão (campainha); não é fechado por canal_fechar
+};
+
+/* Pausa curta entre duas verificações do anel */
+static inline void canal_pausa(void){
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+static void canal_endereco(struct sockaddr_un *end, socklen_t *tam, int porta){
+	memset(end, 0, sizeof(*end));
+	end->sun_family = AF_UNIX;
+	int n = snprintf(end->sun_path + 1, sizeof(end->sun_path) - 1, CANAL_NOME, porta); // sun_path[0] = 0: nome abstrato
+	*tam = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + n);
+}
+
+/* Socket de escuta dos clientes locais (não bloqueante). Retorna -1 em caso de erro */
+int canal_escutar(int porta){
+	struct sockaddr_un end;
+	socklen_t tam;
+
+	int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if(sock < 0)
+		return -1;
+	canal_endereco(&end, &tam, porta);
+	if(bind(sock, (struct sockaddr *)&end, tam) < 0 || listen(sock, SOMAXCONN) < 0){
+		close(sock);
+		return -1;
+	}
+	return sock;
+}
+
+static canal_t *canal_mapear(int memfd, int sock, int servidor){
+	struct stat st;
+	if(fstat(memfd, &st) < 0 || st.st_size != (off_t)sizeof(canal_regiao_t))
+		return NULL;
+
+	canal_t *c = (canal_t *)calloc(1, sizeof(canal_t));
+	if(!c)
+		return NULL;
+	c->regiao = (canal_regiao_t *)mmap(NULL, sizeof(canal_regiao_t), PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+	if(c->regiao == MAP_FAILED){
+		free(c);
+		return NULL;
+	}
+	c->entrada = servidor ? &c->regiao->para_servidor : &c->regiao->para_cliente;
+	c->saida = servidor ? &c->regiao->para_cliente : &c->regiao->para_servidor;
+	c->sock = sock;
+	return c;
+}
+
+/* Cria o canal da conexão aceita no socket de canal_escutar e envia o memfd ao cliente. Retorna NULL em caso de erro */
+canal_t *canal_aceitar(int sock){
+	int memfd = memfd_create("pi-canal", MFD_CLOEXEC);
+	if(memfd < 0)
+		return NULL;
+	if(ftruncate(memfd, sizeof(canal_regiao_t)) < 0){
+		close(memfd);
+		return NULL;
+	}
+	canal_t *c = canal_mapear(memfd, sock, 1);
+	if(!c){
+		close(memfd);
+		return NULL;
+	}
+	c->regiao->versao = CANAL_VERSAO;
+	atomic_store(&c->entrada->dormindo, 1); // O servidor aguarda no epoll
+
+	/* Um byte de dados com o memfd anexado */
+	uint8_t versao = CANAL_VERSAO;
+	struct iovec iov = {&versao, 1};
+	union{
+		struct cmsghdr cab;
+		char buf[CMSG_SPACE(sizeof(int))];
+	} controle;
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	memset(&controle, 0, sizeof(controle));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = controle.buf;
+	msg.msg_controllen = sizeof(controle.buf);
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+
+	ssize_t enviado = sendmsg(sock, &msg, MSG_NOSIGNAL); // O buffer do socket recém-aceito está vazio
+	close(memfd); // O mapeamento continua válido
+	if(enviado != 1){
+		canal_fechar(c);
+		return NULL;
+	}
+	return c;
+}
+
+/* Conecta-se ao servidor local da porta e recebe o canal. Retorna NULL se não há servidor local
+(o cliente usa TCP) */
+canal_t *canal_conectar(int porta){
+	struct sockaddr_un end;
+	socklen_t tam;
+
+	int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if(sock < 0)
+		return NULL;
+	canal_endereco(&end, &tam, porta);
+	if(connect(sock, (struct sockaddr *)&end, tam) < 0){
+		close(sock);
+		return NULL;
+	}
+
+	uint8_t versao = 0;
+	struct iovec iov = {&versao, 1};
+	union{
+		struct cmsghdr cab;
+		char buf[CMSG_SPACE(sizeof(int))];
+	} controle;
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = controle.buf;
+	msg.msg_controllen = sizeof(controle.buf);
+
+	ssize_t recebido;
+	do{
+		recebido = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+	} while(recebido < 0 && errno == EINTR);
+
+	struct cmsghdr *cmsg = (recebido == 1) ? CMSG_FIRSTHDR(&msg) : NULL;
+	int memfd = -1;
+	if(cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+		memcpy(&memfd, CMSG_DATA(cmsg), sizeof(int));
+
+	canal_t *c = NULL;
+	if(memfd >= 0 && versao == CANAL_VERSAO){
+		c = canal_mapear(memfd, sock, 0);
+		if(c && c->regiao->versao != CANAL_VERSAO){
+			canal_fechar(c);
+			c = NULL;
+		}
+	}
+	if(memfd >= 0)
+		close(memfd);
+	if(!c)
+		close(sock);
+	return c;
+}
+
+int canal_socket(const canal_t *c){
+	return c->sock;
+}
+
+/* Copia para o anel de saída o que couber, sem bloquear, e toca a campainha se o outro lado dorme.
+Retorna os bytes copiados (0 com o anel cheio), ou -1 se o outro lado corrompeu o anel ou fechou o socket */
+ssize_t canal_enviar(canal_t *c, const void *buf, size_t n){
+	canal_anel_t *a = c->saida;
+	uint64_t ocupado = c->escrito - atomic_load_explicit(&a->lido, memory_order_acquire);
+	if(ocupado > CANAL_TAM_ANEL){
+		errno = EPROTO;
+		return -1;
+	}
+
+	size_t k = CANAL_TAM_ANEL - ocupado;
+	if(k > n)
+		k = n;
+	size_t pos = c->escrito & (CANAL_TAM_ANEL - 1), primeiro = (k < CANAL_TAM_ANEL - pos) ? k : CANAL_TAM_ANEL - pos;
+	memcpy(a->dados + pos, buf, primeiro);
+	memcpy(a->dados, (const uint8_t *)buf + primeiro, k - primeiro);
+	c->escrito += k;
+	atomic_store(&a->escrito, c->escrito); // seq_cst: ordenado antes da leitura de dormindo (ver canal_receber)
+
+	if(k > 0 && atomic_load(&a->dormindo)){
+		uint8_t campainha = 0;
+		if(send(c->sock, &campainha, 1, MSG_DONTWAIT | MSG_NOSIGNAL) < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			return -1; // Com o socket cheio o outro lado já tem campainhas a atender
+	}
+	return (ssize_t)k;
+}
+
+/* Envia todos os bytes, aguardando espaço no anel. Retorna -1 se a conexão falhou */
+int canal_enviar_tudo(canal_t *c, const void *buf, size_t n){
+	const uint8_t *p = (const uint8_t *)buf;
+	while(n > 0){
+		ssize_t k = canal_enviar(c, p, n);
+		if(k < 0)
+			return -1;
+		if(k == 0)
+			sched_yield(); // Anel cheio: o outro lado consome a cada evento
+		p += k;
+		n -= (size_t)k;
+	}
+	return 0;
+}
+
+/* Copia do anel de entrada até n bytes. Retorna os bytes copiados ou -1 se o anel está corrompido */
+static ssize_t canal_copiar(canal_t *c, void *buf, size_t n){
+	canal_anel_t *a = c->entrada;
+	uint64_t disponivel = atomic_load(&a->escrito) - c->lido; // seq_cst: ordenado depois da escrita de dormindo
+	if(disponivel > CANAL_TAM_ANEL){
+		errno = EPROTO;
+		return -1;
+	}
+
+	size_t k = (disponivel < n) ? (size_t)disponivel : n;
+	size_t pos = c->lido & (CANAL_TAM_ANEL - 1), primeiro = (k < CANAL_TAM_ANEL - pos) ? k : CANAL_TAM_ANEL - pos;
+	memcpy(buf, a->dados + pos, primeiro);
+	memcpy((uint8_t *)buf + primeiro, a->dados, k - primeiro);
+	c->lido += k;
+	atomic_store_explicit(&a->lido, c->lido, memory_order_release);
+	return (ssize_t)k;
+}
+
+/* Recebe até n bytes, como o recv: retorna os bytes recebidos, 0 se o outro lado fechou o socket e -1 em
+caso de erro (errno EAGAIN sem dados e sem bloquear). Para bloquear o consumidor marca o anel, confere
+de novo (o produtor grava o contador antes de ler a marca, então um dos dois vê o outro) e dorme no socket */
+ssize_t canal_receber(canal_t *c, void *buf, size_t n, int bloquear){
+	int giros = (bloquear && mc_num_cpus() > 1) ? CANAL_GIROS : 0;
+
+	while(1){
+		ssize_t k = canal_copiar(c, buf, n);
+		if(k != 0){
+			atomic_store(&c->entrada->dormindo, 0);
+			return k;
+		}
+		if(giros > 0){
+			giros--;
+			canal_pausa();
+			continue;
+		}
+
+		atomic_store(&c->entrada->dormindo, 1);
+		k = canal_copiar(c, buf, n);
+		if(k != 0){
+			atomic_store(&c->entrada->dormindo, 0);
+			return k;
+		}
+
+		uint8_t campainha[64]; // Descarta as campainhas acumuladas
+		ssize_t r = recv(c->sock, campainha, sizeof(campainha), bloquear ? 0 : MSG_DONTWAIT);
+		if(r == 0)
+			return 0;
+		if(r < 0 && errno != EINTR)
+			return -1;
+	}
+}
+
+/* Desfaz o mapeamento (o socket é fechado por quem o criou ou aceitou) */
+void canal_fechar(canal_t *c){
+	if(!c)
+		return;
+	munmap(c->regiao, sizeof(canal_regiao_t));
+	free(c);
+}
@@ -0,0 +1,38 @@
+/* Canal de memória compartilhada entre o servidor e os clientes da mesma máquina
+
+O servidor escuta, além da porta TCP, o socket unix abstrato "@pi-canal-<porta>". Um cliente local que
+se conecta a ele recebe (SCM_RIGHTS) um memfd com dois anéis de bytes, um em cada direção, e a partir daí
+os quadros do protocolo (protocolo.h) passam pelos anéis em vez do socket. Sem servidor local (cliente
+em outra máquina, ou servidor antigo) a conexão unix falha e o cliente usa TCP, sem nenhuma mudança
+no protocolo.
+
+Cada anel tem um único produtor e um único consumidor, com contadores de bytes escritos e lidos; cada
+lado guarda uma cópia própria dos seus contadores e confere os do outro, então um processo que corrompa
+a memória compartilhada só consegue encerrar a própria conexão. O socket unix continua aberto e serve de
+campainha: o consumidor que vai dormir marca o anel (dormindo) e aguarda no socket, e o produtor só
+escreve um byte no socket se encontrar a marca. Antes de dormir, quem espera uma mensagem confere o anel
+por CANAL_GIROS voltas (somente com mais de um processador), então a entrega de um lote a um cliente
+ocioso não passa pelo núcleo. O fechamento do socket indica a saída do outro lado, como no TCP, e cada
+cliente ocupa um único descritor no epoll do servidor. */
+
+#ifndef CANAL_H
+#define CANAL_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define CANAL_TAM_ANEL 4096 // Bytes de cada anel (potência de 2, muitas vezes PROTO_TAM_MAX)
+#define CANAL_GIROS 100000 // Verificações do anel antes de dormir no socket
+
+typedef struct canal canal_t;
+
+int canal_escutar(int porta);
+canal_t *canal_aceitar(int sock);
+canal_t *canal_conectar(int porta);
+int canal_socket(const canal_t *c);
+ssize_t canal_enviar(canal_t *c, const void *buf, size_t n);
+int canal_enviar_tudo(canal_t *c, const void *buf, size_t n);
+ssize_t canal_receber(canal_t *c, void *buf, size_t n, int bloquear);
+void canal_fechar(canal_t *c);
+
+#endif
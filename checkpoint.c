@@ -0,0 +1,210 @@
+/* Checkpoints dos cálculos longos (ver checkpoint.h) */
+
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include "checkpoint.h"
+
+#define CKPT_IDENTIFICACAO "PICKPT\0\0"
+#define CKPT_TAM_CABECALHO 16 // Identificação (8) + versão (4) + tipo (4)
+#define CKPT_PALAVRAS_BUFFER 4096 // Palavras convertidas de cada vez em ckpt_escrever_u32s e ckpt_ler_u32s
+
+#define FNV_BASE 0xcbf29ce484222325ULL
+#define FNV_PRIMO 0x100000001b3ULL
+
+static void ckpt_somar(ckpt_arquivo_t *c, const void *dados, size_t n){
+	const uint8_t *p = (const uint8_t *)dados;
+	for(size_t i=0; i<n; i++)
+		c->soma = (c->soma ^ p[i])*FNV_PRIMO;
+}
+
+static void ckpt_escrever(ckpt_arquivo_t *c, const void *dados, size_t n){
+	if(!c->erro && fwrite(dados, 1, n, c->f) != n)
+		c->erro = 1;
+	ckpt_somar(c, dados, n);
+}
+
+static void ckpt_ler(ckpt_arquivo_t *c, void *dados, size_t n){
+	if(c->erro || fread(dados, 1, n, c->f) != n){
+		memset(dados, 0, n);
+		c->erro = 1;
+		return;
+	}
+	ckpt_somar(c, dados, n);
+}
+
+static void ckpt_cabecalho(uint8_t *buf, ckpt_tipo_t tipo){
+	uint32_t versao = htobe32(CKPT_VERSAO), t = htobe32((uint32_t)tipo);
+	memcpy(buf, CKPT_IDENTIFICACAO, 8);
+	memcpy(buf + 8, &versao, 4);
+	memcpy(buf + 12, &t, 4);
+}
+
+/* Inicia a gravação de um checkpoint em "<arquivo>.tmp". Retorna -1 se o arquivo não pode ser criado */
+int ckpt_criar(ckpt_arquivo_t *c, const char *arquivo, ckpt_tipo_t tipo){
+	uint8_t cabecalho[CKPT_TAM_CABECALHO];
+
+	memset(c, 0, sizeof(*c));
+	c->arquivo = strdup(arquivo);
+	c->temporario = (char *)malloc(strlen(arquivo) + 5);
+	if(!c->arquivo || !c->temporario){
+		free(c->arquivo);
+		free(c->temporario);
+		return -1;
+	}
+	sprintf(c->temporario, "%s.tmp", arquivo);
+
+	c->f = fopen(c->temporario, "wb");
+	if(!c->f){
+		free(c->arquivo);
+		free(c->temporario);
+		return -1;
+	}
+
+	ckpt_cabecalho(cabecalho, tipo);
+	if(fwrite(cabecalho, 1, sizeof(cabecalho), c->f) != sizeof(cabecalho))
+		c->erro = 1;
+	c->soma = FNV_BASE;
+	return 0;
+}
+
+void ckpt_escrever_u64(ckpt_arquivo_t *c, uint64_t v){
+	v = htobe64(v);
+	ckpt_escrever(c, &v, 8);
+}
+
+/* Os doubles são gravados pelos seus bits, sem perda de precisão */
+void ckpt_escrever_double(ckpt_arquivo_t *c, double v){
+	uint64_t bits;
+	memcpy(&bits, &v, 8);
+	ckpt_escrever_u64(c, bits);
+}
+
+void ckpt_escrever_u32s(ckpt_arquivo_t *c, const uint32_t *v, size_t n){
+	uint32_t buf[CKPT_PALAVRAS_BUFFER];
+	for(size_t i=0; i<n; i+=CKPT_PALAVRAS_BUFFER){
+		size_t k = (n - i < CKPT_PALAVRAS_BUFFER) ? n - i : CKPT_PALAVRAS_BUFFER;
+		for(size_t j=0; j<k; j++)
+			buf[j] = htobe32(v[i + j]);
+		ckpt_escrever(c, buf, k*sizeof(uint32_t));
+	}
+}
+
+/* Grava a soma de verificação e substitui o checkpoint anterior. Retorna -1 em caso de erro
+(o checkpoint anterior é preservado) */
+int ckpt_concluir(ckpt_arquivo_t *c){
+	uint64_t soma = htobe64(c->soma);
+	int erro = c->erro || fwrite(&soma, 1, 8, c->f) != 8;
+
+	erro = (fflush(c->f) != 0) || erro;
+	erro = (fsync(fileno(c->f)) != 0) || erro;
+	erro = (fclose(c->f) != 0) || erro;
+	if(!erro)
+		erro = (rename(c->temporario, c->arquivo) != 0);
+	if(erro)
+		remove(c->temporario);
+
+	free(c->arquivo);
+	free(c->temporario);
+	return erro ? -1 : 0;
+}
+
+/* Abre um checkpoint do tipo informado, conferindo o cabeçalho e a soma de verificação.
+Retorna -1 se o arquivo não existe, é de outro tipo ou está corrompido */
+int ckpt_abrir(ckpt_arquivo_t *c, const char *arquivo, ckpt_tipo_t tipo){
+	uint8_t cabecalho[CKPT_TAM_CABECALHO], esperado[CKPT_TAM_CABECALHO], buf[1 << 16];
+
+	memset(c, 0, sizeof(*c));
+	c->f = fopen(arquivo, "rb");
+	if(!c->f)
+		return -1;
+
+	ckpt_cabecalho(esperado, tipo);
+	if(fread(cabecalho, 1, sizeof(cabecalho), c->f) != sizeof(cabecalho) || memcmp(cabecalho, esperado, sizeof(cabecalho)) != 0 ||
+	   fseeko(c->f, 0, SEEK_END) != 0 || ftello(c->f) < CKPT_TAM_CABECALHO + 8){
+		fclose(c->f);
+		return -1;
+	}
+
+	/* Confere a soma dos dados antes de entregar qualquer campo */
+	off_t restante = ftello(c->f) - CKPT_TAM_CABECALHO - 8;
+	uint64_t soma;
+	fseeko(c->f, CKPT_TAM_CABECALHO, SEEK_SET);
+	c->soma = FNV_BASE;
+	while(restante > 0 && !c->erro){
+		size_t k = (restante < (off_t)sizeof(buf)) ? (size_t)restante : sizeof(buf);
+		ckpt_ler(c, buf, k);
+		restante -= k;
+	}
+	if(c->erro || fread(&soma, 1, 8, c->f) != 8 || be64toh(soma) != c->soma){
+		fclose(c->f);
+		return -1;
+	}
+
+	c->fim_dados = ftello(c->f) - 8;
+	fseeko(c->f, CKPT_TAM_CABECALHO, SEEK_SET);
+	return 0;
+}
+
+uint64_t ckpt_ler_u64(ckpt_arquivo_t *c){
+	uint64_t v;
+	ckpt_ler(c, &v, 8);
+	return be64toh(v);
+}
+
+double ckpt_ler_double(ckpt_arquivo_t *c){
+	uint64_t bits = ckpt_ler_u64(c);
+	double v;
+	memcpy(&v, &bits, 8);
+	return v;
+}
+
+void ckpt_ler_u32s(ckpt_arquivo_t *c, uint32_t *v, size_t n){
+	for(size_t i=0; i<n; i+=CKPT_PALAVRAS_BUFFER){
+		size_t k = (n - i < CKPT_PALAVRAS_BUFFER) ? n - i : CKPT_PALAVRAS_BUFFER;
+		ckpt_ler(c, v + i, k*sizeof(uint32_t));
+		for(size_t j=0; j<k; j++)
+			v[i + j] = be32toh(v[i + j]);
+	}
+}
+
+/* Fecha o checkpoint lido. Retorna -1 se algum campo faltou ou sobrou */
+int ckpt_fechar(ckpt_arquivo_t *c){
+	int erro = c->erro || ftello(c->f) != c->fim_dados;
+	fclose(c->f);
+	return erro ? -1 : 0;
+}
+
+int ckpt_gravar_mc(const char *arquivo, const ckpt_mc_t *mc){
+	ckpt_arquivo_t c;
+	if(ckpt_criar(&c, arquivo, CKPT_MC) != 0)
+		return -1;
+	ckpt_escrever_u64(&c, mc->semente);
+	ckpt_escrever_u64(&c, mc->n_pontos);
+	ckpt_escrever_double(&c, mc->erro_alvo);
+	ckpt_escrever_double(&c, mc->confianca);
+	ckpt_escrever_u64(&c, mc->por_rodada);
+	ckpt_escrever_u64(&c, mc->bloco);
+	ckpt_escrever_u64(&c, mc->contagem.dentro);
+	ckpt_escrever_u64(&c, mc->contagem.total);
+	return ckpt_concluir(&c);
+}
+
+int ckpt_ler_mc(const char *arquivo, ckpt_mc_t *mc){
+	ckpt_arquivo_t c;
+	if(ckpt_abrir(&c, arquivo, CKPT_MC) != 0)
+		return -1;
+	mc->semente = ckpt_ler_u64(&c);
+	mc->n_pontos = ckpt_ler_u64(&c);
+	mc->erro_alvo = ckpt_ler_double(&c);
+	mc->confianca = ckpt_ler_double(&c);
+	mc->por_rodada = ckpt_ler_u64(&c);
+	mc->bloco = ckpt_ler_u64(&c);
+	mc->contagem.dentro = ckpt_ler_u64(&c);
+	mc->contagem.total = ckpt_ler_u64(&c);
+	if(ckpt_fechar(&c) != 0 || mc->por_rodada == 0 || mc->contagem.dentro > mc->contagem.total)
+		return -1;
+	return 0;
+}
@@ -0,0 +1,76 @@
+/* Checkpoints: estado dos cálculos longos gravado periodicamente para retomá-los após uma interrupção
+
+Formato do arquivo (inteiros em ordem de rede, big-endian):
+	char[8]  identificação "PICKPT\0\0"
+	uint32   versão (CKPT_VERSAO)
+	uint32   tipo (ckpt_tipo_t)
+	dados    campos do tipo
+	uint64   soma de verificação dos dados (FNV-1a)
+
+A gravação é feita em "<arquivo>.tmp", sincronizada com o disco e renomeada sobre o arquivo,
+então uma interrupção durante a gravação preserva o checkpoint anterior intacto.
+
+Monte Carlo: cada bloco utiliza sempre o mesmo fluxo do gerador (montecarlo.h), então a posição do
+gerador é o próprio número do bloco. O checkpoint guarda a semente, os blocos já sorteados e as
+contagens exatas, e a execução retomada produz o mesmo resultado que a ininterrupta. */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "montecarlo.h"
+
+#define CKPT_VERSAO 2
+#define CKPT_PERIODO 60.0 // Segundos entre dois checkpoints (padrão)
+
+typedef enum{
+	CKPT_MC = 1, // Monte Carlo em ordem de blocos (montecarlo_pi.c, pi_mpi.c)
+	CKPT_ESCALONADOR, // Lotes concluídos do servidor (escalonador.h)
+	CKPT_SERIE // Subárvore da série de Chudnovsky (chudnovsky.h)
+} ckpt_tipo_t;
+
+/* Monte Carlo em ordem de blocos: blocos [0, bloco) sorteados */
+typedef struct{
+	uint64_t semente;
+	uint64_t n_pontos;
+	double erro_alvo, confianca; // Critério de parada do modo progressivo
+	uint64_t por_rodada; // Blocos entre duas verificações da convergência (a parada depende dele)
+	uint64_t bloco;
+	mc_resultado_t contagem; // Pontos dos blocos [0, bloco)
+} ckpt_mc_t;
+
+/* Opções de checkpoint dos programas */
+typedef struct{
+	const char *arquivo; // NULL = sem checkpoints
+	double periodo; // Segundos entre dois checkpoints
+	int retomar; // Continua a partir do checkpoint existente
+} ckpt_config_t;
+
+/* Arquivo aberto para gravação ou leitura */
+typedef struct{
+	FILE *f;
+	char *arquivo, *temporario;
+	uint64_t soma; // FNV-1a dos dados gravados ou lidos
+	off_t fim_dados; // Leitura: posição da soma de verificação, logo após o último campo
+	int erro;
+} ckpt_arquivo_t;
+
+int ckpt_criar(ckpt_arquivo_t *c, const char *arquivo, ckpt_tipo_t tipo);
+void ckpt_escrever_u64(ckpt_arquivo_t *c, uint64_t v);
+void ckpt_escrever_double(ckpt_arquivo_t *c, double v);
+void ckpt_escrever_u32s(ckpt_arquivo_t *c, const uint32_t *v, size_t n);
+int ckpt_concluir(ckpt_arquivo_t *c);
+
+int ckpt_abrir(ckpt_arquivo_t *c, const char *arquivo, ckpt_tipo_t tipo);
+uint64_t ckpt_ler_u64(ckpt_arquivo_t *c);
+double ckpt_ler_double(ckpt_arquivo_t *c);
+void ckpt_ler_u32s(ckpt_arquivo_t *c, uint32_t *v, size_t n);
+int ckpt_fechar(ckpt_arquivo_t *c);
+
+int ckpt_gravar_mc(const char *arquivo, const ckpt_mc_t *mc);
+int ckpt_ler_mc(const char *arquivo, ckpt_mc_t *mc);
+
+#endif
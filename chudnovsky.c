@@ -0,0 +1,215 @@
+/* Cálculo de PI pela série de Chudnovsky (ver chudnovsky.h) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "bigint.h"
+#include "checkpoint.h"
+#include "chudnovsky.h"
+
+#define DIGITOS_POR_TERMO 14.181647462725477 // log10(640320^3/1728)
+#define PALAVRAS_GUARDA 2 // Palavras extras de precisão, absorvem o erro de truncamento do ponto fixo
+#define NIVEL_CHECKPOINT 5 // Nível da árvore cujas subárvores (até 2^5) são gravadas em checkpoints
+
+/* Intervalo [a, b) de termos da série e os seus inteiros P, Q e T */
+typedef struct{
+	uint64_t a, b;
+	int profundidade; // Níveis restantes em que as metades são calculadas por threads diferentes
+	int precisa_p; // O intervalo mais à direita não precisa de P
+	int nivel; // Distância até a raiz
+	const char *checkpoint; // Prefixo dos checkpoints (NULL = sem checkpoints)
+	int retomar; // Reaproveita as subárvores gravadas
+	bigint_t P, Q, T;
+} cd_intervalo_t;
+
+static void cd_nome_checkpoint(char *nome, size_t tam, const char *prefixo, uint64_t a, uint64_t b){
+	snprintf(nome, tam, "%s.%llu-%llu", prefixo, (unsigned long long)a, (unsigned long long)b);
+}
+
+static void cd_escrever_bigint(ckpt_arquivo_t *c, const bigint_t *x){
+	ckpt_escrever_u64(c, x->n);
+	ckpt_escrever_u64(c, (uint64_t)x->neg);
+	ckpt_escrever_u32s(c, x->d, x->n);
+}
+
+static void cd_ler_bigint(ckpt_arquivo_t *c, bigint_t *x){
+	uint64_t n = ckpt_ler_u64(c);
+	x->neg = (int)ckpt_ler_u64(c);
+	if(c->erro || n > ((uint64_t)1 << 40)) // Tamanho inválido: o arquivo é rejeitado por ckpt_fechar
+		n = 0, c->erro = 1;
+	bigint_reservar(x, (size_t)n);
+	ckpt_ler_u32s(c, x->d, (size_t)n);
+	x->n = (size_t)n;
+}
+
+/* Grava P, Q e T do intervalo (uma falha não interrompe o cálculo) */
+static void cd_gravar_checkpoint(const cd_intervalo_t *s){
+	char nome[4096];
+	ckpt_arquivo_t c;
+
+	cd_nome_checkpoint(nome, sizeof(nome), s->checkpoint, s->a, s->b);
+	if(ckpt_criar(&c, nome, CKPT_SERIE) == 0){
+		ckpt_escrever_u64(&c, s->a);
+		ckpt_escrever_u64(&c, s->b);
+		ckpt_escrever_u64(&c, (uint64_t)s->precisa_p);
+		cd_escrever_bigint(&c, &s->P);
+		cd_escrever_bigint(&c, &s->Q);
+		cd_escrever_bigint(&c, &s->T);
+		if(ckpt_concluir(&c) == 0)
+			return;
+	}
+	fprintf(stderr, "AVISO: não foi possível gravar o checkpoint %s\n", nome);
+}
+
+/* Lê P, Q e T do intervalo gravados por uma execução anterior. Retorna -1 se não existem */
+static int cd_ler_checkpoint(cd_intervalo_t *s){
+	char nome[4096];
+	ckpt_arquivo_t c;
+
+	cd_nome_checkpoint(nome, sizeof(nome), s->checkpoint, s->a, s->b);
+	if(ckpt_abrir(&c, nome, CKPT_SERIE) != 0)
+		return -1;
+	int valido = (ckpt_ler_u64(&c) == s->a && ckpt_ler_u64(&c) == s->b && (ckpt_ler_u64(&c) || !s->precisa_p));
+	if(valido){
+		cd_ler_bigint(&c, &s->P);
+		cd_ler_bigint(&c, &s->Q);
+		cd_ler_bigint(&c, &s->T);
+	}
+	return (ckpt_fechar(&c) == 0 && valido) ? 0 : -1;
+}
+
+/* Remove os checkpoints das subárvores ao final do cálculo */
+static void cd_remover_checkpoints(const char *prefixo, uint64_t a, uint64_t b, int nivel){
+	char nome[4096];
+
+	if(b - a <= 1)
+		return;
+	if(nivel == NIVEL_CHECKPOINT){
+		cd_nome_checkpoint(nome, sizeof(nome), prefixo, a, b);
+		remove(nome);
+		return;
+	}
+	uint64_t m = a + (b - a)/2;
+	cd_remover_checkpoints(prefixo, a, m, nivel + 1);
+	cd_remover_checkpoints(prefixo, m, b, nivel + 1);
+}
+
+/* Divisão binária: P(a,b) = P(a,m)P(m,b), Q(a,b) = Q(a,m)Q(m,b) e T(a,b) = Q(m,b)T(a,m) + P(a,m)T(m,b) */
+static void *cd_dividir(void *arg){
+	cd_intervalo_t *s = (cd_intervalo_t *)arg;
+	uint64_t a = s->a;
+
+	if(s->b - a == 1){ // Termo a
+		if(a == 0){
+			bigint_definir_u64(&s->P, 1);
+			bigint_definir_u64(&s->Q, 1);
+		} else{
+			bigint_definir_u64(&s->P, 6*a - 5); // (6a-5)(2a-1)(6a-1)
+			bigint_multiplicar_u32(&s->P, &s->P, (uint32_t)(2*a - 1));
+			bigint_multiplicar_u32(&s->P, &s->P, (uint32_t)(6*a - 1));
+			bigint_definir_u64(&s->Q, a); // a^3 * 640320^3/24
+			bigint_multiplicar_u32(&s->Q, &s->Q, (uint32_t)a);
+			bigint_multiplicar_u32(&s->Q, &s->Q, (uint32_t)a);
+			bigint_multiplicar_u32(&s->Q, &s->Q, 640320);
+			bigint_multiplicar_u32(&s->Q, &s->Q, 640320);
+			bigint_multiplicar_u32(&s->Q, &s->Q, 640320/24);
+		}
+		bigint_definir_u64(&s->T, 13591409 + 545140134*a);
+		bigint_multiplicar(&s->T, &s->T, &s->P);
+		if(a & 1)
+			s->T.neg = 1;
+		return NULL;
+	}
+
+	int gravar = (s->checkpoint && s->nivel == NIVEL_CHECKPOINT);
+	if(gravar && s->retomar && cd_ler_checkpoint(s) == 0) // Subárvore concluída antes da interrupção
+		return NULL;
+
+	cd_intervalo_t esq, dir;
+	uint64_t m = a + (s->b - a)/2;
+	memset(&esq, 0, sizeof(esq));
+	memset(&dir, 0, sizeof(dir));
+	esq.a = a; esq.b = m; esq.precisa_p = 1;
+	dir.a = m; dir.b = s->b; dir.precisa_p = s->precisa_p;
+	esq.profundidade = dir.profundidade = s->profundidade - 1;
+	esq.nivel = dir.nivel = s->nivel + 1;
+	esq.checkpoint = dir.checkpoint = s->checkpoint;
+	esq.retomar = dir.retomar = s->retomar;
+
+	/* Nos níveis superiores a metade esquerda é calculada por uma nova thread */
+	pthread_t thread;
+	int paralelo = (s->profundidade > 0 && pthread_create(&thread, NULL, cd_dividir, &esq) == 0);
+	if(!paralelo)
+		cd_dividir(&esq);
+	cd_dividir(&dir);
+	if(paralelo)
+		pthread_join(thread, NULL);
+
+	bigint_multiplicar(&s->T, &dir.Q, &esq.T);
+	bigint_multiplicar(&esq.T, &esq.P, &dir.T);
+	bigint_somar(&s->T, &s->T, &esq.T);
+	bigint_multiplicar(&s->Q, &esq.Q, &dir.Q);
+	if(s->precisa_p)
+		bigint_multiplicar(&s->P, &esq.P, &dir.P);
+
+	bigint_liberar(&esq.P); bigint_liberar(&esq.Q); bigint_liberar(&esq.T);
+	bigint_liberar(&dir.P); bigint_liberar(&dir.Q); bigint_liberar(&dir.T);
+
+	if(gravar)
+		cd_gravar_checkpoint(s);
+	return NULL;
+}
+
+/* Retorna PI com a quantidade de casas decimais informada ("3.1415..."), alocado com malloc. Com checkpoint
+as subárvores concluídas são gravadas em "<checkpoint>.<a>-<b>" e, com retomar, reaproveitadas */
+char *chudnovsky_pi(uint64_t digitos, int n_threads, const char *checkpoint, int retomar){
+	uint64_t n_termos = (uint64_t)(digitos/DIGITOS_POR_TERMO) + 2;
+	size_t palavras = (size_t)((digitos + BIGINT_DIGITOS - 1)/BIGINT_DIGITOS) + PALAVRAS_GUARDA;
+	cd_intervalo_t raiz;
+	bigint_t s, pi;
+
+	memset(&raiz, 0, sizeof(raiz));
+	raiz.a = 0;
+	raiz.b = n_termos;
+	raiz.precisa_p = 0;
+	raiz.checkpoint = checkpoint;
+	raiz.retomar = retomar;
+	for(int t=1; t<n_threads; t*=2) // 2^profundidade >= n_threads subárvores paralelas
+		raiz.profundidade++;
+	bigint_definir_threads(n_threads); // Multiplicações dos níveis superiores, que são sequenciais
+
+	cd_dividir(&raiz);
+
+	/* PI*B^palavras = 426880 * sqrt(10005*B^2palavras) * Q / T */
+	bigint_iniciar(&s);
+	bigint_iniciar(&pi);
+	bigint_definir_u64(&s, 10005);
+	bigint_deslocar(&s, &s, 2*palavras);
+	bigint_raiz(&s, &s);
+	bigint_multiplicar_u32(&s, &s, 426880);
+	bigint_multiplicar(&s, &s, &raiz.Q);
+	bigint_dividir(&pi, &s, &raiz.T);
+
+	/* Descarta as palavras de guarda e formata "3." seguido das casas decimais */
+	char *texto = bigint_decimal(&pi);
+	size_t n = strlen(texto);
+	char *resultado = (char *)malloc(digitos + 3);
+	if(resultado){
+		resultado[0] = texto[0];
+		resultado[1] = '.';
+		memcpy(resultado + 2, texto + 1, (digitos < n - 1) ? digitos : n - 1);
+		resultado[2 + digitos] = '\0';
+	}
+
+	free(texto);
+	bigint_liberar(&s);
+	bigint_liberar(&pi);
+	bigint_liberar(&raiz.P);
+	bigint_liberar(&raiz.Q);
+	bigint_liberar(&raiz.T);
+	if(checkpoint && resultado)
+		cd_remover_checkpoints(checkpoint, 0, n_termos, 0);
+
+	return resultado;
+}
@@ -0,0 +1,21 @@
+/* Cálculo determinístico de PI pela série de Chudnovsky
+
+	1/PI = 12 * soma_k (-1)^k (6k)! (13591409 + 545140134k) / ((3k)! (k!)^3 640320^(3k + 3/2))
+
+Cada termo acrescenta cerca de 14,18 dígitos. A soma é avaliada por divisão binária
+(binary splitting) em inteiros exatos P, Q e T (bigint.h); as duas metades de cada
+intervalo são independentes e os níveis superiores da árvore são calculados por threads
+diferentes. Ao final, PI = 426880 * sqrt(10005) * Q / T em ponto fixo.
+
+Checkpoints: P, Q e T das subárvores de um nível fixo da árvore (até 32 intervalos consecutivos de
+termos) são gravados ao serem concluídos (checkpoint.h), e a execução retomada lê as subárvores
+prontas em vez de recalculá-las. Os arquivos são removidos quando PI fica pronto. */
+
+#ifndef CHUDNOVSKY_H
+#define CHUDNOVSKY_H
+
+#include <stdint.h>
+
+char *chudnovsky_pi(uint64_t digitos, int n_threads, const char *checkpoint, int retomar);
+
+#endif
@@ -1,8 +1,13 @@
 /* COMPILAÇÃO:
-gcc -pthread -o client client.c
+gcc -O2 -pthread -o client client.c protocolo.c canal.c montecarlo.c topologia.c -lm
+(marcadores de perfil em cada lote: -DMETRICAS_SDT, ou -DMETRICAS_ITT ... -littnotify, ver metricas.h)
 
 EXECUÇÃO:
-./server [port] */
+./client [port] [-t threads] [-T] [-a afinidade]
+
+Cada lote recebido do servidor é dividido entre as threads do pool (padrão: todos os processadores).
+Com o servidor na mesma máquina as mensagens passam por memória compartilhada (canal.h); -T força o TCP.
+Com -a compacta, espalhada ou fisica as threads do pool ficam fixadas nas CPUs (topologia.h) */
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,60 +15,133 @@ EXECUÇÃO:
 #include <string.h>
 #include <signal.h>
 #include <unistd.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <pthread.h>
 #include <time.h>
+#include "montecarlo.h"
+#include "protocolo.h"
+#include "metricas.h"
+#include "canal.h"
+#include "topologia.h"
 
 #define LENGTH 2048 // Tamanho do buffer
+#define INTERVALO_PARCIAL 0.5 // Segundos entre duas contagens parciais enviadas ao servidor (o sinal de vida do cliente)
+#define BLOCOS_PASSO 16 // Blocos por thread entre duas verificações do progresso
 
 /* Variáveis globais */
-volatile sig_atomic_t flag = 0;
+int flag = 0; // Cliente encerrando (mutex_flag)
+pthread_mutex_t mutex_flag = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t cond_flag = PTHREAD_COND_INITIALIZER; // Sinalizada quando flag se torna 1
 long int sockfd = 0;
+canal_t *canal = NULL; // Anéis em memória compartilhada com o servidor local (NULL = TCP)
 char name[32]; // Nome do cliente
-
-
-
-/* Gera coordenadas para o Método de Monte Carlo */
-double gera_coord(){ // Utiliza somente a parte decimal, visto que 0<x,y<1
-	double aux = 100.0*((double)(rand())/RAND_MAX);
-	aux = aux-(int)(aux);
-
-	return aux; // Retorna coordenada com valor entre 0 e 1
+proto_leitor_t leitor = {0}; // Buffer das mensagens recebidas do servidor
+mc_pool_t *pool; // Threads que realizam o sorteio dos lotes
+pthread_mutex_t mutex_pool = PTHREAD_MUTEX_INITIALIZER; // Travado durante cada passo do sorteio
+
+/* Recebe bytes do servidor pelo canal ou pelo socket, como o recv */
+ssize_t recebe(void *buf, size_t n, int bloquear){
+	if(canal)
+		return canal_receber(canal, buf, n, bloquear);
+	return recv(sockfd, buf, n, bloquear ? 0 : MSG_DONTWAIT);
 }
 
-/* Realiza o cálculo do valor PI com o Método de Monte Carlo */
-double montecarlo_pi(long long int N_PONTOS){
-	double x = 0, y = 0; // Coordenadas
-	long long int i = 0, pdentro = 0, pfora = 0; // Pontos dentro e fora do círculo
-	double valor_pi = 0; // Valor do PI que será retornado
-
-	puts("\n>Calculando valor de PI pelo Método de Monte Carlo...");
+/* Envia um quadro ao servidor pelo canal ou pelo socket. Retorna -1 se a conexão falhou */
+int envia(const uint8_t *buf, size_t n){
+	if(canal)
+		return canal_enviar_tudo(canal, buf, n);
+	while(n > 0){
+		ssize_t enviado = send(sockfd, buf, n, MSG_NOSIGNAL);
+		if(enviado < 0){
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += enviado;
+		n -= enviado;
+	}
+	return 0;
+}
 
-	for(i=0; i<N_PONTOS; i++){
-		x = gera_coord(); // Gera coordenada x do ponto
-		y = gera_coord(); // Gera coordenada y do ponto
+/* Lê a próxima mensagem do servidor (bloqueia). Retorna 1 se recebeu uma mensagem, 0 se a conexão foi encerrada e -1 em caso de erro */
+int le_mensagem(proto_msg_t *msg){
+	while(1){
+		int r = proto_extrair(&leitor, msg);
+		if(r != 0)
+			return r;
+
+		size_t livre;
+		uint8_t *espaco = proto_espaco(&leitor, &livre);
+		ssize_t recebido = recebe(espaco, livre, 1);
+		if(recebido == 0)
+			return 0;
+		if(recebido < 0){
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		leitor.n += recebido;
+	}
+}
 
-		//printf("P(%d) x=%.15f  y=%.15f \n", i,x,y); // Print auxiliar para verificar geração das coordenadas
-		
-		if((x*x + y*y) <= 1) // Soma os quadrados das coordenadas
-			pdentro++; // Se a soma dos quadrados <= 1, ponto caiu dentro
-		else
-			pfora++; // Se a soma dos quadrados > 1, ponto caiu fora
+/* Verifica, sem bloquear, se o servidor se desconectou durante o lote. Os bytes recebidos ficam no leitor,
+sem extrair as mensagens, que são tratadas depois por le_mensagem */
+int servidor_desconectou(){
+	size_t livre;
+	uint8_t *espaco = proto_espaco(&leitor, &livre);
+	if(livre == 0) // Leitor cheio: nada a receber até le_mensagem extrair as mensagens
+		return 0;
+
+	ssize_t n = recebe(espaco, livre, 0);
+	if(n > 0){
+		leitor.n += n;
+		return 0;
 	}
+	return n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+}
 
-	// Cálculo do PI
-	valor_pi = 4.0*(((double)pdentro)/((double)N_PONTOS));
+/* Realiza o cálculo do valor PI com o Método de Monte Carlo para os blocos do lote recebido, divididos entre
+as threads do pool. Retorna -1 se o servidor se desconectou antes do fim do lote ou se o estimador do lote é desconhecido */
+int montecarlo_pi(const lote_t *lote, mc_resultado_t *r){
+	double inicio = mc_relogio(), ultimo = inicio;
+	uint64_t passo = (uint64_t)mc_pool_threads(pool)*BLOCOS_PASSO;
+
+	r->dentro = r->total = 0; // Pontos dentro do círculo e pontos sorteados
+	pthread_mutex_lock(&mutex_pool);
+	int invalido = mc_selecionar_estimador((int)lote->estimador); // Estimador do trabalho do lote
+	pthread_mutex_unlock(&mutex_pool);
+	if(invalido)
+		return -1;
+	printf("\n>Lote %llu: calculando valor de PI pelo Método de Monte Carlo...", (unsigned long long)lote->id);
+
+	for(uint64_t b=lote->bloco_ini; b<lote->bloco_fim; b+=passo){ // Cada bloco utiliza o seu próprio fluxo do gerador
+		uint64_t fim = (lote->bloco_fim - b < passo) ? lote->bloco_fim : b + passo;
+		pthread_mutex_lock(&mutex_pool);
+		mc_resultado_t parcial = mc_pool_executar(pool, lote->semente, lote->n_pontos, b, fim);
+		pthread_mutex_unlock(&mutex_pool);
+		r->dentro += parcial.dentro;
+		r->total += parcial.total;
+
+		if(fim < lote->bloco_fim && mc_relogio() - ultimo >= INTERVALO_PARCIAL){ // Progresso para a estimativa do servidor
+			if(servidor_desconectou())
+				return -1;
+			uint8_t buf[PROTO_TAM_MAX];
+			envia(buf, proto_codificar_parcial(buf, lote->id, r));
+			ultimo = mc_relogio();
+		}
+	}
 
 	// Saída dos resultados
-	printf("\nPontos dentro: %llu", pdentro);
-	printf("\nPontos fora: %llu", pfora);
-	printf("\n[#]Valor de PI calculado = %.8lf", valor_pi);
-	puts("\n\n[#]Cálculo realizado com sucesso!\n");
+	double segundos = mc_relogio() - inicio;
+	printf("\nPontos dentro: %llu de %llu", (unsigned long long)r->dentro, (unsigned long long)r->total);
+	printf("\n[#]Valor de PI calculado = %.8lf", r->total ? 4.0*((double)r->dentro/(double)r->total) : 0.0);
+	printf("\n[#]Vazão: %.2f Mpontos/s (%.3f s)\n", segundos > 0 ? r->total/segundos/1e6 : 0.0, segundos);
 
-	return valor_pi; // Retorna o valor de PI que será enviado para o servidor
+	return 0; // A contagem exata de pontos será enviada para o servidor
 }
 
 /* Insere o terminador de string \0 */
@@ -79,7 +157,22 @@ void str_trim_lf (char* arr, int length) {
 
 // Ctrl+C para sair do programa
 void catch_ctrl_c_and_exit (int sig){
-    flag = 1;
+	pthread_mutex_lock(&mutex_flag);
+	flag = 1;
+	pthread_cond_signal(&cond_flag);
+	pthread_mutex_unlock(&mutex_flag);
+}
+
+/* Exibe os pontos sorteados por cada thread e a sua vazão (aguarda o fim do passo em andamento) */
+void exibe_vazao(){
+	pthread_mutex_lock(&mutex_pool);
+	for(int i=0; i<mc_pool_threads(pool); i++){
+		uint64_t pontos;
+		double segundos;
+		mc_pool_vazao(pool, i, &pontos, &segundos);
+		printf("[#]Thread %d: %llu pontos, %.2f Mpontos/s\n", i, (unsigned long long)pontos, segundos > 0 ? pontos/segundos/1e6 : 0.0);
+	}
+	pthread_mutex_unlock(&mutex_pool);
 }
 
 /* Responsabiliza-se pelo envio de mensagens*/
@@ -89,7 +182,8 @@ void send_msg_handler(){
 
   	while(1){
 		fflush(stdout);
-		fgets(message, LENGTH, stdin); // Recebe entrada do usuário
+		if(!fgets(message, LENGTH, stdin)) // Recebe entrada do usuário
+			return; // Entrada encerrada: segue calculando até o servidor desconectar-se
 		str_trim_lf(message, LENGTH);
 
 		if (strcmp(message, "exit") == 0){ // Verifica se o usuário desejou sair com "exit"
@@ -104,37 +198,50 @@ void send_msg_handler(){
 
 /* Responsabiliza-se pelo recebimento de mensagens */
 void recv_msg_handler() {
-	char message[LENGTH] = {};
-	double pi; // Variável para armazenar o valor de PI
-  	while (1){
-		long int receive = recv(sockfd, message, LENGTH, 0); //Recebe a mensagem enviada pelo servidor
-		long long int QTD_PONTOS = atol(message); // Recebe a quantidade de pontos e converte para long int
-		if (QTD_PONTOS != 0){
-			printf("Quantidade de pontos recebida: %llu\n", QTD_PONTOS);
-			pi = montecarlo_pi(QTD_PONTOS); // Chama a função que calcula o PI pelo Método de Monte Carlo
-  			sprintf(message, "%.8lf", pi); // Coloca o valor do PI no buffer
-			send(sockfd, message, 32, 0); // Envia o valor de PI para o servidor
-			printf("[#]Valor de PI enviado ao servidor.\n");
-			break;
-   		}
-		else if (receive == 0) {
-			break;
-    	} 
-		memset(message, 0, sizeof(message));
+	proto_msg_t msg;
+	mc_resultado_t r;
+	uint8_t buf[PROTO_TAM_MAX];
+
+  	while (le_mensagem(&msg) > 0){ // Recebe a mensagem enviada pelo servidor
+		if (msg.tipo == PROTO_LOTE){
+			METRICAS_INICIO("montecarlo_pi");
+			int encerrado = montecarlo_pi(&msg.lote, &r) < 0; // Chama a função que calcula o PI pelo Método de Monte Carlo
+			METRICAS_FIM();
+			if(encerrado){
+				puts("\n[#]Servidor desconectado ou lote inválido\n");
+				break;
+			}
+			envia(buf, proto_codificar_resultado(buf, msg.lote.id, &r)); // Envia o resultado, pedindo o próximo lote
+		}
   	}
+	catch_ctrl_c_and_exit(2); // Encerra o cliente quando o servidor se desconecta
 }
 
 int main(int argc, char **argv){
 	setlocale(LC_ALL,"Portuguese");
 
-	// Execução deve ser ./Client <port>. Ex: ./Client 5000
-	if(argc != 2){
-		printf("Use: %s <porta>\n", argv[0]);
+	int n_threads = 0; // 0 = todos os processadores
+	int somente_tcp = 0;
+	int afinidade = TOPO_NENHUMA; // Política de posicionamento das threads do pool
+	int opt;
+
+	while((opt = getopt(argc, argv, "t:Ta:")) != -1){
+		switch(opt){
+			case 't': n_threads = atoi(optarg); break;
+			case 'T': somente_tcp = 1; break;
+			case 'a': afinidade = topo_politica_id(optarg); break;
+			default: optind = argc + 1; break;
+		}
+	}
+
+	// Execução deve ser ./Client <port>. Ex: ./Client 5000 -t 4
+	if(optind != argc - 1 || n_threads < 0 || afinidade < 0){
+		printf("Use: %s <porta> [-t threads] [-T] [-a afinidade]\n", argv[0]);
 		return EXIT_FAILURE;
 	}
 
 	char *ip = "127.0.0.1"; // Endereço ip do cliente, nesse caso localhost
-	int port = atoi(argv[1]); // Recebe a porta informada pelo usuário para conexão com o servidor
+	int port = atoi(argv[optind]); // Recebe a porta informada pelo usuário para conexão com o servidor
 
 	/* Recebe o nome do cliente do usuário */
 	printf(">Nome do cliente: ");
@@ -151,24 +258,39 @@ int main(int argc, char **argv){
 	struct sockaddr_in server_addr; 
 
 	/* Configurações do socket */
-	sockfd = socket(AF_INET, SOCK_STREAM, 0);
   	server_addr.sin_family = AF_INET;
   	server_addr.sin_addr.s_addr = inet_addr(ip);
   	server_addr.sin_port = htons(port);
 
+	/* Servidor na mesma máquina (endereço 127.x.x.x): tenta o canal em memória compartilhada */
+	if(!somente_tcp && (ntohl(server_addr.sin_addr.s_addr) >> 24) == 127)
+		canal = canal_conectar(port);
 
 	/* Conecta-se ao servidor */
-	int err = connect(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr));
-	if (err == -1) {
-		printf("ERROR: connect\n");
+	if(canal){
+		sockfd = canal_socket(canal);
+	} else{
+		sockfd = socket(AF_INET, SOCK_STREAM, 0);
+		int err = connect(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr));
+		if (err == -1) {
+			printf("ERROR: connect\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	if(topo_configurar((topo_politica_t)afinidade, 0) != 0)
+		puts("AVISO: topologia indisponível, as threads não serão fixadas");
+	pool = mc_pool_criar(n_threads); // Cria as threads que realizarão o sorteio
+	if(!pool){
+		printf("ERROR: pthread\n");
 		return EXIT_FAILURE;
 	}
 
-	/* Envia o nome para o servidor */
-	send(sockfd, name, 32, 0);
+	/* Registra-se no servidor com o nome */
+	uint8_t registro[PROTO_TAM_MAX];
+	envia(registro, proto_codificar_registro(registro, name));
 
-	printf("#=== CONECTADO AO SERVIDOR ===#\n");
-	srand(time(NULL)); // Inicializa gerador de números com semente aleatória para geração de coordenadas
+	printf("#=== CONECTADO AO SERVIDOR (%d threads, %s) ===#\n", mc_pool_threads(pool), canal ? "memória compartilhada" : "TCP");
 
 	// Criação da thread para o envio de mensagens
 	pthread_t send_msg_thread; 
@@ -184,12 +306,14 @@ int main(int argc, char **argv){
 		return EXIT_FAILURE;
 	}
 
-	while (1){
-		if(flag){
-			printf("\nBye\n"); // Mensagem de saída para "exit"
-			break;
-    	}
-	}
+	/* Aguarda, sem consumir processador, o fim do trabalho ou o "exit" do usuário */
+	pthread_mutex_lock(&mutex_flag);
+	while(!flag)
+		pthread_cond_wait(&cond_flag, &mutex_flag);
+	pthread_mutex_unlock(&mutex_flag);
+
+	exibe_vazao();
+	printf("\nBye\n"); // Mensagem de saída para "exit"
 
 	close(sockfd);
 
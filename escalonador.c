@@ -0,0 +1,389 @@
+/* Escalonador de lotes do servidor (ver escalonador.h) */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "escalonador.h"
+#include "checkpoint.h"
+
+typedef enum{
+	LOTE_PENDENTE = 0,
+	LOTE_EMITIDO,
+	LOTE_CONCLUINDO, // Resultado aceito, contagem sendo gravada
+	LOTE_CONCLUIDO
+} lote_estado_t;
+
+/* A emissão de lotes (proximo, emissoes, devolvidos) é protegida pelo mutex, que nunca fica travado durante
+uma operação de E/S. Os resultados são acumulados sem travas: o estado de cada lote muda com
+compare-and-swap (somente a primeira cópia que chegar é aceita), as somas são contadores atômicos e o
+prefixo é avançado por uma única thread de cada vez, escolhida pelo sinalizador avancando */
+struct escalonador{
+	pthread_mutex_t mutex;
+
+	uint64_t n_pontos;
+	uint64_t semente;
+	uint64_t blocos_por_lote;
+	uint64_t n_lotes;
+	mc_estimador_t estimador;
+
+	_Atomic uint8_t *estado; // lote_estado_t de cada lote
+	uint8_t *emissoes; // Cópias de cada lote em andamento nos clientes
+	uint64_t proximo; // Próximo lote ainda não emitido
+	uint64_t *devolvidos; // Lotes abandonados por todas as cópias, emitidos antes dos inéditos
+	uint64_t n_devolvidos, cap_devolvidos;
+	uint64_t primeiro_aberto; // Todos os lotes anteriores já foram concluídos
+
+	_Alignas(MC_LINHA_CACHE) _Atomic uint64_t concluidos;
+	_Atomic uint64_t resultado_dentro, resultado_total; // Soma dos resultados dos lotes concluídos
+	uint64_t *dentro; // Pontos dentro de cada lote concluído, somados ao prefixo em ordem
+
+	_Alignas(MC_LINHA_CACHE) atomic_int avancando; // Uma thread soma lotes ao prefixo
+	_Atomic uint64_t fim_prefixo; // Lotes [0, fim_prefixo) concluídos e somados em prefixo
+	mc_resultado_t prefixo;
+	double media, desvios; // Médias por lote do prefixo (mc_acumular_lote)
+	atomic_int encerrado; // Erro alvo atingido pelo prefixo
+
+	double erro_alvo; // 0 = todos os lotes são sorteados
+	double confianca;
+};
+
+escalonador_t *escalonador_criar(uint64_t n_pontos, uint64_t semente, uint64_t blocos_por_lote, mc_estimador_t estimador){
+	escalonador_t *esc = (escalonador_t *)aligned_alloc(MC_LINHA_CACHE, sizeof(escalonador_t));
+	if(!esc)
+		return NULL;
+	memset(esc, 0, sizeof(escalonador_t));
+	pthread_mutex_init(&esc->mutex, NULL);
+
+	if(blocos_por_lote == 0)
+		blocos_por_lote = 1;
+
+	esc->n_pontos = n_pontos;
+	esc->semente = semente;
+	esc->blocos_por_lote = blocos_por_lote;
+	esc->estimador = estimador;
+	esc->confianca = MC_CONFIANCA; // Sem erro alvo ainda vale para o intervalo do resultado (retomado de um checkpoint)
+	esc->n_lotes = (mc_num_blocos(n_pontos) + blocos_por_lote - 1)/blocos_por_lote;
+	esc->estado = (_Atomic uint8_t *)calloc(esc->n_lotes ? esc->n_lotes : 1, sizeof(_Atomic uint8_t));
+	esc->emissoes = (uint8_t *)calloc(esc->n_lotes ? esc->n_lotes : 1, 1);
+	esc->dentro = (uint64_t *)calloc(esc->n_lotes ? esc->n_lotes : 1, sizeof(uint64_t));
+	if(!esc->estado || !esc->emissoes || !esc->dentro){
+		escalonador_destruir(esc);
+		return NULL;
+	}
+
+	return esc;
+}
+
+/* Encerra o trabalho assim que o prefixo de lotes concluídos atingir PI ± erro_alvo */
+void escalonador_definir_alvo(escalonador_t *esc, double erro_alvo, double confianca){
+	pthread_mutex_lock(&esc->mutex);
+	esc->erro_alvo = erro_alvo;
+	esc->confianca = confianca;
+	pthread_mutex_unlock(&esc->mutex);
+}
+
+/* Preenche a descrição do lote */
+static void escalonador_lote(const escalonador_t *esc, uint64_t id, lote_t *lote){
+	uint64_t n_blocos = mc_num_blocos(esc->n_pontos);
+
+	lote->id = id;
+	lote->semente = esc->semente;
+	lote->n_pontos = esc->n_pontos;
+	lote->bloco_ini = id*esc->blocos_por_lote;
+	lote->bloco_fim = lote->bloco_ini + esc->blocos_por_lote;
+	if(lote->bloco_fim > n_blocos)
+		lote->bloco_fim = n_blocos;
+	lote->estimador = esc->estimador;
+}
+
+/* Estimativa do prefixo (somente a thread que o avança ou depois de encerrado) */
+static mc_estimativa_t escalonador_estimar_prefixo(const escalonador_t *esc, double confianca){
+	if(esc->estimador == MC_ACERTO)
+		return mc_estimar(esc->prefixo, confianca);
+	return mc_estimar_lotes(esc->prefixo, esc->desvios, atomic_load(&esc->fim_prefixo), confianca);
+}
+
+/* Escolhe o próximo lote para um cliente ocioso. Com reemitir = 0 não entrega cópias de lotes em andamento
+(o cliente pode receber um lote inédito de outro trabalho, ver fila.h) */
+esc_situacao_t escalonador_proximo(escalonador_t *esc, lote_t *lote, int reemitir){
+	esc_situacao_t situacao = ESC_AGUARDAR;
+
+	pthread_mutex_lock(&esc->mutex);
+
+	while(esc->proximo < esc->n_lotes && esc->estado[esc->proximo] == LOTE_CONCLUIDO) // Concluídos antes de um checkpoint
+		esc->proximo++;
+
+	if(escalonador_terminou(esc)){
+		situacao = ESC_FIM;
+	} else if(esc->n_devolvidos > 0){ // Lote de um cliente que caiu
+		uint64_t id = esc->devolvidos[--esc->n_devolvidos];
+		atomic_store(&esc->estado[id], LOTE_EMITIDO);
+		esc->emissoes[id] = 1;
+		escalonador_lote(esc, id, lote);
+		situacao = ESC_REATRIBUICAO;
+	} else if(esc->proximo < esc->n_lotes){ // Ainda há lotes inéditos
+		uint64_t id = esc->proximo++;
+		atomic_store(&esc->estado[id], LOTE_EMITIDO);
+		esc->emissoes[id] = 1;
+		escalonador_lote(esc, id, lote);
+		situacao = ESC_NOVO;
+	} else if(reemitir){ // Final do trabalho: reemite o lote em andamento com menos cópias
+		while(esc->primeiro_aberto < esc->n_lotes && esc->estado[esc->primeiro_aberto] >= LOTE_CONCLUINDO)
+			esc->primeiro_aberto++;
+
+		uint64_t escolhido = esc->n_lotes;
+		for(uint64_t i=esc->primeiro_aberto; i<esc->n_lotes; i++){
+			if(esc->estado[i] == LOTE_EMITIDO && esc->emissoes[i] < ESC_MAX_EMISSOES &&
+			   (escolhido == esc->n_lotes || esc->emissoes[i] < esc->emissoes[escolhido]))
+				escolhido = i;
+		}
+		if(escolhido < esc->n_lotes){
+			esc->emissoes[escolhido]++;
+			escalonador_lote(esc, escolhido, lote);
+			situacao = ESC_REEMISSAO;
+		}
+	}
+
+	pthread_mutex_unlock(&esc->mutex);
+
+	return situacao;
+}
+
+/* 1 se o próximo lote do prefixo já foi concluído */
+static int escalonador_prefixo_pendente(escalonador_t *esc){
+	uint64_t fim = atomic_load(&esc->fim_prefixo);
+	return !atomic_load(&esc->encerrado) && fim < esc->n_lotes && atomic_load(&esc->estado[fim]) == LOTE_CONCLUIDO;
+}
+
+/* Soma ao prefixo os lotes concluídos em sequência, verificando a convergência a cada lote. Se outra thread
+já está avançando o prefixo a função retorna sem esperar: depois de liberar o sinalizador essa thread confere
+de novo o próximo lote, então um lote concluído enquanto ela avançava nunca fica de fora */
+static void escalonador_avancar_prefixo(escalonador_t *esc){
+	lote_t lote;
+
+	while(escalonador_prefixo_pendente(esc) && !atomic_exchange(&esc->avancando, 1)){
+		while(escalonador_prefixo_pendente(esc)){
+			uint64_t fim = atomic_load(&esc->fim_prefixo);
+			mc_resultado_t r = {esc->dentro[fim], 0};
+			escalonador_lote(esc, fim, &lote);
+			for(uint64_t b=lote.bloco_ini; b<lote.bloco_fim; b++)
+				r.total += mc_tam_bloco(esc->n_pontos, b);
+			mc_acumular_lote(&esc->media, &esc->desvios, esc->prefixo.total, r);
+			esc->prefixo.total += r.total;
+			esc->prefixo.dentro += r.dentro;
+			atomic_store(&esc->fim_prefixo, fim + 1);
+
+			if(esc->erro_alvo > 0 && (esc->estimador == MC_ACERTO || fim + 1 >= ESC_MIN_LOTES) &&
+			   escalonador_estimar_prefixo(esc, esc->confianca).semi_intervalo <= esc->erro_alvo)
+				atomic_store(&esc->encerrado, 1);
+		}
+		atomic_store(&esc->avancando, 0);
+	}
+}
+
+/* O cliente que calculava o lote caiu. Sem outras cópias em andamento o lote volta a ficar pendente
+e é o próximo a ser emitido */
+void escalonador_abandonar(escalonador_t *esc, uint64_t id){
+	pthread_mutex_lock(&esc->mutex);
+
+	if(id < esc->n_lotes && atomic_load(&esc->estado[id]) == LOTE_EMITIDO && esc->emissoes[id] > 0 && --esc->emissoes[id] == 0){
+		if(esc->n_devolvidos == esc->cap_devolvidos){
+			uint64_t cap = esc->cap_devolvidos ? 2*esc->cap_devolvidos : 64;
+			uint64_t *novo = (uint64_t *)realloc(esc->devolvidos, cap*sizeof(uint64_t));
+			if(novo){
+				esc->devolvidos = novo;
+				esc->cap_devolvidos = cap;
+			}
+		}
+		uint8_t emitido = LOTE_EMITIDO;
+		if(esc->n_devolvidos < esc->cap_devolvidos){
+			if(atomic_compare_exchange_strong(&esc->estado[id], &emitido, LOTE_PENDENTE)) // Falha se o resultado acabou de chegar
+				esc->devolvidos[esc->n_devolvidos++] = id;
+		} else{
+			esc->emissoes[id] = 1; // Sem memória: o lote continua em andamento e pode ser reemitido
+		}
+	}
+
+	pthread_mutex_unlock(&esc->mutex);
+}
+
+/* Pontos sorteados no lote */
+static uint64_t escalonador_pontos_lote(const escalonador_t *esc, uint64_t id){
+	lote_t lote;
+	uint64_t pontos = 0;
+
+	escalonador_lote(esc, id, &lote);
+	for(uint64_t b=lote.bloco_ini; b<lote.bloco_fim; b++)
+		pontos += mc_tam_bloco(esc->n_pontos, b);
+	return pontos;
+}
+
+/* Grava a contagem do lote aceito (estado LOTE_CONCLUINDO) e o marca como concluído. O total é somado antes
+dos pontos dentro e os lotes concluídos por último, então quem lê as somas sem travas nunca vê mais pontos
+dentro que sorteados nem o trabalho terminado sem todas as contagens */
+static void escalonador_marcar(escalonador_t *esc, uint64_t id, uint64_t dentro, uint64_t total){
+	esc->dentro[id] = dentro;
+	atomic_store(&esc->estado[id], LOTE_CONCLUIDO);
+	atomic_fetch_add(&esc->resultado_total, total);
+	atomic_fetch_add(&esc->resultado_dentro, dentro);
+	atomic_fetch_add(&esc->concluidos, 1);
+	escalonador_avancar_prefixo(esc);
+}
+
+/* Registra o resultado de um lote. Retorna 1 se foi aceito e 0 se o lote já havia sido concluído ou é inválido.
+Pode ser chamada por várias threads ao mesmo tempo sem travas */
+int escalonador_concluir(escalonador_t *esc, uint64_t id, const mc_resultado_t *resultado){
+	uint8_t emitido = LOTE_EMITIDO;
+
+	if(atomic_load(&esc->encerrado) || id >= esc->n_lotes)
+		return 0;
+	if(resultado->total != escalonador_pontos_lote(esc, id) || resultado->dentro > resultado->total) // Confere se o cliente sorteou o lote inteiro
+		return 0;
+	if(!atomic_compare_exchange_strong(&esc->estado[id], &emitido, LOTE_CONCLUINDO)) // Outra cópia chegou antes
+		return 0;
+
+	escalonador_marcar(esc, id, resultado->dentro, resultado->total);
+	return 1;
+}
+
+/* O trabalho termina quando o prefixo atinge o erro alvo ou contém todos os lotes, e não apenas quando o último
+lote é concluído: a thread que avança o prefixo grava as somas antes de fim_prefixo, então quem vê o trabalho
+terminado lê o prefixo completo, que não muda mais */
+int escalonador_terminou(escalonador_t *esc){
+	return atomic_load(&esc->encerrado) || atomic_load(&esc->fim_prefixo) == esc->n_lotes;
+}
+
+/* 1 se o resultado do lote já foi aceito (as cópias em andamento serão descartadas) */
+int escalonador_concluido(escalonador_t *esc, uint64_t id){
+	return id < esc->n_lotes && atomic_load(&esc->estado[id]) >= LOTE_CONCLUINDO;
+}
+
+uint64_t escalonador_num_lotes(const escalonador_t *esc){
+	return esc->n_lotes;
+}
+
+/* Resultado final: o prefixo, que com o erro alvo atingido contém somente os lotes que convergiram */
+mc_resultado_t escalonador_resultado(escalonador_t *esc){
+	if(escalonador_terminou(esc)) // O prefixo não muda mais
+		return esc->prefixo;
+	return escalonador_andamento(esc, NULL);
+}
+
+/* Soma de todos os lotes concluídos até o momento, em qualquer ordem (estimativa parcial) */
+mc_resultado_t escalonador_andamento(escalonador_t *esc, uint64_t *concluidos){
+	mc_resultado_t resultado;
+	resultado.dentro = atomic_load(&esc->resultado_dentro); // Antes do total (ver escalonador_marcar)
+	resultado.total = atomic_load(&esc->resultado_total);
+	if(concluidos)
+		*concluidos = atomic_load(&esc->concluidos);
+	return resultado;
+}
+
+/* Estimativa com o erro do estimador do trabalho. Com o acerto simples vale para qualquer resultado
+(mc_estimar); com os demais o erro vem da variância entre os lotes do prefixo, que só é lido depois do
+fim do trabalho (escalonador_terminou), quando nenhuma thread o altera mais */
+mc_estimativa_t escalonador_estimar(escalonador_t *esc, double confianca){
+	if(esc->estimador == MC_ACERTO || !escalonador_terminou(esc) || atomic_load(&esc->fim_prefixo) == 0)
+		return mc_estimar(escalonador_resultado(esc), confianca); // Estimativa parcial: limite binomial
+	return escalonador_estimar_prefixo(esc, confianca);
+}
+
+/* Parâmetros do trabalho (usados ao retomar um checkpoint) */
+void escalonador_parametros(escalonador_t *esc, uint64_t *n_pontos, uint64_t *semente, double *erro_alvo, double *confianca, mc_estimador_t *estimador){
+	pthread_mutex_lock(&esc->mutex);
+	*n_pontos = esc->n_pontos;
+	*semente = esc->semente;
+	*erro_alvo = esc->erro_alvo;
+	*confianca = esc->confianca;
+	*estimador = esc->estimador;
+	pthread_mutex_unlock(&esc->mutex);
+}
+
+/* Grava os parâmetros e os lotes concluídos: mapa de bits dos lotes seguido da contagem de cada concluído.
+Os lotes em andamento serão emitidos de novo pelo escalonador retomado. Outras threads continuam concluindo
+lotes durante a gravação, então o mapa é lido uma única vez e as contagens gravadas são as dos seus bits.
+Retorna -1 em caso de erro */
+int escalonador_salvar(escalonador_t *esc, const char *arquivo){
+	ckpt_arquivo_t c;
+	uint64_t n_palavras = (esc->n_lotes + 63)/64;
+	uint64_t *mapa = (uint64_t *)calloc(n_palavras ? n_palavras : 1, sizeof(uint64_t));
+	if(!mapa)
+		return -1;
+	for(uint64_t i=0; i<esc->n_lotes; i++)
+		if(atomic_load(&esc->estado[i]) == LOTE_CONCLUIDO) // A contagem (dentro) é gravada antes do estado
+			mapa[i/64] |= 1ULL << (i%64);
+
+	if(ckpt_criar(&c, arquivo, CKPT_ESCALONADOR) != 0){
+		free(mapa);
+		return -1;
+	}
+
+	ckpt_escrever_u64(&c, esc->n_pontos);
+	ckpt_escrever_u64(&c, esc->semente);
+	ckpt_escrever_u64(&c, esc->blocos_por_lote);
+	ckpt_escrever_double(&c, esc->erro_alvo);
+	ckpt_escrever_double(&c, esc->confianca);
+	ckpt_escrever_u64(&c, esc->estimador);
+	for(uint64_t i=0; i<n_palavras; i++)
+		ckpt_escrever_u64(&c, mapa[i]);
+	for(uint64_t i=0; i<esc->n_lotes; i++)
+		if(mapa[i/64] >> (i%64) & 1) // Só deixa de ser concluído com o escalonador destruído
+			ckpt_escrever_u64(&c, esc->dentro[i]);
+	free(mapa);
+
+	return ckpt_concluir(&c);
+}
+
+/* Cria o escalonador a partir de um checkpoint de escalonador_salvar. Retorna NULL se o arquivo não existe ou é inválido */
+escalonador_t *escalonador_carregar(const char *arquivo){
+	ckpt_arquivo_t c;
+	if(ckpt_abrir(&c, arquivo, CKPT_ESCALONADOR) != 0)
+		return NULL;
+
+	uint64_t n_pontos = ckpt_ler_u64(&c), semente = ckpt_ler_u64(&c), blocos_por_lote = ckpt_ler_u64(&c);
+	double erro_alvo = ckpt_ler_double(&c), confianca = ckpt_ler_double(&c);
+	uint64_t estimador = ckpt_ler_u64(&c);
+	escalonador_t *esc = (c.erro || estimador > MC_CONTROLE) ? NULL : escalonador_criar(n_pontos, semente, blocos_por_lote, (mc_estimador_t)estimador);
+	if(!esc){
+		ckpt_fechar(&c);
+		return NULL;
+	}
+	esc->erro_alvo = erro_alvo;
+	esc->confianca = confianca;
+
+	/* Os lotes são marcados em ordem crescente, então o prefixo e a parada são reconstruídos como na execução original */
+	uint64_t n_palavras = (esc->n_lotes + 63)/64;
+	uint64_t *mapa = (uint64_t *)malloc((n_palavras ? n_palavras : 1)*sizeof(uint64_t));
+	if(mapa){
+		for(uint64_t i=0; i<n_palavras; i++)
+			mapa[i] = ckpt_ler_u64(&c);
+		for(uint64_t i=0; i<esc->n_lotes && !c.erro; i++){
+			if(!(mapa[i/64] >> (i%64) & 1))
+				continue;
+			uint64_t dentro = ckpt_ler_u64(&c), total = escalonador_pontos_lote(esc, i);
+			if(dentro > total)
+				c.erro = 1;
+			else if(!esc->encerrado)
+				escalonador_marcar(esc, i, dentro, total);
+		}
+		free(mapa);
+	}
+
+	if(ckpt_fechar(&c) != 0 || !mapa){
+		escalonador_destruir(esc);
+		return NULL;
+	}
+	return esc;
+}
+
+void escalonador_destruir(escalonador_t *esc){
+	if(!esc)
+		return;
+	pthread_mutex_destroy(&esc->mutex);
+	free(esc->estado);
+	free(esc->emissoes);
+	free(esc->dentro);
+	free(esc->devolvidos);
+	free(esc);
+}
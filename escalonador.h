@@ -0,0 +1,61 @@
+/* Escalonador de lotes do servidor
+
+O trabalho é dividido em lotes de blocos (montecarlo.h) entregues sob demanda: cada cliente
+recebe um novo lote ao devolver o anterior, então as máquinas mais rápidas processam mais lotes.
+Quando não há mais lotes inéditos, os lotes ainda em andamento são reemitidos para clientes
+ociosos (até ESC_MAX_EMISSOES cópias simultâneas); vale o primeiro resultado que chegar. Como cada
+bloco utiliza sempre o mesmo fluxo do gerador, as cópias produzem resultados idênticos. O lote de um
+cliente que caiu (escalonador_abandonar) volta a ser pendente quando não há outra cópia em andamento
+e é entregue ao próximo cliente que pedir trabalho, antes dos lotes inéditos.
+
+Com um erro alvo (escalonador_definir_alvo) o trabalho termina assim que o prefixo contíguo de lotes
+concluídos (0, 1, 2, ...) atinge a precisão desejada. Como o prefixo não depende da ordem de chegada
+dos resultados, a parada e o valor final dependem apenas da semente.
+
+Os lotes são sorteados com o estimador do trabalho (mc_estimador_t, enviado no lote). Com o acerto simples
+o erro é o binomial de mc_estimar; com os estimadores de redução de variância é o das médias por lote
+(mc_estimar_lotes) sobre o prefixo, e a parada exige pelo menos ESC_MIN_LOTES lotes no prefixo.
+
+Checkpoints (escalonador_salvar e escalonador_carregar, ver checkpoint.h) guardam os parâmetros e as
+contagens exatas dos lotes concluídos; o escalonador retomado emite somente os lotes restantes.
+
+Todas as funções podem ser chamadas por várias threads. Os resultados (escalonador_concluir) e as consultas
+das somas são atendidos sem travas, com contadores atômicos; somente a emissão de lotes usa um mutex. */
+
+#ifndef ESCALONADOR_H
+#define ESCALONADOR_H
+
+#include <stdint.h>
+#include "montecarlo.h"
+#include "protocolo.h"
+
+#define ESC_MAX_EMISSOES 3 // Máximo de clientes trabalhando no mesmo lote
+#define ESC_MIN_LOTES 8 // Lotes do prefixo antes de confiar na variância entre lotes
+
+typedef enum{
+	ESC_NOVO, // Lote ainda não emitido
+	ESC_REEMISSAO, // Lote em andamento em outro cliente
+	ESC_REATRIBUICAO, // Lote abandonado por um cliente que caiu
+	ESC_AGUARDAR, // Nenhum lote disponível no momento
+	ESC_FIM // Todos os lotes foram concluídos (ou o erro alvo foi atingido)
+} esc_situacao_t;
+
+typedef struct escalonador escalonador_t;
+
+escalonador_t *escalonador_criar(uint64_t n_pontos, uint64_t semente, uint64_t blocos_por_lote, mc_estimador_t estimador);
+void escalonador_definir_alvo(escalonador_t *esc, double erro_alvo, double confianca);
+esc_situacao_t escalonador_proximo(escalonador_t *esc, lote_t *lote, int reemitir);
+void escalonador_abandonar(escalonador_t *esc, uint64_t id);
+int escalonador_concluir(escalonador_t *esc, uint64_t id, const mc_resultado_t *resultado);
+int escalonador_terminou(escalonador_t *esc);
+int escalonador_concluido(escalonador_t *esc, uint64_t id);
+uint64_t escalonador_num_lotes(const escalonador_t *esc);
+mc_resultado_t escalonador_resultado(escalonador_t *esc);
+mc_resultado_t escalonador_andamento(escalonador_t *esc, uint64_t *concluidos);
+mc_estimativa_t escalonador_estimar(escalonador_t *esc, double confianca);
+void escalonador_parametros(escalonador_t *esc, uint64_t *n_pontos, uint64_t *semente, double *erro_alvo, double *confianca, mc_estimador_t *estimador);
+int escalonador_salvar(escalonador_t *esc, const char *arquivo);
+escalonador_t *escalonador_carregar(const char *arquivo);
+void escalonador_destruir(escalonador_t *esc);
+
+#endif
@@ -0,0 +1,195 @@
+/* Fila de trabalhos do servidor (ver fila.h) */
+
+#include <stdlib.h>
+#include <string.h>
+#include "fila.h"
+
+struct fila{
+	pthread_mutex_t mutex;
+	int max_ativos;
+	trabalho_t **ativos;
+	size_t n_ativos;
+	trabalho_t *espera; // Ordenada por prioridade (decrescente) e chegada
+	size_t n_espera;
+	uint64_t ultimo_id;
+};
+
+fila_t *fila_criar(int max_ativos){
+	if(max_ativos < 1)
+		max_ativos = 1;
+	if(max_ativos > FILA_LIMITE_ATIVOS)
+		max_ativos = FILA_LIMITE_ATIVOS;
+
+	fila_t *fila = (fila_t *)calloc(1, sizeof(fila_t));
+	if(!fila)
+		return NULL;
+	fila->ativos = (trabalho_t **)calloc(max_ativos, sizeof(trabalho_t *));
+	if(!fila->ativos){
+		free(fila);
+		return NULL;
+	}
+	pthread_mutex_init(&fila->mutex, NULL);
+	fila->max_ativos = max_ativos;
+	return fila;
+}
+
+/* Torna o trabalho ativo, no menor tempo virtual dos demais (mutex travado) */
+static void fila_ativar(fila_t *fila, trabalho_t *t){
+	double virtual = 0;
+	for(size_t i=0; i<fila->n_ativos; i++)
+		if(i == 0 || fila->ativos[i]->virtual < virtual)
+			virtual = fila->ativos[i]->virtual;
+
+	t->virtual = virtual;
+	t->inicio = mc_relogio();
+	fila->ativos[fila->n_ativos++] = t;
+}
+
+/* Cria um trabalho com o escalonador informado, ativo ou na fila de espera. Retorna o trabalho com uma
+referência para quem o submeteu (trabalho_liberar), ou NULL sem memória */
+trabalho_t *fila_submeter(fila_t *fila, escalonador_t *esc, uint64_t prioridade, double confianca){
+	trabalho_t *t = (trabalho_t *)aligned_alloc(MC_LINHA_CACHE, sizeof(trabalho_t));
+	if(!t)
+		return NULL;
+	memset(t, 0, sizeof(trabalho_t));
+	t->esc = esc;
+	t->prioridade = prioridade ? prioridade : 1;
+	t->confianca = confianca;
+	atomic_init(&t->refs, 2); // Fila e quem submeteu
+	atomic_init(&t->concluido, 0);
+	atomic_init(&t->reemitido, 0);
+	atomic_init(&t->parcial_dentro, 0);
+	atomic_init(&t->parcial_total, 0);
+
+	pthread_mutex_lock(&fila->mutex);
+	t->id = ++fila->ultimo_id;
+	if(fila->n_ativos < (size_t)fila->max_ativos){
+		fila_ativar(fila, t);
+	} else{
+		trabalho_t **p = &fila->espera;
+		while(*p && (*p)->prioridade >= t->prioridade)
+			p = &(*p)->prox;
+		t->prox = *p;
+		*p = t;
+		fila->n_espera++;
+	}
+	pthread_mutex_unlock(&fila->mutex);
+
+	return t;
+}
+
+/* Escolhe o lote para um cliente ocioso: primeiro lotes inéditos ou devolvidos, depois reemissões, sempre
+do trabalho ativo com o menor tempo virtual que tiver algum. Com um lote, *trabalho recebe uma referência
+(trabalho_liberar); sem nenhum lote disponível retorna ESC_AGUARDAR */
+esc_situacao_t fila_proximo(fila_t *fila, lote_t *lote, trabalho_t **trabalho){
+	esc_situacao_t situacao = ESC_AGUARDAR;
+
+	pthread_mutex_lock(&fila->mutex);
+
+	for(int reemitir=0; reemitir<2 && situacao == ESC_AGUARDAR; reemitir++){
+		uint64_t tentados = 0; // Mapa de bits dos trabalhos sem lote nesta passagem
+		while(situacao == ESC_AGUARDAR){
+			size_t escolhido = fila->n_ativos;
+			for(size_t i=0; i<fila->n_ativos; i++)
+				if(!(tentados >> i & 1) && (escolhido == fila->n_ativos || fila->ativos[i]->virtual < fila->ativos[escolhido]->virtual))
+					escolhido = i;
+			if(escolhido == fila->n_ativos)
+				break;
+
+			trabalho_t *t = fila->ativos[escolhido];
+			esc_situacao_t s = escalonador_proximo(t->esc, lote, reemitir);
+			if(s == ESC_AGUARDAR || s == ESC_FIM){
+				tentados |= 1ULL << escolhido;
+				continue;
+			}
+			t->virtual += 1.0/t->prioridade;
+			*trabalho = trabalho_reter(t);
+			situacao = s;
+		}
+	}
+
+	pthread_mutex_unlock(&fila->mutex);
+
+	return situacao;
+}
+
+/* Detecta o fim do trabalho (último lote ou erro alvo atingido). Retorna 1 somente para a primeira
+thread que o detecta: o trabalho deixa a fila, que libera a sua referência, e o primeiro da fila de
+espera se torna ativo */
+int fila_encerrar(fila_t *fila, trabalho_t *t){
+	if(!escalonador_terminou(t->esc) || atomic_exchange(&t->concluido, 1))
+		return 0;
+
+	pthread_mutex_lock(&fila->mutex);
+	for(size_t i=0; i<fila->n_ativos; i++){
+		if(fila->ativos[i] == t){
+			fila->ativos[i] = fila->ativos[--fila->n_ativos];
+			break;
+		}
+	}
+	for(trabalho_t **p=&fila->espera; *p; p=&(*p)->prox){
+		if(*p == t){
+			*p = t->prox;
+			fila->n_espera--;
+			break;
+		}
+	}
+	while(fila->n_ativos < (size_t)fila->max_ativos && fila->espera){
+		trabalho_t *proximo = fila->espera;
+		fila->espera = proximo->prox;
+		fila->n_espera--;
+		fila_ativar(fila, proximo);
+	}
+	pthread_mutex_unlock(&fila->mutex);
+
+	trabalho_liberar(t);
+	return 1;
+}
+
+/* Copia até max trabalhos ativos, cada um com uma referência (trabalho_liberar). Retorna quantos copiou */
+size_t fila_ativos(fila_t *fila, trabalho_t **trabalhos, size_t max){
+	size_t n = 0;
+
+	pthread_mutex_lock(&fila->mutex);
+	for(size_t i=0; i<fila->n_ativos && n<max; i++)
+		trabalhos[n++] = trabalho_reter(fila->ativos[i]);
+	pthread_mutex_unlock(&fila->mutex);
+
+	return n;
+}
+
+/* Trabalhos na fila de espera */
+size_t fila_espera(fila_t *fila){
+	pthread_mutex_lock(&fila->mutex);
+	size_t n = fila->n_espera;
+	pthread_mutex_unlock(&fila->mutex);
+	return n;
+}
+
+void fila_destruir(fila_t *fila){
+	if(!fila)
+		return;
+	for(size_t i=0; i<fila->n_ativos; i++)
+		trabalho_liberar(fila->ativos[i]);
+	while(fila->espera){
+		trabalho_t *t = fila->espera;
+		fila->espera = t->prox;
+		trabalho_liberar(t);
+	}
+	pthread_mutex_destroy(&fila->mutex);
+	free(fila->ativos);
+	free(fila);
+}
+
+trabalho_t *trabalho_reter(trabalho_t *t){
+	atomic_fetch_add(&t->refs, 1);
+	return t;
+}
+
+/* Libera uma referência; a última destrói o escalonador e o trabalho */
+void trabalho_liberar(trabalho_t *t){
+	if(!t || atomic_fetch_sub(&t->refs, 1) != 1)
+		return;
+	escalonador_destruir(t->esc);
+	free(t);
+}
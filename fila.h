@@ -0,0 +1,59 @@
+/* Fila de trabalhos do servidor
+
+O servidor atende vários trabalhos independentes (cada um com o seu escalonador, ver escalonador.h) com
+o mesmo conjunto de clientes conectados. Até max_ativos trabalhos são atendidos ao mesmo tempo; os
+demais aguardam na fila em ordem de prioridade (e de chegada entre prioridades iguais).
+
+Compartilhamento justo entre os ativos: cada lote emitido avança o tempo virtual do trabalho em
+1/prioridade e o cliente que pede trabalho recebe um lote do trabalho com o menor tempo virtual, então
+um trabalho de prioridade 2 recebe o dobro de lotes de um de prioridade 1. Um trabalho que acaba de
+se tornar ativo começa no menor tempo virtual dos demais, sem crédito acumulado na fila. Cópias de lotes
+em andamento (reemissões) só são entregues quando nenhum trabalho ativo tem lotes inéditos.
+
+Cada trabalho tem um contador de referências: a fila mantém uma enquanto o trabalho não termina e
+cada cliente com um lote do trabalho (ou que o submeteu) mantém outra, então resultados atrasados e
+clientes que caem depois do fim nunca acessam um trabalho já liberado. */
+
+#ifndef FILA_H
+#define FILA_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "escalonador.h"
+
+#define FILA_MAX_ATIVOS 4 // Trabalhos atendidos ao mesmo tempo (padrão)
+#define FILA_LIMITE_ATIVOS 64 // Máximo de trabalhos atendidos ao mesmo tempo
+
+typedef struct trabalho{
+	uint64_t id;
+	escalonador_t *esc;
+	uint64_t prioridade; // Peso no compartilhamento dos clientes (>= 1)
+	double confianca; // Nível de confiança do intervalo exibido
+	double inicio; // Momento em que se tornou ativo (mc_relogio)
+	double virtual; // Lotes emitidos/prioridade, ajustado ao se tornar ativo (mutex da fila)
+
+	atomic_int refs;
+	atomic_int concluido; // O fim do trabalho já foi detectado (somente uma thread o detecta)
+	atomic_int reemitido; // Algum lote foi reemitido: pode haver cópias em clientes de outros reatores
+
+	/* Soma das contagens parciais dos lotes em andamento nos clientes (estimativa parcial) */
+	_Alignas(MC_LINHA_CACHE) _Atomic uint64_t parcial_dentro, parcial_total;
+
+	struct trabalho *prox; // Próximo trabalho na fila de espera
+} trabalho_t;
+
+typedef struct fila fila_t;
+
+fila_t *fila_criar(int max_ativos);
+trabalho_t *fila_submeter(fila_t *fila, escalonador_t *esc, uint64_t prioridade, double confianca);
+esc_situacao_t fila_proximo(fila_t *fila, lote_t *lote, trabalho_t **trabalho);
+int fila_encerrar(fila_t *fila, trabalho_t *trabalho);
+size_t fila_ativos(fila_t *fila, trabalho_t **trabalhos, size_t max);
+size_t fila_espera(fila_t *fila);
+void fila_destruir(fila_t *fila);
+
+trabalho_t *trabalho_reter(trabalho_t *trabalho);
+void trabalho_liberar(trabalho_t *trabalho);
+
+#endif
@@ -0,0 +1,138 @@
+/* Memória dos inteiros grandes com orçamento de RAM (ver memoria.h) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "memoria.h"
+
+#define MEMORIA_CABECALHO 64 // Bytes antes dos dados (mantém o alinhamento de linha de cache)
+#define MEMORIA_DIRETORIO "/tmp" // Diretório dos arquivos temporários (padrão)
+
+/* Cabeçalho de cada bloco */
+typedef struct{
+	size_t bytes; // Tamanho dos dados
+	int em_disco; // 1 = arquivo mapeado, 0 = malloc
+} memoria_bloco_t;
+
+static size_t orcamento = 0; // Bytes de RAM (0 = sem limite)
+static char diretorio[4096] = MEMORIA_DIRETORIO;
+static atomic_size_t em_ram = 0, em_disco = 0, pico_disco = 0;
+
+/* Orçamento de RAM em bytes (0 = sem limite) e diretório dos arquivos (NULL = /tmp). Deve ser
+chamada antes das alocações */
+void memoria_configurar(size_t bytes, const char *dir){
+	orcamento = bytes;
+	snprintf(diretorio, sizeof(diretorio), "%s", dir ? dir : MEMORIA_DIRETORIO);
+}
+
+/* 1 se mais bytes ainda cabem no orçamento de RAM */
+int memoria_cabe(size_t bytes){
+	return orcamento == 0 || atomic_load(&em_ram) + bytes <= orcamento;
+}
+
+/* Maior quantidade de bytes mantida em arquivos ao mesmo tempo */
+size_t memoria_pico_disco(void){
+	return atomic_load(&pico_disco);
+}
+
+/* Reserva bytes do orçamento de RAM; falha (0) se não couberem */
+static int memoria_reservar_ram(size_t bytes){
+	size_t atual = atomic_load(&em_ram);
+	do{
+		if(orcamento > 0 && atual + bytes > orcamento)
+			return 0;
+	} while(!atomic_compare_exchange_weak(&em_ram, &atual, atual + bytes));
+	return 1;
+}
+
+/* Bloco em um arquivo temporário mapeado na memória */
+static memoria_bloco_t *memoria_mapear(size_t total){
+	char caminho[sizeof(diretorio) + 16];
+	snprintf(caminho, sizeof(caminho), "%s/pi-XXXXXX", diretorio);
+
+	int fd = mkstemp(caminho);
+	if(fd < 0)
+		return NULL;
+	unlink(caminho); // O espaço é liberado pelo sistema quando o mapeamento é desfeito
+
+	void *p = MAP_FAILED;
+	if(ftruncate(fd, (off_t)total) == 0)
+		p = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(p == MAP_FAILED)
+		return NULL;
+
+	size_t disco = atomic_fetch_add(&em_disco, total) + total;
+	size_t pico = atomic_load(&pico_disco);
+	while(disco > pico && !atomic_compare_exchange_weak(&pico_disco, &pico, disco))
+		;
+	return (memoria_bloco_t *)p;
+}
+
+/* Aloca bytes na RAM ou, acima do orçamento, em disco. Retorna NULL se não houver memória */
+void *memoria_alocar(size_t bytes){
+	size_t total = MEMORIA_CABECALHO + bytes;
+	memoria_bloco_t *b = NULL;
+	int em_disco = 0;
+
+	if(memoria_reservar_ram(total)){
+		b = (memoria_bloco_t *)malloc(total);
+		if(!b)
+			atomic_fetch_sub(&em_ram, total);
+	}
+	if(!b && orcamento > 0){
+		b = memoria_mapear(total);
+		em_disco = 1;
+	}
+	if(!b)
+		return NULL;
+
+	b->bytes = bytes;
+	b->em_disco = em_disco;
+	return (char *)b + MEMORIA_CABECALHO;
+}
+
+/* Muda o tamanho do bloco preservando o conteúdo (como o realloc) */
+void *memoria_realocar(void *p, size_t bytes){
+	if(!p)
+		return memoria_alocar(bytes);
+
+	memoria_bloco_t *b = (memoria_bloco_t *)((char *)p - MEMORIA_CABECALHO);
+	if(bytes <= b->bytes) // Não diminui o bloco
+		return p;
+	if(!b->em_disco && memoria_reservar_ram(bytes - b->bytes)){ // Cresce na RAM
+		memoria_bloco_t *novo = (memoria_bloco_t *)realloc(b, MEMORIA_CABECALHO + bytes);
+		if(novo){
+			novo->bytes = bytes;
+			return (char *)novo + MEMORIA_CABECALHO;
+		}
+		atomic_fetch_sub(&em_ram, bytes - b->bytes);
+	}
+
+	/* Novo bloco (em disco, se a RAM não comportar) e cópia do conteúdo */
+	void *q = memoria_alocar(bytes);
+	if(!q)
+		return NULL;
+	memcpy(q, p, (b->bytes < bytes) ? b->bytes : bytes);
+	memoria_liberar(p);
+	return q;
+}
+
+void memoria_liberar(void *p){
+	if(!p)
+		return;
+
+	memoria_bloco_t *b = (memoria_bloco_t *)((char *)p - MEMORIA_CABECALHO);
+	size_t total = MEMORIA_CABECALHO + b->bytes;
+	if(b->em_disco){
+		atomic_fetch_sub(&em_disco, total);
+		munmap(b, total);
+	} else{
+		atomic_fetch_sub(&em_ram, total);
+		free(b);
+	}
+}
@@ -0,0 +1,22 @@
+/* Memória dos inteiros grandes (bigint.h) com orçamento de RAM
+
+Enquanto o total alocado cabe no orçamento os blocos vêm do malloc. Acima dele cada bloco é um
+arquivo temporário (já removido do diretório) mapeado com mmap: o núcleo grava as páginas no
+disco sob pressão de memória e as traz de volta quando acessadas, então cálculos maiores que a
+RAM continuam possíveis, limitados pelo espaço em disco. Sem orçamento (0, o padrão) toda a
+memória vem do malloc. */
+
+#ifndef MEMORIA_H
+#define MEMORIA_H
+
+#include <stddef.h>
+
+void memoria_configurar(size_t orcamento, const char *diretorio);
+int memoria_cabe(size_t bytes);
+size_t memoria_pico_disco(void);
+
+void *memoria_alocar(size_t bytes);
+void *memoria_realocar(void *p, size_t bytes);
+void memoria_liberar(void *p);
+
+#endif
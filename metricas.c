@@ -0,0 +1,301 @@
+/* Métricas do servidor e endpoint no formato do Prometheus (ver metricas.h) */
+
+#define _GNU_SOURCE // open_memstream
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "metricas.h"
+
+#define METRICAS_TAM_PEDIDO 2048 // Bytes lidos do pedido HTTP (somente a primeira linha importa)
+
+static const struct{
+	const char *nome, *ajuda;
+} contadores[MET_NUM_CONTADORES] = {
+	{"pi_lotes_emitidos_total", "Lotes inéditos ou devolvidos entregues aos clientes"},
+	{"pi_lotes_reemitidos_total", "Cópias de lotes em andamento entregues aos clientes"},
+	{"pi_lotes_concluidos_total", "Resultados de lotes aceitos"},
+	{"pi_lotes_descartados_total", "Resultados atrasados, repetidos ou de trabalhos encerrados"},
+	{"pi_pontos_total", "Pontos sorteados nos lotes concluídos"},
+	{"pi_mensagens_total", "Mensagens recebidas dos clientes"},
+	{"pi_timeouts_total", "Clientes removidos por não responderem"},
+};
+
+static const struct{
+	const char *nome, *ajuda;
+	int n; // Baldes finitos
+	double limites[METRICAS_MAX_BALDES];
+} histogramas[MET_NUM_HISTOGRAMAS] = {
+	{"pi_lote_latencia_segundos", "Tempo entre o envio de um lote e o seu resultado", 13,
+	 {0.001, 0.005, 0.01, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60}},
+	{"pi_rtt_segundos", "Tempo de ida e volta das conexões dos clientes (TCP_INFO) a cada resultado", 14,
+	 {5e-5, 1e-4, 2.5e-4, 5e-4, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1}},
+	{"pi_ocioso_segundos", "Períodos em que um cliente aguardou um lote", 9,
+	 {0.001, 0.01, 0.1, 0.5, 1, 5, 10, 60, 300}},
+};
+
+static met_fatia_t *fatias = NULL;
+static int n_fatias = 0;
+static met_trabalhador_t *trabalhadores = NULL; // Lista dos clientes registrados (mutex)
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static metricas_extra_t extra = NULL;
+static int escutafd = -1;
+
+/* Cria as fatias das threads. Retorna -1 sem memória */
+int metricas_iniciar(int n){
+	fatias = (met_fatia_t *)aligned_alloc(MC_LINHA_CACHE, n*sizeof(met_fatia_t));
+	if(!fatias)
+		return -1;
+	memset(fatias, 0, n*sizeof(met_fatia_t));
+	n_fatias = n;
+	return 0;
+}
+
+met_fatia_t *metricas_fatia(int i){
+	return &fatias[i];
+}
+
+static void metricas_acumular(_Atomic uint64_t *v, uint64_t x){
+	atomic_store_explicit(v, atomic_load_explicit(v, memory_order_relaxed) + x, memory_order_relaxed);
+}
+
+/* Registra uma duração no histograma da fatia da thread atual */
+void metricas_observar(met_fatia_t *f, met_histograma_t h, double segundos){
+	int i = 0;
+	if(segundos < 0)
+		segundos = 0;
+	while(i < histogramas[h].n && segundos > histogramas[h].limites[i])
+		i++;
+	metricas_acumular(&f->baldes[h][i], 1);
+	metricas_acumular(&f->somas[h], (uint64_t)(segundos*1e9));
+}
+
+/* Cria a entrada de um cliente registrado. Retorna NULL sem memória (o cliente fica sem métricas) */
+met_trabalhador_t *metricas_registrar(const char *nome, int uid){
+	met_trabalhador_t *t = (met_trabalhador_t *)calloc(1, sizeof(met_trabalhador_t));
+	if(!t)
+		return NULL;
+	snprintf(t->nome, sizeof(t->nome), "%s", nome);
+	t->uid = uid;
+
+	pthread_mutex_lock(&mutex);
+	t->prox = trabalhadores;
+	if(trabalhadores)
+		trabalhadores->ant = t;
+	trabalhadores = t;
+	pthread_mutex_unlock(&mutex);
+	return t;
+}
+
+/* Remove a entrada do cliente que se desconectou */
+void metricas_remover(met_trabalhador_t *t){
+	if(!t)
+		return;
+	pthread_mutex_lock(&mutex);
+	if(t->ant)
+		t->ant->prox = t->prox;
+	else
+		trabalhadores = t->prox;
+	if(t->prox)
+		t->prox->ant = t->ant;
+	pthread_mutex_unlock(&mutex);
+	free(t);
+}
+
+/* Lote concluído pelo cliente: pontos e tempo desde o envio */
+void metricas_lote(met_trabalhador_t *t, uint64_t pontos, double segundos){
+	if(!t)
+		return;
+	metricas_acumular(&t->pontos, pontos);
+	metricas_acumular(&t->lotes, 1);
+	metricas_acumular(&t->calculo_ns, (uint64_t)(segundos*1e9));
+	atomic_store_explicit(&t->vazao, segundos > 0 ? (uint64_t)(pontos/segundos) : 0, memory_order_relaxed);
+}
+
+/* O cliente passou a aguardar um lote (ocioso = 1) ou recebeu um depois de aguardar segundos */
+void metricas_ocioso(met_trabalhador_t *t, int ocioso, double segundos){
+	if(!t)
+		return;
+	atomic_store_explicit(&t->ocioso, ocioso, memory_order_relaxed);
+	metricas_acumular(&t->ocioso_ns, (uint64_t)(segundos*1e9));
+}
+
+static uint64_t metricas_somar(size_t deslocamento){
+	uint64_t soma = 0;
+	for(int i=0; i<n_fatias; i++)
+		soma += atomic_load_explicit((_Atomic uint64_t *)((char *)&fatias[i] + deslocamento), memory_order_relaxed);
+	return soma;
+}
+
+/* Rótulos do trabalhador, com aspas, barras e quebras de linha do nome escapadas */
+static void metricas_rotulos(FILE *f, const met_trabalhador_t *t){
+	fprintf(f, "{cliente=\"");
+	for(const char *p=t->nome; *p; p++){
+		if(*p == '"' || *p == '\\')
+			fputc('\\', f);
+		if(*p == '\n')
+			fputs("\\n", f);
+		else
+			fputc(*p, f);
+	}
+	fprintf(f, "\",uid=\"%d\"}", t->uid);
+}
+
+/* Escreve todas as métricas no formato de texto do Prometheus */
+void metricas_exportar(FILE *f){
+	for(int c=0; c<MET_NUM_CONTADORES; c++){
+		fprintf(f, "# HELP %s %s\n# TYPE %s counter\n", contadores[c].nome, contadores[c].ajuda, contadores[c].nome);
+		fprintf(f, "%s %llu\n", contadores[c].nome, (unsigned long long)metricas_somar(offsetof(met_fatia_t, contadores) + c*sizeof(uint64_t)));
+	}
+
+	for(int h=0; h<MET_NUM_HISTOGRAMAS; h++){
+		const char *nome = histogramas[h].nome;
+		uint64_t acumulado = 0;
+		fprintf(f, "# HELP %s %s\n# TYPE %s histogram\n", nome, histogramas[h].ajuda, nome);
+		for(int i=0; i<=histogramas[h].n; i++){
+			acumulado += metricas_somar(offsetof(met_fatia_t, baldes) + (h*(METRICAS_MAX_BALDES + 1) + i)*sizeof(uint64_t));
+			if(i < histogramas[h].n)
+				fprintf(f, "%s_bucket{le=\"%g\"} %llu\n", nome, histogramas[h].limites[i], (unsigned long long)acumulado);
+			else
+				fprintf(f, "%s_bucket{le=\"+Inf\"} %llu\n", nome, (unsigned long long)acumulado);
+		}
+		fprintf(f, "%s_sum %.9f\n%s_count %llu\n", nome, metricas_somar(offsetof(met_fatia_t, somas) + h*sizeof(uint64_t))/1e9,
+		        nome, (unsigned long long)acumulado);
+	}
+
+	pthread_mutex_lock(&mutex);
+	int n = 0, ociosos = 0;
+	for(met_trabalhador_t *t=trabalhadores; t; t=t->prox){
+		n++;
+		ociosos += atomic_load_explicit(&t->ocioso, memory_order_relaxed);
+	}
+	fprintf(f, "# HELP pi_trabalhadores Clientes registrados\n# TYPE pi_trabalhadores gauge\npi_trabalhadores %d\n", n);
+	fprintf(f, "# HELP pi_trabalhadores_ociosos Clientes aguardando um lote\n# TYPE pi_trabalhadores_ociosos gauge\npi_trabalhadores_ociosos %d\n", ociosos);
+
+	static const struct{
+		const char *nome, *tipo, *ajuda;
+	} familias[] = {
+		{"pi_trabalhador_pontos_total", "counter", "Pontos dos lotes concluídos pelo cliente"},
+		{"pi_trabalhador_lotes_total", "counter", "Lotes concluídos pelo cliente"},
+		{"pi_trabalhador_vazao_pontos_por_segundo", "gauge", "Vazão do último lote do cliente (envio até o resultado)"},
+		{"pi_trabalhador_calculo_segundos_total", "counter", "Tempo com lotes do cliente, do envio ao resultado"},
+		{"pi_trabalhador_ocioso_segundos_total", "counter", "Tempo em que o cliente aguardou lotes (períodos encerrados)"},
+		{"pi_trabalhador_ocioso", "gauge", "1 enquanto o cliente aguarda um lote"},
+	};
+	for(size_t k=0; k<sizeof(familias)/sizeof(familias[0]); k++){
+		fprintf(f, "# HELP %s %s\n# TYPE %s %s\n", familias[k].nome, familias[k].ajuda, familias[k].nome, familias[k].tipo);
+		for(met_trabalhador_t *t=trabalhadores; t; t=t->prox){
+			fputs(familias[k].nome, f);
+			metricas_rotulos(f, t);
+			switch(k){
+				case 0: fprintf(f, " %llu\n", (unsigned long long)atomic_load_explicit(&t->pontos, memory_order_relaxed)); break;
+				case 1: fprintf(f, " %llu\n", (unsigned long long)atomic_load_explicit(&t->lotes, memory_order_relaxed)); break;
+				case 2: fprintf(f, " %llu\n", (unsigned long long)atomic_load_explicit(&t->vazao, memory_order_relaxed)); break;
+				case 3: fprintf(f, " %.9f\n", atomic_load_explicit(&t->calculo_ns, memory_order_relaxed)/1e9); break;
+				case 4: fprintf(f, " %.9f\n", atomic_load_explicit(&t->ocioso_ns, memory_order_relaxed)/1e9); break;
+				default: fprintf(f, " %d\n", atomic_load_explicit(&t->ocioso, memory_order_relaxed)); break;
+			}
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+
+	if(extra)
+		extra(f);
+}
+
+/* Envia todos os bytes, ignorando falhas (o coletor tenta de novo no próximo intervalo) */
+static void metricas_enviar(int fd, const char *s, size_t n){
+	while(n > 0){
+		ssize_t k = send(fd, s, n, MSG_NOSIGNAL);
+		if(k < 0 && errno == EINTR)
+			continue;
+		if(k <= 0)
+			return;
+		s += k;
+		n -= k;
+	}
+}
+
+/* Atende um pedido HTTP: GET /metrics recebe as métricas, o resto 404 */
+static void metricas_atender(int fd){
+	char pedido[METRICAS_TAM_PEDIDO], cabecalho[256];
+	char *corpo = NULL;
+	size_t n_corpo = 0;
+	struct timeval espera = {1, 0}; // Um coletor lento não prende a thread
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &espera, sizeof(espera));
+
+	ssize_t n = recv(fd, pedido, sizeof(pedido) - 1, 0);
+	if(n <= 0)
+		return;
+	pedido[n] = '\0';
+
+	if(strncmp(pedido, "GET /metrics ", 13) != 0 && strncmp(pedido, "GET /metrics?", 13) != 0){
+		const char *erro = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+		metricas_enviar(fd, erro, strlen(erro));
+		return;
+	}
+
+	FILE *f = open_memstream(&corpo, &n_corpo);
+	if(!f)
+		return;
+	metricas_exportar(f);
+	fclose(f);
+
+	int k = snprintf(cabecalho, sizeof(cabecalho), "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+	                 "Content-Length: %zu\r\nConnection: close\r\n\r\n", n_corpo);
+	metricas_enviar(fd, cabecalho, k);
+	metricas_enviar(fd, corpo, n_corpo);
+	free(corpo);
+}
+
+static void *metricas_executar(void *arg){
+	(void)arg;
+	while(1){
+		int fd = accept(escutafd, NULL, NULL);
+		if(fd < 0){
+			if(errno != EINTR)
+				perror("ERROR: accept (métricas)");
+			continue;
+		}
+		metricas_atender(fd);
+		close(fd);
+	}
+	return NULL;
+}
+
+/* Atende GET /metrics em ip:porta numa thread própria; extra (opcional) acrescenta as medidas do programa.
+Retorna -1 se a porta não pode ser usada */
+int metricas_servir(const char *ip, int porta, metricas_extra_t funcao){
+	int option = 1;
+	struct sockaddr_in addr;
+	pthread_t thread;
+
+	escutafd = socket(AF_INET, SOCK_STREAM, 0);
+	if(escutafd < 0)
+		return -1;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = inet_addr(ip);
+	addr.sin_port = htons(porta);
+	if(setsockopt(escutafd, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option)) < 0 ||
+	   bind(escutafd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(escutafd, 16) < 0){
+		close(escutafd);
+		return -1;
+	}
+
+	extra = funcao;
+	if(pthread_create(&thread, NULL, metricas_executar, NULL) != 0){
+		close(escutafd);
+		return -1;
+	}
+	pthread_detach(thread);
+	return 0;
+}
@@ -0,0 +1,110 @@
+/* Métricas do servidor e marcadores de perfil
+
+Contadores e histogramas ficam em fatias, uma por thread (cada reator do servidor grava somente a
+sua, sem travas nem instruções atômicas de leitura-modificação-escrita); a exportação soma as fatias.
+Os histogramas têm limites fixos em segundos, como os do Prometheus.
+
+Trabalhadores: cada cliente registrado tem uma entrada com os pontos e lotes concluídos, a vazão do
+último lote e os tempos calculando (envio do lote até o resultado) e ocioso (sem lote disponível),
+gravados pelo reator do cliente a cada lote.
+
+metricas_servir atende GET /metrics em uma porta local com tudo no formato de texto do Prometheus,
+mais as medidas que o programa acrescenta (fila de trabalhos) pela função informada.
+
+Marcadores: METRICAS_INICIO(nome) e METRICAS_FIM() delimitam trechos para os perfiladores. Compilado
+com -DMETRICAS_ITT (e -littnotify) são tarefas do Intel ITT (VTune); com -DMETRICAS_SDT são pontos
+USDT (<sys/sdt.h>), ex. perf probe -x ./client sdt_pi:inicio; sem nenhum dos dois não geram código. */
+
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "montecarlo.h"
+
+#if defined(METRICAS_ITT)
+#include <ittnotify.h>
+static inline __itt_domain *metricas_itt_dominio(void){
+	static __itt_domain *dominio = NULL;
+	if(!dominio)
+		dominio = __itt_domain_create("pi");
+	return dominio;
+}
+#define METRICAS_INICIO(nome) do{ \
+	static __itt_string_handle *tarefa_ = NULL; \
+	if(!tarefa_) \
+		tarefa_ = __itt_string_handle_create(nome); \
+	__itt_task_begin(metricas_itt_dominio(), __itt_null, __itt_null, tarefa_); \
+} while(0)
+#define METRICAS_FIM() __itt_task_end(metricas_itt_dominio())
+#elif defined(METRICAS_SDT)
+#include <sys/sdt.h>
+#define METRICAS_INICIO(nome) DTRACE_PROBE1(pi, inicio, nome)
+#define METRICAS_FIM() DTRACE_PROBE(pi, fim)
+#else
+#define METRICAS_INICIO(nome) ((void)0)
+#define METRICAS_FIM() ((void)0)
+#endif
+
+#define METRICAS_TAM_NOME 32
+
+typedef enum{
+	MET_LOTES_EMITIDOS, // Lotes inéditos ou devolvidos entregues
+	MET_LOTES_REEMITIDOS, // Cópias de lotes em andamento entregues
+	MET_LOTES_CONCLUIDOS, // Resultados aceitos pelo escalonador
+	MET_LOTES_DESCARTADOS, // Resultados atrasados, repetidos ou de trabalhos encerrados
+	MET_PONTOS, // Pontos dos lotes concluídos
+	MET_MENSAGENS, // Mensagens recebidas dos clientes
+	MET_TIMEOUTS, // Clientes removidos por não responderem
+	MET_NUM_CONTADORES
+} met_contador_t;
+
+typedef enum{
+	MET_LATENCIA_LOTE, // Envio do lote até o resultado
+	MET_RTT, // Tempo de ida e volta da conexão TCP (estimativa do núcleo) a cada resultado
+	MET_OCIOSO, // Períodos em que um cliente aguardou um lote
+	MET_NUM_HISTOGRAMAS
+} met_histograma_t;
+
+#define METRICAS_MAX_BALDES 16
+
+/* Contadores de uma thread, em linhas de cache próprias. Somente a thread dona grava */
+typedef struct{
+	_Alignas(MC_LINHA_CACHE) _Atomic uint64_t contadores[MET_NUM_CONTADORES];
+	_Atomic uint64_t baldes[MET_NUM_HISTOGRAMAS][METRICAS_MAX_BALDES + 1]; // O último é +Inf
+	_Atomic uint64_t somas[MET_NUM_HISTOGRAMAS]; // Nanossegundos
+} met_fatia_t;
+
+/* Medidas de um cliente registrado (gravadas somente pelo seu reator) */
+typedef struct met_trabalhador{
+	char nome[METRICAS_TAM_NOME];
+	int uid;
+	_Atomic uint64_t pontos, lotes;
+	_Atomic uint64_t vazao; // Pontos por segundo do último lote
+	_Atomic uint64_t calculo_ns, ocioso_ns;
+	atomic_int ocioso; // Aguarda um lote agora
+	struct met_trabalhador *ant, *prox;
+} met_trabalhador_t;
+
+typedef void (*metricas_extra_t)(FILE *f);
+
+int metricas_iniciar(int n_fatias);
+met_fatia_t *metricas_fatia(int i);
+
+/* Soma ao contador da fatia da thread atual */
+static inline void metricas_contar(met_fatia_t *f, met_contador_t c, uint64_t v){
+	atomic_store_explicit(&f->contadores[c], atomic_load_explicit(&f->contadores[c], memory_order_relaxed) + v, memory_order_relaxed);
+}
+
+void metricas_observar(met_fatia_t *f, met_histograma_t h, double segundos);
+
+met_trabalhador_t *metricas_registrar(const char *nome, int uid);
+void metricas_remover(met_trabalhador_t *t);
+void metricas_lote(met_trabalhador_t *t, uint64_t pontos, double segundos);
+void metricas_ocioso(met_trabalhador_t *t, int ocioso, double segundos);
+
+void metricas_exportar(FILE *f);
+int metricas_servir(const char *ip, int porta, metricas_extra_t extra);
+
+#endif
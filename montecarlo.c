@@ -0,0 +1,1015 @@
+/* Motor paralelo do Método de Monte Carlo (ver montecarlo.h) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include "rng.h"
+#include "montecarlo.h"
+#include "topologia.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#endif
+
+/* x*x + y*y não pode virar FMA: o arredondamento mudaria conforme a ISA e os kernels
+deixariam de produzir exatamente a mesma contagem */
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+/* Acumulador de cada thread, em páginas próprias alocadas pela thread (nó NUMA local, ver topologia.h) */
+typedef struct{
+	_Alignas(MC_LINHA_CACHE) mc_resultado_t parcial;
+	uint64_t pontos; // Pontos sorteados pela thread desde a criação do pool
+	double segundos; // Tempo gasto nesses sorteios
+	mc_resultado_t replicas[MC_MAX_REPLICAS]; // Parcial de cada réplica (bloco % replicas)
+} mc_acumulador_t;
+
+/* Identificação de cada thread do pool */
+typedef struct{
+	mc_pool_t *pool;
+	int id;
+} mc_trabalhador_t;
+
+struct mc_pool{
+	int n_threads;
+	pthread_t *threads;
+	mc_trabalhador_t *trabalhadores;
+	mc_acumulador_t **acumuladores; // Um por thread, somados somente ao final da tarefa
+
+	pthread_mutex_t mutex;
+	pthread_cond_t cond_tarefa; // Sinaliza uma nova tarefa (ou o encerramento)
+	pthread_cond_t cond_fim; // Sinaliza que todas as threads terminaram a tarefa
+	unsigned long geracao; // Incrementada a cada nova tarefa
+	int ativas; // Threads que ainda trabalham na tarefa atual
+	int encerrar;
+
+	/* Tarefa atual */
+	uint64_t semente;
+	uint64_t n_pontos;
+	uint64_t bloco_fim;
+	_Atomic uint64_t proximo_bloco; // Próximo bloco a ser sorteado (distribuição dinâmica)
+};
+
+/* Quantidade de blocos necessária para n_pontos */
+uint64_t mc_num_blocos(uint64_t n_pontos){
+	return (n_pontos + MC_TAM_BLOCO - 1)/MC_TAM_BLOCO;
+}
+
+/* Quantidade de pontos do bloco (o último bloco pode ser menor) */
+uint64_t mc_tam_bloco(uint64_t n_pontos, uint64_t bloco){
+	uint64_t inicio = bloco*MC_TAM_BLOCO;
+	if(inicio >= n_pontos)
+		return 0;
+	return (n_pontos - inicio < MC_TAM_BLOCO) ? n_pontos - inicio : MC_TAM_BLOCO;
+}
+
+/* Geradores intercalados de um bloco: o ponto i usa o gerador i%MC_LANES, que sorteia x e depois y.
+O estado fica organizado por palavra (SoA) para ser carregado diretamente em registradores SIMD,
+e todas as implementações (escalar, AVX2, AVX-512) percorrem exatamente a mesma sequência. */
+typedef struct{
+	_Alignas(MC_LINHA_CACHE) uint64_t s[4][MC_LANES];
+} mc_lanes_t;
+
+/* Kernel do teste do círculo: sorteia os n pontos do bloco e retorna quantos caíram dentro */
+typedef uint64_t (*mc_kernel_t)(uint64_t semente, uint64_t bloco, uint64_t n);
+
+/* Inicializa os geradores do bloco (fluxos bloco*MC_LANES ... bloco*MC_LANES + MC_LANES-1) */
+static void mc_lanes_semear(mc_lanes_t *g, uint64_t semente, uint64_t bloco){
+	rng_t rng;
+	for(int l=0; l<MC_LANES; l++){
+		rng_semear(&rng, semente, bloco*MC_LANES + l);
+		for(int k=0; k<4; k++)
+			g->s[k][l] = rng.s[k];
+	}
+}
+
+static inline uint64_t mc_lane_proximo(mc_lanes_t *g, int l){
+	rng_t rng = {{g->s[0][l], g->s[1][l], g->s[2][l], g->s[3][l]}};
+	uint64_t u = rng_proximo(&rng);
+	for(int k=0; k<4; k++)
+		g->s[k][l] = rng.s[k];
+	return u;
+}
+
+/* Teste escalar: utilizado quando não há suporte a SIMD e para os pontos finais do bloco */
+static uint64_t mc_escalar_lanes(mc_lanes_t *g, uint64_t n){
+	uint64_t dentro = 0; // Não há contador de pontos fora: fora = n - dentro
+
+	for(uint64_t i=0; i<n; i+=MC_LANES){
+		int m = (n - i < MC_LANES) ? (int)(n - i) : MC_LANES;
+		for(int l=0; l<m; l++){
+			double x = rng_double(mc_lane_proximo(g, l)); // Gera coordenada x do ponto
+			double y = rng_double(mc_lane_proximo(g, l)); // Gera coordenada y do ponto
+			dentro += (x*x + y*y <= 1.0); // Soma sem desvio condicional
+		}
+	}
+
+	return dentro;
+}
+
+static uint64_t mc_kernel_escalar(uint64_t semente, uint64_t bloco, uint64_t n){
+	mc_lanes_t g;
+	mc_lanes_semear(&g, semente, bloco); // Cada bloco possui os seus próprios fluxos
+	return mc_escalar_lanes(&g, n);
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+/* Kernel AVX2: 2 vetores de 4 geradores */
+__attribute__((target("avx2")))
+static inline __m256i mc_avx2_rotl(__m256i x, int k){
+	return _mm256_or_si256(_mm256_slli_epi64(x, k), _mm256_srli_epi64(x, 64 - k));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i mc_avx2_proximo(__m256i *s){
+	__m256i resultado = _mm256_add_epi64(mc_avx2_rotl(_mm256_add_epi64(s[0], s[3]), 23), s[0]);
+	__m256i t = _mm256_slli_epi64(s[1], 17);
+
+	s[2] = _mm256_xor_si256(s[2], s[0]);
+	s[3] = _mm256_xor_si256(s[3], s[1]);
+	s[1] = _mm256_xor_si256(s[1], s[2]);
+	s[0] = _mm256_xor_si256(s[0], s[3]);
+	s[2] = _mm256_xor_si256(s[2], t);
+	s[3] = mc_avx2_rotl(s[3], 45);
+
+	return resultado;
+}
+
+/* Mesma conversão de rng_double: 52 bits mais altos como mantissa de um número em [1,2) */
+__attribute__((target("avx2")))
+static inline __m256d mc_avx2_coord(__m256i u){
+	const __m256i expoente = _mm256_set1_epi64x(0x3FF0000000000000LL);
+	__m256i bits = _mm256_or_si256(_mm256_srli_epi64(u, 12), expoente);
+	return _mm256_sub_pd(_mm256_castsi256_pd(bits), _mm256_set1_pd(1.0));
+}
+
+__attribute__((target("avx2")))
+static uint64_t mc_kernel_avx2(uint64_t semente, uint64_t bloco, uint64_t n){
+	mc_lanes_t lanes, *g = &lanes;
+	__m256i s[2][4]; // Metade inferior e superior dos geradores
+	__m256i cont[2] = {_mm256_setzero_si256(), _mm256_setzero_si256()};
+	const __m256d um = _mm256_set1_pd(1.0);
+	uint64_t grupos = n/MC_LANES;
+	uint64_t total[4];
+
+	mc_lanes_semear(g, semente, bloco);
+	for(int h=0; h<2; h++)
+		for(int k=0; k<4; k++)
+			s[h][k] = _mm256_load_si256((const __m256i *)&g->s[k][4*h]);
+
+	for(uint64_t i=0; i<grupos; i++){
+		for(int h=0; h<2; h++){
+			__m256d x = mc_avx2_coord(mc_avx2_proximo(s[h]));
+			__m256d y = mc_avx2_coord(mc_avx2_proximo(s[h]));
+			__m256d r = _mm256_add_pd(_mm256_mul_pd(x, x), _mm256_mul_pd(y, y));
+			__m256d dentro = _mm256_cmp_pd(r, um, _CMP_LE_OQ); // -1 (todos os bits) se dentro
+			cont[h] = _mm256_sub_epi64(cont[h], _mm256_castpd_si256(dentro));
+		}
+	}
+
+	for(int h=0; h<2; h++)
+		for(int k=0; k<4; k++)
+			_mm256_store_si256((__m256i *)&g->s[k][4*h], s[h][k]);
+
+	_mm256_storeu_si256((__m256i *)total, _mm256_add_epi64(cont[0], cont[1]));
+	return total[0] + total[1] + total[2] + total[3] + mc_escalar_lanes(g, n - grupos*MC_LANES);
+}
+
+/* Kernel AVX-512: 1 vetor com os 8 geradores */
+__attribute__((target("avx512f")))
+static inline __m512i mc_avx512_proximo(__m512i *s){
+	__m512i resultado = _mm512_add_epi64(_mm512_rol_epi64(_mm512_add_epi64(s[0], s[3]), 23), s[0]);
+	__m512i t = _mm512_slli_epi64(s[1], 17);
+
+	s[2] = _mm512_xor_si512(s[2], s[0]);
+	s[3] = _mm512_xor_si512(s[3], s[1]);
+	s[1] = _mm512_xor_si512(s[1], s[2]);
+	s[0] = _mm512_xor_si512(s[0], s[3]);
+	s[2] = _mm512_xor_si512(s[2], t);
+	s[3] = _mm512_rol_epi64(s[3], 45);
+
+	return resultado;
+}
+
+__attribute__((target("avx512f")))
+static inline __m512d mc_avx512_coord(__m512i u){
+	const __m512i expoente = _mm512_set1_epi64(0x3FF0000000000000LL);
+	__m512i bits = _mm512_or_si512(_mm512_srli_epi64(u, 12), expoente);
+	return _mm512_sub_pd(_mm512_castsi512_pd(bits), _mm512_set1_pd(1.0));
+}
+
+__attribute__((target("avx512f")))
+static uint64_t mc_kernel_avx512(uint64_t semente, uint64_t bloco, uint64_t n){
+	mc_lanes_t lanes, *g = &lanes;
+	__m512i s[4];
+	__m512i cont = _mm512_setzero_si512();
+	const __m512d um = _mm512_set1_pd(1.0);
+	const __m512i incremento = _mm512_set1_epi64(1);
+	uint64_t grupos = n/MC_LANES;
+
+	mc_lanes_semear(g, semente, bloco);
+	for(int k=0; k<4; k++)
+		s[k] = _mm512_load_si512((const void *)g->s[k]);
+
+	for(uint64_t i=0; i<grupos; i++){
+		__m512d x = mc_avx512_coord(mc_avx512_proximo(s));
+		__m512d y = mc_avx512_coord(mc_avx512_proximo(s));
+		__m512d r = _mm512_add_pd(_mm512_mul_pd(x, x), _mm512_mul_pd(y, y));
+		__mmask8 dentro = _mm512_cmp_pd_mask(r, um, _CMP_LE_OQ);
+		cont = _mm512_mask_add_epi64(cont, dentro, cont, incremento);
+	}
+
+	for(int k=0; k<4; k++)
+		_mm512_store_si512((void *)g->s[k], s[k]);
+
+	return (uint64_t)_mm512_reduce_add_epi64(cont) + mc_escalar_lanes(g, n - grupos*MC_LANES);
+}
+
+static int mc_cpu_avx512(void){
+	return __builtin_cpu_supports("avx512f");
+}
+
+static int mc_cpu_avx2(void){
+	return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+#if defined(__GNUC__)
+
+/* Kernels de 32 bits: o corpo é escrito uma única vez com os vetores do GCC/Clang (vector_size) e
+MC_KERNEL32 o instancia para cada combinação de ISA (atributo target), largura do vetor e teste do
+círculo. Cada bloco tem MC_LANES32 geradores xoshiro128++ intercalados, derivados de (semente, bloco)
+como os de 64 bits: um vetor AVX2 leva 8 geradores e um AVX-512 16, o dobro dos kernels em double, e
+todas as instâncias do mesmo teste produzem a mesma contagem.
+
+Testes (mc_selecionar_precisao):
+	float    x e y com 23 bits, no centro de células de 2^-23 ((2k+1)*2^-24 é exato em float), e
+	         x*x + y*y < 1 em precisão simples: dois números de 32 bits por ponto
+	inteiro  um número de 32 bits por ponto, x e y com 16 bits: a célula (x, y) está dentro se o seu
+	         centro está, x(x+1) + y(y+1) < 2^32, sem ponto flutuante
+A resolução menor traz um viés fixo, calculado contando todas as células: 4*fração - PI = -1.2e-7 no
+float e +4.7e-8 no inteiro, abaixo do erro estatístico até cerca de 10^14 e 10^15 pontos. */
+
+typedef struct{
+	_Alignas(MC_LINHA_CACHE) uint32_t s[4][MC_LANES32];
+} mc_lanes32_t;
+
+/* Inicializa os geradores do bloco (fluxos bloco*MC_LANES32 ... bloco*MC_LANES32 + MC_LANES32-1) */
+static void mc_lanes32_semear(mc_lanes32_t *g, uint64_t semente, uint64_t bloco){
+	rng_t rng;
+	for(int l=0; l<MC_LANES32; l++){
+		rng_semear(&rng, semente, bloco*MC_LANES32 + l);
+		for(int k=0; k<4; k++)
+			g->s[k][l] = (uint32_t)(rng.s[k/2] >> (32*(k%2)));
+	}
+}
+
+#define MC_TIPOS32(W) \
+typedef uint32_t mc_u32x##W __attribute__((vector_size(4*W))); \
+typedef int32_t mc_i32x##W __attribute__((vector_size(4*W))); \
+typedef float mc_f32x##W __attribute__((vector_size(4*W)));
+
+MC_TIPOS32(1)
+MC_TIPOS32(8)
+MC_TIPOS32(16)
+
+#define MC_ROTL32(x, k) ((x) << (k) | (x) >> (32 - (k)))
+
+/* Corpos dos testes do círculo: retornam -1 nas lanes com o ponto dentro e 0 nas demais */
+#define MC_TESTE_FLOAT(W, proximo) \
+	mc_f32x##W x = __builtin_convertvector((mc_i32x##W)(proximo(s) >> 8 | 1), mc_f32x##W)*0x1.0p-24f; \
+	mc_f32x##W y = __builtin_convertvector((mc_i32x##W)(proximo(s) >> 8 | 1), mc_f32x##W)*0x1.0p-24f; \
+	return (mc_u32x##W)(x*x + y*y < 1.0f);
+
+/* x(x+1) + y(y+1) < 2^32 equivale a x(x+1) <= 2^32 - 1 - y(y+1), sem transbordar */
+#define MC_TESTE_INTEIRO(W, proximo) \
+	mc_u32x##W u = proximo(s), x = u >> 16, y = u & 0xFFFF; \
+	return (mc_u32x##W)(x*(x + 1) <= ~(y*(y + 1)));
+
+/* Instancia mc_kernel_<nome> com vetores de W lanes, o teste informado e o atributo target da ISA */
+#define MC_KERNEL32(nome, alvo, W, TESTE) \
+alvo static inline mc_u32x##W mc_##nome##_proximo(mc_u32x##W *s){ \
+	mc_u32x##W resultado = MC_ROTL32(s[0] + s[3], 7) + s[0]; \
+	mc_u32x##W t = s[1] << 9; \
+	s[2] ^= s[0]; \
+	s[3] ^= s[1]; \
+	s[1] ^= s[2]; \
+	s[0] ^= s[3]; \
+	s[2] ^= t; \
+	s[3] = MC_ROTL32(s[3], 11); \
+	return resultado; \
+} \
+\
+alvo static inline mc_u32x##W mc_##nome##_teste(mc_u32x##W *s){ \
+	TESTE(W, mc_##nome##_proximo) \
+} \
+\
+alvo static uint64_t mc_kernel_##nome(uint64_t semente, uint64_t bloco, uint64_t n){ \
+	mc_lanes32_t g; \
+	mc_u32x##W s[MC_LANES32/W][4], cont[MC_LANES32/W]; \
+	uint64_t grupos = n/MC_LANES32, dentro = 0; \
+	uint32_t resto = (uint32_t)(n%MC_LANES32); \
+\
+	mc_lanes32_semear(&g, semente, bloco); \
+	for(int h=0; h<MC_LANES32/W; h++){ \
+		for(int k=0; k<4; k++) \
+			memcpy(&s[h][k], &g.s[k][h*W], sizeof(s[h][k])); \
+		cont[h] = s[h][0] ^ s[h][0]; \
+	} \
+\
+	for(uint64_t i=0; i<grupos; i++) \
+		for(int h=0; h<MC_LANES32/W; h++) \
+			cont[h] -= mc_##nome##_teste(s[h]); \
+\
+	for(int h=0; h<MC_LANES32/W && resto; h++){ /* Pontos finais do bloco: somente as primeiras lanes */ \
+		mc_u32x##W lane; \
+		for(int l=0; l<W; l++) \
+			lane[l] = h*W + l; \
+		cont[h] -= mc_##nome##_teste(s[h]) & (mc_u32x##W)(lane < resto); \
+	} \
+\
+	for(int h=0; h<MC_LANES32/W; h++) \
+		for(int l=0; l<W; l++) \
+			dentro += cont[h][l]; \
+	return dentro; \
+}
+
+MC_KERNEL32(escalar_float, , 1, MC_TESTE_FLOAT)
+MC_KERNEL32(escalar_inteiro, , 1, MC_TESTE_INTEIRO)
+#if defined(__x86_64__)
+MC_KERNEL32(avx2_float, __attribute__((target("avx2"))), 8, MC_TESTE_FLOAT)
+MC_KERNEL32(avx2_inteiro, __attribute__((target("avx2"))), 8, MC_TESTE_INTEIRO)
+MC_KERNEL32(avx512_float, __attribute__((target("avx512f"))), 16, MC_TESTE_FLOAT)
+MC_KERNEL32(avx512_inteiro, __attribute__((target("avx512f"))), 16, MC_TESTE_INTEIRO)
+#endif
+
+#endif
+
+/* Kernels disponíveis de cada precisão, do mais rápido para o mais lento */
+static const struct{
+	const char *nome;
+	mc_precisao_t precisao;
+	mc_kernel_t funcao;
+	int (*suportado)(void); // Verifica o suporte da CPU (NULL = sempre disponível)
+} mc_kernels[] = {
+#if defined(__x86_64__) && defined(__GNUC__)
+	{"avx512", MC_DOUBLE, mc_kernel_avx512, mc_cpu_avx512},
+	{"avx2", MC_DOUBLE, mc_kernel_avx2, mc_cpu_avx2},
+#endif
+	{"escalar", MC_DOUBLE, mc_kernel_escalar, NULL},
+#if defined(__GNUC__)
+#if defined(__x86_64__)
+	{"avx512", MC_FLOAT, mc_kernel_avx512_float, mc_cpu_avx512},
+	{"avx2", MC_FLOAT, mc_kernel_avx2_float, mc_cpu_avx2},
+	{"avx512", MC_INTEIRO, mc_kernel_avx512_inteiro, mc_cpu_avx512},
+	{"avx2", MC_INTEIRO, mc_kernel_avx2_inteiro, mc_cpu_avx2},
+#endif
+	{"escalar", MC_FLOAT, mc_kernel_escalar_float, NULL},
+	{"escalar", MC_INTEIRO, mc_kernel_escalar_inteiro, NULL},
+#endif
+};
+
+#define MC_NUM_KERNELS ((int)(sizeof(mc_kernels)/sizeof(mc_kernels[0])))
+
+static const char *mc_precisoes[] = {"double", "float", "inteiro"};
+static mc_precisao_t mc_precisao_atual = MC_DOUBLE;
+static int mc_kernel_atual = -1; // Índice em mc_kernels (-1 = ainda não escolhido)
+static pthread_once_t mc_kernel_once = PTHREAD_ONCE_INIT;
+
+static int mc_kernel_suportado(int i){
+	return mc_kernels[i].suportado == NULL || mc_kernels[i].suportado();
+}
+
+/* Seleciona o kernel da precisão atual pelo nome ("auto" escolhe o melhor suportado pela CPU). Retorna 0 em
+caso de sucesso */
+int mc_selecionar_kernel(const char *nome){
+	for(int i=0; i<MC_NUM_KERNELS; i++){
+		if(mc_kernels[i].precisao != mc_precisao_atual || !mc_kernel_suportado(i))
+			continue;
+		if(strcmp(nome, "auto") == 0 || strcmp(nome, mc_kernels[i].nome) == 0){
+			mc_kernel_atual = i;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/* Seleciona a precisão do teste do círculo (double, float ou inteiro), mantendo a ISA do kernel já
+selecionado. Cada precisão tem a sua própria contagem para a mesma semente. Deve ser chamada antes dos
+sorteios. Retorna 0 em caso de sucesso */
+int mc_selecionar_precisao(const char *nome){
+	for(int i=0; i<(int)(sizeof(mc_precisoes)/sizeof(mc_precisoes[0])); i++){
+		if(strcmp(nome, mc_precisoes[i]) != 0)
+			continue;
+		mc_precisao_t anterior = mc_precisao_atual;
+		const char *isa = (mc_kernel_atual >= 0) ? mc_kernels[mc_kernel_atual].nome : "auto";
+		mc_precisao_atual = (mc_precisao_t)i;
+		if(mc_selecionar_kernel(isa) != 0){
+			mc_precisao_atual = anterior;
+			return -1;
+		}
+		return 0;
+	}
+	return -1;
+}
+
+const char *mc_precisao_nome(void){
+	return mc_precisoes[mc_precisao_atual];
+}
+
+/* Escolha automática, caso nenhum kernel tenha sido selecionado antes do primeiro sorteio */
+static void mc_kernel_inicializar(void){
+	if(mc_kernel_atual < 0)
+		mc_selecionar_kernel("auto");
+}
+
+/* Nome do kernel em uso */
+const char *mc_kernel_nome(void){
+	pthread_once(&mc_kernel_once, mc_kernel_inicializar);
+	return mc_kernels[mc_kernel_atual].nome;
+}
+
+/* Amostragem de baixa discrepância (quasi-Monte Carlo aleatorizado)
+
+O bloco b pertence à réplica b % replicas e cobre os pontos a partir da posição (b / replicas)*MC_TAM_BLOCO
+da sequência da réplica (salto direto até a posição), então cada réplica percorre um prefixo contínuo da
+sua sequência e blocos diferentes nunca repetem pontos. Cada réplica é aleatorizada com as suas próprias
+sementes: Sobol (dimensões 1 e 2, em ordem de Gray) com embaralhamento de Owen, e Halton (bases 2 e 3)
+com o embaralhamento de Owen na base 2 e uma permutação aleatória dos dígitos de cada posição na base 3. */
+
+#define MC_DIGITOS_BASE3 40 // 3^40 < 2^64
+
+static mc_amostragem_t mc_amostragem_atual = MC_PSEUDO;
+static int mc_replicas_atual = 1;
+static mc_estimador_t mc_estimador_atual = MC_ACERTO;
+static const char *mc_amostragens[] = {"pseudo", "sobol", "halton"};
+static uint64_t mc_sobol_direcoes[2][64]; // Números de direção em ponto fixo de 64 bits
+static uint64_t mc_potencias3[MC_DIGITOS_BASE3]; // 3^(MC_DIGITOS_BASE3 - 1 - k): peso do dígito k da base 3
+
+static void mc_qmc_inicializar(void){
+	for(int k=0; k<64; k++){
+		mc_sobol_direcoes[0][k] = 1ULL << (63 - k); // Dimensão 1: van der Corput
+		mc_sobol_direcoes[1][k] = k ? mc_sobol_direcoes[1][k-1] ^ (mc_sobol_direcoes[1][k-1] >> 1) : 1ULL << 63; // Polinômio x + 1
+	}
+	mc_potencias3[MC_DIGITOS_BASE3 - 1] = 1;
+	for(int k=MC_DIGITOS_BASE3 - 1; k>0; k--)
+		mc_potencias3[k-1] = 3*mc_potencias3[k];
+}
+
+/* Seleciona a amostragem pelo nome (pseudo, sobol ou halton) e a quantidade de réplicas independentes
+(1 a MC_MAX_REPLICAS, 0 = padrão: 1 no acerto simples pseudoaleatório, MC_REPLICAS_QMC nos demais). Deve
+ser chamada depois de mc_selecionar_estimador e antes dos sorteios. Retorna 0 em caso de sucesso */
+int mc_selecionar_amostragem(const char *nome, int replicas){
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+	for(int i=0; i<(int)(sizeof(mc_amostragens)/sizeof(mc_amostragens[0])); i++){
+		if(strcmp(nome, mc_amostragens[i]) != 0)
+			continue;
+		if(replicas == 0)
+			replicas = (i == MC_PSEUDO && mc_estimador_atual == MC_ACERTO) ? 1 : MC_REPLICAS_QMC;
+		if(replicas < 1 || replicas > MC_MAX_REPLICAS)
+			return -1;
+		pthread_once(&once, mc_qmc_inicializar);
+		mc_amostragem_atual = (mc_amostragem_t)i;
+		mc_replicas_atual = replicas;
+		return 0;
+	}
+	return -1;
+}
+
+const char *mc_amostragem_nome(void){
+	return mc_amostragens[mc_amostragem_atual];
+}
+
+int mc_replicas(void){
+	return mc_replicas_atual;
+}
+
+static inline uint64_t mc_inverter_bits(uint64_t x){
+	x = __builtin_bswap64(x);
+	x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+	x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+	return ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+}
+
+/* Embaralhamento de Owen por hash (Laine-Karras, Burley): com os bits invertidos, somas, multiplicações e
+x ^= x*par só propagam bits para cima, então cada dígito binário da coordenada é permutado conforme os
+dígitos mais significativos, e a estrutura de rede da sequência é preservada */
+static inline uint64_t mc_embaralhar(uint64_t x, uint64_t semente){
+	x = mc_inverter_bits(x);
+	x += semente;
+	x ^= x*0x6c50b47cd9a4b2e4ULL;
+	x *= (semente >> 31) | 1;
+	x ^= x*0xb82f1e529c87a6b2ULL;
+	x ^= x*0xc7afe638f3e1d19aULL;
+	x ^= x*0x8d22f6e6a5b1c3d4ULL;
+	return mc_inverter_bits(x);
+}
+
+/* Os 53 bits mais altos como double em [0,1) */
+static inline double mc_unitario(uint64_t u){
+	return (u >> 11)*0x1.0p-53;
+}
+
+/* Sementes da aleatorização da réplica */
+static void mc_qmc_sementes(uint64_t semente, uint64_t replica, uint64_t *s, int n){
+	rng_t rng;
+	rng_semear(&rng, semente ^ 0x51AB0C0DEULL, replica);
+	for(int i=0; i<n; i++)
+		s[i] = rng_proximo(&rng);
+}
+
+static uint64_t mc_bloco_sobol(uint64_t semente, uint64_t bloco, uint64_t n){
+	uint64_t i = (bloco/mc_replicas_atual)*MC_TAM_BLOCO, gray = i ^ (i >> 1);
+	uint64_t x = 0, y = 0, dentro = 0, s[2];
+
+	mc_qmc_sementes(semente, bloco % mc_replicas_atual, s, 2);
+	for(int k=0; k<64; k++){ // Salto direto até o ponto i
+		if(gray >> k & 1){
+			x ^= mc_sobol_direcoes[0][k];
+			y ^= mc_sobol_direcoes[1][k];
+		}
+	}
+	for(uint64_t j=0; j<n; j++){
+		if(j > 0){ // Ordem de Gray: o ponto seguinte difere em uma única direção
+			int c = __builtin_ctzll(i + j);
+			x ^= mc_sobol_direcoes[0][c];
+			y ^= mc_sobol_direcoes[1][c];
+		}
+		double px = mc_unitario(mc_embaralhar(x, s[0]));
+		double py = mc_unitario(mc_embaralhar(y, s[1]));
+		dentro += (px*px + py*py <= 1.0);
+	}
+	return dentro;
+}
+
+static uint64_t mc_bloco_halton(uint64_t semente, uint64_t bloco, uint64_t n){
+	uint64_t i = (bloco/mc_replicas_atual)*MC_TAM_BLOCO, dentro = 0, s[2], y = 0;
+	uint8_t digitos[MC_DIGITOS_BASE3], perm[MC_DIGITOS_BASE3][3];
+	static const uint8_t permutacoes[6][3] = {{0,1,2}, {0,2,1}, {1,0,2}, {1,2,0}, {2,0,1}, {2,1,0}};
+
+	mc_qmc_sementes(semente, bloco % mc_replicas_atual, s, 2);
+	rng_t rng;
+	rng_semear(&rng, s[1], 3);
+	for(int k=0; k<MC_DIGITOS_BASE3; k++){ // Permutação dos dígitos de cada posição e dígitos de i na base 3
+		memcpy(perm[k], permutacoes[rng_proximo(&rng) % 6], 3);
+		digitos[k] = 0;
+	}
+	for(uint64_t q=i, k=0; q>0; q/=3, k++)
+		digitos[k] = (uint8_t)(q % 3);
+	for(int k=0; k<MC_DIGITOS_BASE3; k++)
+		y += perm[k][digitos[k]]*mc_potencias3[k];
+
+	for(uint64_t j=0; j<n; j++){
+		if(j > 0){ // Soma 1 na base 3, atualizando somente os dígitos que mudam
+			for(int k=0; k<MC_DIGITOS_BASE3; k++){
+				y -= perm[k][digitos[k]]*mc_potencias3[k];
+				digitos[k] = (digitos[k] == 2) ? 0 : digitos[k] + 1;
+				y += perm[k][digitos[k]]*mc_potencias3[k];
+				if(digitos[k] != 0)
+					break;
+			}
+		}
+		double px = mc_unitario(mc_embaralhar(mc_inverter_bits(i + j), s[0]));
+		double py = y*(1.0/((double)mc_potencias3[0]*3));
+		dentro += (px*px + py*py <= 1.0);
+	}
+	return dentro;
+}
+
+/* Estimadores com redução de variância
+
+Alternativas ao acerto simples (ponto dentro ou fora) com a mesma interpretação da contagem: dentro/total
+estima PI/4 sem viés, então as somas exatas, os prefixos e os checkpoints do servidor não mudam. O erro de
+cada um vem da dispersão entre réplicas ou lotes (mc_estimar_replicas, mc_estimar_lotes); o erro binomial
+de mc_estimar continua valendo como limite superior, pois cada amostra fica entre 0 e 1.
+	antitetico     cada sorteio (x, y) conta também o ponto (1-x, 1-y), negativamente correlacionado
+	estratificado  o bloco é uma grade de MC_LADO_ESTRATOS x MC_LADO_ESTRATOS células com um ponto em
+	               cada; o último bloco, incompleto, usa o acerto simples para não ter viés
+	controle       média de sqrt(1 - x^2) (área sob o quarto de círculo) com a variável de controle x^2,
+	               de média 1/3: sqrt(1 - x^2) + c(x^2 - 1/3). O bloco soma os valores em double e
+	               arredonda a soma para um inteiro sorteando a fração, também sem viés
+Cada bloco usa o fluxo `bloco` do gerador, então a contagem depende somente de (semente, n_pontos, estimador). */
+
+#define MC_LADO_ESTRATOS 256 // MC_LADO_ESTRATOS^2 = MC_TAM_BLOCO
+#define MC_COEF_CONTROLE 0.7363 // Coeficiente ótimo 45*PI/192 arredondado (qualquer valor mantém o estimador sem viés)
+
+static const char *mc_estimadores[] = {"acerto", "antitetico", "estratificado", "controle"};
+
+/* Índice do estimador pelo nome (acerto, antitetico, estratificado ou controle), ou -1 se não existe */
+int mc_estimador_id(const char *nome){
+	for(int i=0; i<(int)(sizeof(mc_estimadores)/sizeof(mc_estimadores[0])); i++)
+		if(strcmp(nome, mc_estimadores[i]) == 0)
+			return i;
+	return -1;
+}
+
+/* Seleciona o estimador (deve ser chamada antes dos sorteios). Retorna 0 em caso de sucesso */
+int mc_selecionar_estimador(int estimador){
+	if(estimador < 0 || estimador >= (int)(sizeof(mc_estimadores)/sizeof(mc_estimadores[0])))
+		return -1;
+	mc_estimador_atual = (mc_estimador_t)estimador;
+	return 0;
+}
+
+mc_estimador_t mc_estimador(void){
+	return mc_estimador_atual;
+}
+
+const char *mc_estimador_nome(void){
+	return mc_estimadores[mc_estimador_atual];
+}
+
+/* Nome de um estimador sem selecioná-lo (ex. o de cada trabalho do servidor) */
+const char *mc_estimador_nome_id(mc_estimador_t estimador){
+	if((int)estimador < 0 || (int)estimador >= (int)(sizeof(mc_estimadores)/sizeof(mc_estimadores[0])))
+		return "?";
+	return mc_estimadores[estimador];
+}
+
+static uint64_t mc_bloco_antitetico(uint64_t semente, uint64_t bloco, uint64_t n){
+	rng_t rng;
+	uint64_t dentro = 0;
+
+	rng_semear(&rng, semente, bloco);
+	for(uint64_t j=0; j<n; j+=2){
+		double x = gera_coord(&rng), y = gera_coord(&rng);
+		dentro += (x*x + y*y <= 1.0);
+		if(j + 1 < n) // Par antitético
+			dentro += ((1 - x)*(1 - x) + (1 - y)*(1 - y) <= 1.0);
+	}
+	return dentro;
+}
+
+static uint64_t mc_bloco_estratificado(uint64_t semente, uint64_t bloco, uint64_t n){
+	rng_t rng;
+	uint64_t dentro = 0;
+
+	rng_semear(&rng, semente, bloco);
+	if(n < MC_TAM_BLOCO){ // Estratos incompletos
+		for(uint64_t j=0; j<n; j++){
+			double x = gera_coord(&rng), y = gera_coord(&rng);
+			dentro += (x*x + y*y <= 1.0);
+		}
+		return dentro;
+	}
+	for(int i=0; i<MC_LADO_ESTRATOS; i++){
+		for(int k=0; k<MC_LADO_ESTRATOS; k++){ // Um ponto na célula (k, i)
+			double x = (k + gera_coord(&rng))*(1.0/MC_LADO_ESTRATOS);
+			double y = (i + gera_coord(&rng))*(1.0/MC_LADO_ESTRATOS);
+			dentro += (x*x + y*y <= 1.0);
+		}
+	}
+	return dentro;
+}
+
+static uint64_t mc_bloco_controle(uint64_t semente, uint64_t bloco, uint64_t n){
+	rng_t rng;
+	double soma = 0;
+
+	rng_semear(&rng, semente, bloco);
+	for(uint64_t j=0; j<n; j++){
+		double x = gera_coord(&rng);
+		soma += sqrt(1 - x*x) + MC_COEF_CONTROLE*(x*x - 1.0/3); // Entre 0.49 e 0.88
+	}
+	return (uint64_t)(soma + gera_coord(&rng)); // Arredondamento sorteado: em média, exatamente a soma
+}
+
+/* Sorteia os n pontos do bloco e retorna quantos caíram dentro do círculo */
+uint64_t montecarlo_bloco(uint64_t semente, uint64_t bloco, uint64_t n){
+	if(mc_amostragem_atual == MC_SOBOL)
+		return mc_bloco_sobol(semente, bloco, n);
+	if(mc_amostragem_atual == MC_HALTON)
+		return mc_bloco_halton(semente, bloco, n);
+	if(mc_estimador_atual == MC_ANTITETICO)
+		return mc_bloco_antitetico(semente, bloco, n);
+	if(mc_estimador_atual == MC_ESTRATIFICADO)
+		return mc_bloco_estratificado(semente, bloco, n);
+	if(mc_estimador_atual == MC_CONTROLE)
+		return mc_bloco_controle(semente, bloco, n);
+
+	pthread_once(&mc_kernel_once, mc_kernel_inicializar);
+	return mc_kernels[mc_kernel_atual].funcao(semente, bloco, n);
+}
+
+/* Inversa da função de distribuição normal padrão (algoritmo de Acklam, erro relativo < 1.2e-9) */
+double mc_quantil_normal(double p){
+	static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+	                           1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+	static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+	                           6.680131188771972e+01, -1.328068155288572e+01};
+	static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+	                           -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+	static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+	                           3.754408661907416e+00};
+	const double p_baixo = 0.02425;
+	double q, r;
+
+	if(p <= 0.0)
+		return -INFINITY;
+	if(p >= 1.0)
+		return INFINITY;
+
+	if(p < p_baixo){ // Cauda inferior
+		q = sqrt(-2*log(p));
+		return (((((c[0]*q+c[1])*q+c[2])*q+c[3])*q+c[4])*q+c[5]) / ((((d[0]*q+d[1])*q+d[2])*q+d[3])*q+1);
+	}
+	if(p > 1 - p_baixo){ // Cauda superior
+		q = sqrt(-2*log(1-p));
+		return -(((((c[0]*q+c[1])*q+c[2])*q+c[3])*q+c[4])*q+c[5]) / ((((d[0]*q+d[1])*q+d[2])*q+d[3])*q+1);
+	}
+	q = p - 0.5; // Região central
+	r = q*q;
+	return (((((a[0]*r+a[1])*r+a[2])*r+a[3])*r+a[4])*r+a[5])*q / (((((b[0]*r+b[1])*r+b[2])*r+b[3])*r+b[4])*r+1);
+}
+
+/* Estimativa de PI e intervalo de confiança (bilateral) a partir da contagem de pontos.
+A proporção é ajustada (Agresti-Coull) para que poucos pontos não produzam erro zero */
+mc_estimativa_t mc_estimar(mc_resultado_t r, double confianca){
+	mc_estimativa_t e = {0, INFINITY, INFINITY};
+	double z = mc_quantil_normal(0.5 + confianca/2);
+
+	if(r.total == 0)
+		return e;
+
+	double n = (double)r.total;
+	double p = (double)r.dentro/n;
+	double n_aj = n + z*z;
+	double p_aj = ((double)r.dentro + z*z/2)/n_aj;
+
+	e.pi = 4.0*p;
+	e.erro_padrao = 4.0*sqrt(p_aj*(1 - p_aj)/n_aj);
+	e.semi_intervalo = z*e.erro_padrao;
+	return e;
+}
+
+/* Quantil da distribuição t de Student com gl graus de liberdade (exato para 1 e 2, expansão de
+Cornish-Fisher, Abramowitz e Stegun 26.7.5, para os demais) */
+double mc_quantil_t(double p, int gl){
+	if(gl == 1)
+		return tan(M_PI*(p - 0.5));
+	if(gl == 2)
+		return (2*p - 1)/sqrt(2*p*(1 - p));
+
+	double z = mc_quantil_normal(p), z2 = z*z, v = gl;
+	double g1 = (z2 + 1)*z/4;
+	double g2 = ((5*z2 + 16)*z2 + 3)*z/96;
+	double g3 = (((3*z2 + 19)*z2 + 17)*z2 - 15)*z/384;
+	double g4 = ((((79*z2 + 776)*z2 + 1482)*z2 - 1920)*z2 - 945)*z/92160;
+	return z + g1/v + g2/(v*v) + g3/(v*v*v) + g4/(v*v*v*v);
+}
+
+/* Estimativa a partir das contagens das réplicas independentes (quasi-Monte Carlo aleatorizado): PI da
+contagem total e erro padrão pela dispersão entre as estimativas das réplicas, com o quantil t. Com menos
+de duas réplicas com pontos, recai na estimativa binomial de mc_estimar */
+mc_estimativa_t mc_estimar_replicas(const mc_resultado_t *por_replica, int replicas, double confianca){
+	mc_resultado_t r = {0, 0};
+	double media = 0, desvios = 0;
+	int k = 0;
+
+	for(int i=0; i<replicas; i++){
+		r.dentro += por_replica[i].dentro;
+		r.total += por_replica[i].total;
+		if(por_replica[i].total > 0){
+			media += 4.0*por_replica[i].dentro/por_replica[i].total;
+			k++;
+		}
+	}
+	if(k < 2)
+		return mc_estimar(r, confianca);
+
+	media /= k;
+	for(int i=0; i<replicas; i++){ // Segunda passagem: as estimativas diferem pouco da média
+		if(por_replica[i].total > 0){
+			double d = 4.0*por_replica[i].dentro/por_replica[i].total - media;
+			desvios += d*d;
+		}
+	}
+
+	mc_estimativa_t e;
+	e.pi = 4.0*r.dentro/r.total;
+	e.erro_padrao = sqrt(desvios/(k - 1)/k);
+	e.semi_intervalo = mc_quantil_t(0.5 + confianca/2, k - 1)*e.erro_padrao;
+	return e;
+}
+
+/* Estimativa pelas médias de lotes consecutivos (batch means) do prefixo de um trabalho: PI da contagem total
+e erro padrão pela dispersão entre as frações dos lotes, desvios = soma de total_i*(fração_i - média)^2
+(acumulada por mc_acumular_lote). Com menos de dois lotes recai na estimativa binomial de mc_estimar */
+mc_estimativa_t mc_estimar_lotes(mc_resultado_t r, double desvios, uint64_t lotes, double confianca){
+	if(lotes < 2 || r.total == 0)
+		return mc_estimar(r, confianca);
+
+	mc_estimativa_t e;
+	e.pi = 4.0*r.dentro/r.total;
+	e.erro_padrao = 4.0*sqrt(desvios/(lotes - 1)/r.total);
+	e.semi_intervalo = mc_quantil_t(0.5 + confianca/2, lotes - 1 > (uint64_t)INT32_MAX ? INT32_MAX : (int)(lotes - 1))*e.erro_padrao;
+	return e;
+}
+
+/* Acrescenta um lote à média ponderada e aos desvios de mc_estimar_lotes (algoritmo de West, estável) */
+void mc_acumular_lote(double *media, double *desvios, uint64_t total_anterior, mc_resultado_t lote){
+	if(lote.total == 0)
+		return;
+	double fracao = (double)lote.dentro/lote.total, delta = fracao - *media;
+	*media += delta*lote.total/(total_anterior + lote.total);
+	*desvios += lote.total*delta*(fracao - *media);
+}
+
+/* Verifica se o intervalo de confiança já é menor que o erro desejado */
+int mc_convergiu(mc_resultado_t r, double erro_alvo, double confianca){
+	return erro_alvo > 0 && mc_estimar(r, confianca).semi_intervalo <= erro_alvo;
+}
+
+/* Número de processadores disponíveis */
+int mc_num_cpus(void){
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return (n > 0) ? (int)n : 1;
+}
+
+/* Tempo de parede em segundos (relógio monotônico) */
+double mc_relogio(void){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec/1000000000.0;
+}
+
+/* Laço de cada thread: aguarda uma tarefa e retira blocos até esgotá-los */
+static void *mc_trabalhador(void *arg){
+	mc_trabalhador_t *t = (mc_trabalhador_t *)arg;
+	mc_pool_t *pool = t->pool;
+	unsigned long vista = 0; // Última geração processada
+
+	/* Fixa a thread (política de topologia.h) antes de tocar a memória do seu acumulador */
+	topo_fixar(t->id);
+	mc_acumulador_t *acumulador = (mc_acumulador_t *)topo_alocar_local(sizeof(mc_acumulador_t));
+	if(!acumulador){
+		perror("ERROR: malloc");
+		exit(EXIT_FAILURE);
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->acumuladores[t->id] = acumulador;
+	if(--pool->ativas == 0)
+		pthread_cond_signal(&pool->cond_fim);
+	while(1){
+		while(pool->geracao == vista && !pool->encerrar)
+			pthread_cond_wait(&pool->cond_tarefa, &pool->mutex);
+		if(pool->encerrar)
+			break;
+		vista = pool->geracao;
+		pthread_mutex_unlock(&pool->mutex);
+
+		mc_resultado_t parcial = {0, 0};
+		mc_resultado_t *replicas = acumulador->replicas;
+		uint64_t bloco;
+		double inicio = mc_relogio();
+		memset(replicas, 0, mc_replicas_atual*sizeof(mc_resultado_t));
+		while((bloco = atomic_fetch_add(&pool->proximo_bloco, 1)) < pool->bloco_fim){
+			uint64_t n = mc_tam_bloco(pool->n_pontos, bloco);
+			uint64_t dentro = montecarlo_bloco(pool->semente, bloco, n);
+			parcial.dentro += dentro;
+			parcial.total += n;
+			replicas[bloco % mc_replicas_atual].dentro += dentro;
+			replicas[bloco % mc_replicas_atual].total += n;
+		}
+		acumulador->parcial = parcial;
+		acumulador->pontos += parcial.total;
+		acumulador->segundos += mc_relogio() - inicio;
+
+		pthread_mutex_lock(&pool->mutex);
+		if(--pool->ativas == 0)
+			pthread_cond_signal(&pool->cond_fim);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	return NULL;
+}
+
+/* Cria o pool com n_threads threads (n_threads <= 0 utiliza todos os processadores) */
+mc_pool_t *mc_pool_criar(int n_threads){
+	if(n_threads <= 0)
+		n_threads = mc_num_cpus();
+
+	mc_pool_t *pool = (mc_pool_t *)calloc(1, sizeof(mc_pool_t));
+	if(!pool)
+		return NULL;
+
+	pool->n_threads = n_threads;
+	pool->threads = (pthread_t *)calloc(n_threads, sizeof(pthread_t));
+	pool->trabalhadores = (mc_trabalhador_t *)calloc(n_threads, sizeof(mc_trabalhador_t));
+	pool->acumuladores = (mc_acumulador_t **)calloc(n_threads, sizeof(mc_acumulador_t *));
+	if(!pool->threads || !pool->trabalhadores || !pool->acumuladores){
+		free(pool->threads);
+		free(pool->trabalhadores);
+		free(pool->acumuladores);
+		free(pool);
+		return NULL;
+	}
+
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->cond_tarefa, NULL);
+	pthread_cond_init(&pool->cond_fim, NULL);
+	atomic_init(&pool->proximo_bloco, 0);
+
+	pool->ativas = n_threads; // Cada thread avisa quando o seu acumulador estiver alocado
+	for(int i=0; i<n_threads; i++){
+		pool->trabalhadores[i].pool = pool;
+		pool->trabalhadores[i].id = i;
+		if(pthread_create(&pool->threads[i], NULL, mc_trabalhador, &pool->trabalhadores[i]) != 0){
+			perror("ERROR: pthread");
+			exit(EXIT_FAILURE);
+		}
+	}
+	pthread_mutex_lock(&pool->mutex);
+	while(pool->ativas > 0)
+		pthread_cond_wait(&pool->cond_fim, &pool->mutex);
+	pthread_mutex_unlock(&pool->mutex);
+
+	return pool;
+}
+
+int mc_pool_threads(const mc_pool_t *pool){
+	return pool->n_threads;
+}
+
+/* Pontos sorteados pela thread e o tempo gasto neles desde a criação do pool (fora de mc_pool_executar) */
+void mc_pool_vazao(const mc_pool_t *pool, int thread, uint64_t *pontos, double *segundos){
+	*pontos = pool->acumuladores[thread]->pontos;
+	*segundos = pool->acumuladores[thread]->segundos;
+}
+
+/* Sorteia os blocos [bloco_ini, bloco_fim) de um total de n_pontos com todas as threads do pool */
+mc_resultado_t mc_pool_executar(mc_pool_t *pool, uint64_t semente, uint64_t n_pontos, uint64_t bloco_ini, uint64_t bloco_fim){
+	mc_resultado_t resultado = {0, 0};
+
+	if(bloco_fim > mc_num_blocos(n_pontos))
+		bloco_fim = mc_num_blocos(n_pontos);
+	if(bloco_ini >= bloco_fim)
+		return resultado;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->semente = semente;
+	pool->n_pontos = n_pontos;
+	pool->bloco_fim = bloco_fim;
+	atomic_store(&pool->proximo_bloco, bloco_ini);
+	pool->ativas = pool->n_threads;
+	pool->geracao++;
+	pthread_cond_broadcast(&pool->cond_tarefa);
+
+	while(pool->ativas > 0) // Aguarda todas as threads terminarem
+		pthread_cond_wait(&pool->cond_fim, &pool->mutex);
+	pthread_mutex_unlock(&pool->mutex);
+
+	/* Redução final dos acumuladores */
+	for(int i=0; i<pool->n_threads; i++){
+		resultado.dentro += pool->acumuladores[i]->parcial.dentro;
+		resultado.total += pool->acumuladores[i]->parcial.total;
+	}
+
+	return resultado;
+}
+
+/* Soma a por_replica as contagens de cada réplica da última execução (fora de mc_pool_executar) */
+void mc_pool_replicas(const mc_pool_t *pool, mc_resultado_t *por_replica){
+	for(int i=0; i<pool->n_threads; i++){
+		for(int r=0; r<mc_replicas_atual; r++){
+			por_replica[r].dentro += pool->acumuladores[i]->replicas[r].dentro;
+			por_replica[r].total += pool->acumuladores[i]->replicas[r].total;
+		}
+	}
+}
+
+/* Encerra as threads e libera o pool */
+void mc_pool_destruir(mc_pool_t *pool){
+	if(!pool)
+		return;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->encerrar = 1;
+	pthread_cond_broadcast(&pool->cond_tarefa);
+	pthread_mutex_unlock(&pool->mutex);
+
+	for(int i=0; i<pool->n_threads; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	pthread_mutex_destroy(&pool->mutex);
+	pthread_cond_destroy(&pool->cond_tarefa);
+	pthread_cond_destroy(&pool->cond_fim);
+	for(int i=0; i<pool->n_threads; i++)
+		free(pool->acumuladores[i]);
+	free(pool->threads);
+	free(pool->trabalhadores);
+	free(pool->acumuladores);
+	free(pool);
+}
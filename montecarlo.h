@@ -0,0 +1,109 @@
+/* Motor paralelo do Método de Monte Carlo
+
+Os pontos são divididos em blocos de MC_TAM_BLOCO pontos. O bloco b é sorteado sempre
+com o fluxo b do gerador (rng.h), portanto o número de pontos dentro do círculo depende
+apenas de (semente, n_pontos) e não da quantidade de threads, processos ou clientes
+que dividiram o trabalho.
+
+O teste do círculo é feito em lotes por kernels SIMD (AVX-512, AVX2) escolhidos em tempo
+de execução conforme a CPU, com um kernel escalar como alternativa. Todos produzem a mesma
+contagem para a mesma semente. Além do teste em double, mc_selecionar_precisao escolhe os kernels
+de 32 bits (float ou inteiro, com o dobro de pontos por instrução), que têm contagens próprias.
+
+Quasi-Monte Carlo: com mc_selecionar_amostragem os pontos vêm das sequências de Sobol ou Halton
+aleatorizadas, com erro que cai quase como 1/N em vez de 1/sqrt(N). Os blocos são distribuídos entre
+réplicas independentes (bloco % replicas), cada uma com a sua aleatorização e percorrendo a sua
+sequência em ordem, e o erro é estimado pela dispersão entre as réplicas (mc_estimar_replicas). A
+contagem continua dependendo somente de (semente, n_pontos, amostragem, réplicas).
+
+Redução de variância: mc_selecionar_estimador troca o acerto simples pelos estimadores antitético,
+estratificado ou com variável de controle (ver montecarlo.c), que mantêm dentro/total como estimativa
+sem viés de PI/4 e reportam o próprio erro pelas réplicas ou lotes.
+
+Posicionamento: a thread i do pool se fixa na posição i da política de topologia.h (topo_configurar,
+antes de mc_pool_criar) e aloca o próprio acumulador, que fica no seu nó NUMA. */
+
+#ifndef MONTECARLO_H
+#define MONTECARLO_H
+
+#include <stdint.h>
+
+#define MC_TAM_BLOCO (1ULL << 16) // Quantidade de pontos por bloco
+#define MC_LANES 8 // Geradores intercalados em cada bloco (largura do kernel AVX-512)
+#define MC_LANES32 16 // Geradores de 32 bits intercalados em cada bloco (kernels float e inteiro)
+#define MC_LINHA_CACHE 64 // Tamanho da linha de cache, evita falso compartilhamento entre threads
+#define MC_PONTOS_ILIMITADO (1ULL << 62) // Limite usado quando o cálculo termina somente pela convergência
+#define MC_CONFIANCA 0.99 // Nível de confiança padrão dos intervalos exibidos
+#define MC_MAX_REPLICAS 64 // Réplicas independentes da amostragem
+#define MC_REPLICAS_QMC 16 // Réplicas padrão das sequências de baixa discrepância
+
+/* Precisão do teste do círculo */
+typedef enum{
+	MC_DOUBLE, // Coordenadas com 52 bits
+	MC_FLOAT, // Coordenadas com 23 bits em precisão simples
+	MC_INTEIRO // Coordenadas com 16 bits, teste em inteiros de 32 bits
+} mc_precisao_t;
+
+/* Estimador de PI/4 em cada bloco */
+typedef enum{
+	MC_ACERTO, // Fração dos pontos dentro do círculo
+	MC_ANTITETICO,
+	MC_ESTRATIFICADO,
+	MC_CONTROLE
+} mc_estimador_t;
+
+typedef enum{
+	MC_PSEUDO, // xoshiro256++ (rng.h)
+	MC_SOBOL,
+	MC_HALTON
+} mc_amostragem_t;
+
+/* Resultado (parcial ou total) de um sorteio */
+typedef struct{
+	uint64_t dentro; // Pontos dentro do círculo
+	uint64_t total; // Pontos sorteados
+} mc_resultado_t;
+
+/* Estimativa de PI com o seu erro */
+typedef struct{
+	double pi;
+	double erro_padrao; // Desvio padrão do estimador 4*dentro/total
+	double semi_intervalo; // Metade do intervalo de confiança (PI ± semi_intervalo)
+} mc_estimativa_t;
+
+typedef struct mc_pool mc_pool_t;
+
+uint64_t mc_num_blocos(uint64_t n_pontos);
+uint64_t mc_tam_bloco(uint64_t n_pontos, uint64_t bloco);
+uint64_t montecarlo_bloco(uint64_t semente, uint64_t bloco, uint64_t n);
+int mc_num_cpus(void);
+double mc_relogio(void);
+int mc_selecionar_kernel(const char *nome);
+const char *mc_kernel_nome(void);
+int mc_selecionar_precisao(const char *nome);
+const char *mc_precisao_nome(void);
+int mc_estimador_id(const char *nome);
+int mc_selecionar_estimador(int estimador);
+mc_estimador_t mc_estimador(void);
+const char *mc_estimador_nome(void);
+const char *mc_estimador_nome_id(mc_estimador_t estimador);
+int mc_selecionar_amostragem(const char *nome, int replicas);
+const char *mc_amostragem_nome(void);
+int mc_replicas(void);
+
+double mc_quantil_normal(double p);
+mc_estimativa_t mc_estimar(mc_resultado_t r, double confianca);
+double mc_quantil_t(double p, int gl);
+mc_estimativa_t mc_estimar_replicas(const mc_resultado_t *por_replica, int replicas, double confianca);
+mc_estimativa_t mc_estimar_lotes(mc_resultado_t r, double desvios, uint64_t lotes, double confianca);
+void mc_acumular_lote(double *media, double *desvios, uint64_t total_anterior, mc_resultado_t lote);
+int mc_convergiu(mc_resultado_t r, double erro_alvo, double confianca);
+
+mc_pool_t *mc_pool_criar(int n_threads);
+int mc_pool_threads(const mc_pool_t *pool);
+void mc_pool_vazao(const mc_pool_t *pool, int thread, uint64_t *pontos, double *segundos);
+mc_resultado_t mc_pool_executar(mc_pool_t *pool, uint64_t semente, uint64_t n_pontos, uint64_t bloco_ini, uint64_t bloco_fim);
+void mc_pool_replicas(const mc_pool_t *pool, mc_resultado_t *por_replica);
+void mc_pool_destruir(mc_pool_t *pool);
+
+#endif
@@ -1,61 +1,327 @@
+/* COMPILAÇÃO:
+gcc -O2 -pthread -o montecarlo_pi montecarlo_pi.c montecarlo.c topologia.c chudnovsky.c bigint.c ntt.c memoria.c checkpoint.c -lm
+
+EXECUÇÃO:
+./montecarlo_pi [-n numero_pontos] [-t numero_threads] [-s semente] [-k kernel]
+                [-e erro_alvo] [-g confianca] [-i intervalo_seg] [-d digitos]
+                [-m memoria_MiB] [-w diretorio] [-C checkpoint] [-P periodo_seg] [-R]
+                [-q amostragem] [-r replicas] [-p precisao] [-E estimador] [-a afinidade]
+(sem -t utiliza todos os processadores da máquina; kernel: auto, avx512, avx2 ou escalar)
+
+Afinidade: -a compacta, espalhada ou fisica fixa cada thread do sorteio em uma CPU conforme a topologia
+da máquina (nós NUMA, pacotes e núcleos, ver topologia.h), com o estado de cada thread no seu nó, ex.
+./montecarlo_pi -n 100000000000 -a fisica (padrão nenhuma: o sistema distribui as threads)
+
+Precisão: -p float ou -p inteiro usa os kernels de 32 bits, com o dobro de pontos por instrução SIMD e
+um viés fixo abaixo de 1.2e-7 (ver montecarlo.c), ex. ./montecarlo_pi -n 10000000000 -p inteiro
+
+Redução de variância: -E antitetico, estratificado ou controle troca o acerto simples por um estimador de
+menor variância, com o erro estimado pelas réplicas (padrão 16), ex. ./montecarlo_pi -E controle -e 1e-6
+
+Quasi-Monte Carlo: -q sobol ou -q halton troca o sorteio pseudoaleatório pelas sequências de baixa
+discrepância aleatorizadas, com erro bem menor para os mesmos pontos; o erro é estimado pela dispersão
+entre -r réplicas independentes (padrão 16), ex. ./montecarlo_pi -n 100000000 -q sobol
+
+Modo progressivo: com -e o cálculo termina assim que o intervalo de confiança (padrão 99%)
+for menor que erro_alvo, ex. ./montecarlo_pi -e 1e-5 -i 1 (sem -n não há limite de pontos)
+
+Série de Chudnovsky: com -d calcula as casas decimais exatas de PI em vez do sorteio,
+ex. ./montecarlo_pi -d 1000000 > pi.txt
+
+Com -m os inteiros que não couberem no limite de RAM vão para arquivos temporários mapeados na
+memória, criados em -w (padrão /tmp), ex. ./montecarlo_pi -d 1000000000 -m 48000 -w /mnt/nvme
+
+Checkpoints: com -C o estado é gravado no arquivo a cada periodo_seg (padrão 60) e -R retoma a
+execução interrompida a partir dele, com o mesmo resultado da execução ininterrupta (a semente,
+os pontos e o erro alvo vêm do checkpoint), ex. ./montecarlo_pi -n 1000000000000 -C pi.ckpt
+e depois ./montecarlo_pi -C pi.ckpt -R. Na série de Chudnovsky (-d) o arquivo é o prefixo dos
+checkpoints das subárvores (ver chudnovsky.h) */
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include "montecarlo.h"
+#include "chudnovsky.h"
+#include "memoria.h"
+#include "checkpoint.h"
+#include "metricas.h"
+#include "topologia.h"
 
-#define N_PONTOS 1000LL // Número de pontos aleatórios que serão utilizados para o cálculo
+#define N_PONTOS 1000LL // Número de pontos aleatórios que serão utilizados para o cálculo (padrão)
+#define BLOCOS_RODADA 64 // Blocos por thread entre duas verificações da convergência
 
-double gera_coord();
-void montecarlo_pi()
+/* Configuração do modo progressivo */
+typedef struct{
+	double erro_alvo; // Encerra quando PI ± erro_alvo (0 = sorteia todos os pontos)
+	double confianca; // Nível de confiança do intervalo
+	double intervalo; // Segundos entre duas estimativas parciais (0 = não exibe)
+} progresso_t;
 
-/* Gera coordenadas para o Método de Monte Carlo */
-double gera_coord(){ // Utiliza somente a parte decimal, visto que 0<x,y<1
-	double aux = 100.0*((double)(rand())/RAND_MAX);
-	aux = aux-(int)(aux);
+void montecarlo_pi(mc_pool_t *pool, unsigned long long n_pontos, unsigned long long semente, const progresso_t *prog,
+                   const ckpt_config_t *ckpt, const ckpt_mc_t *retomado);
+int chudnovsky(unsigned long long digitos, int n_threads, size_t memoria_mib, const char *diretorio, const ckpt_config_t *ckpt);
 
-	return aux; // Retorna coordenada com valor entre 0 e 1
+/* Grava o checkpoint dos blocos [0, bloco) (uma falha não interrompe o cálculo) */
+static void grava_checkpoint(const ckpt_config_t *ckpt, ckpt_mc_t *estado, uint64_t bloco, mc_resultado_t r){
+	estado->bloco = bloco;
+	estado->contagem = r;
+	if(ckpt_gravar_mc(ckpt->arquivo, estado) != 0)
+		fprintf(stderr, "AVISO: não foi possível gravar o checkpoint %s\n", ckpt->arquivo);
 }
 
-/* Realiza o cálculo do valor PI com o Método de Monte Carlo */
-void montecarlo_pi(){
-	int i = 0;
-	double x = 0,y = 0; // Coordenadas
-	long long int pdentro = 0,pfora = 0; // Pontos dentro e fora do círculo
-	double valor_pi = 0;
+/* Realiza o cálculo do valor PI com o Método de Monte Carlo, a partir do checkpoint retomado (NULL = do início) */
+void montecarlo_pi(mc_pool_t *pool, unsigned long long n_pontos, unsigned long long semente, const progresso_t *prog,
+                   const ckpt_config_t *ckpt, const ckpt_mc_t *retomado){
+	mc_resultado_t r = {0, 0}, parcial;
+	mc_resultado_t por_replica[MC_MAX_REPLICAS] = {{0, 0}}; // Contagem de cada réplica da amostragem
+	mc_estimativa_t est;
+	int replicas = mc_replicas();
+	uint64_t n_blocos = mc_num_blocos(n_pontos), b_ini = 0;
+	uint64_t por_rodada = n_blocos; // Sem modo progressivo nem checkpoints todos os blocos são sorteados de uma vez
+	double inicio = mc_relogio(), ultimo = inicio, ultimo_ckpt = inicio;
+	int convergiu = 0;
 
-	for(i=0; i<N_PONTOS; i++){
-		x = gera_coord(); // Gera coordenada x do ponto
-		y = gera_coord(); // Gera coordenada y do ponto
+	if(prog->erro_alvo > 0 || prog->intervalo > 0 || ckpt->arquivo)
+		por_rodada = (uint64_t)mc_pool_threads(pool)*BLOCOS_RODADA;
+	por_rodada = (por_rodada + replicas - 1)/replicas*replicas; // Rodadas com todas as réplicas igualmente avançadas
+	if(retomado){ // Mesmas rodadas da execução original, mesmo com outra quantidade de threads
+		por_rodada = retomado->por_rodada;
+		b_ini = retomado->bloco;
+		r = por_replica[0] = retomado->contagem; // Checkpoints somente com uma réplica
+		convergiu = (b_ini > 0 && mc_convergiu(r, prog->erro_alvo, prog->confianca));
+	}
+	ckpt_mc_t estado = {semente, n_pontos, prog->erro_alvo, prog->confianca, por_rodada, b_ini, r};
+
+	/* As rodadas percorrem os blocos em ordem, então a parada depende apenas da semente */
+	for(uint64_t b=b_ini; b<n_blocos && !convergiu; b+=por_rodada){
+		uint64_t fim = (n_blocos - b < por_rodada) ? n_blocos : b + por_rodada;
+
+		// Cada thread sorteia blocos de pontos com o seu próprio acumulador, somados ao final da rodada
+		parcial = mc_pool_executar(pool, semente, n_pontos, b, fim);
+		r.dentro += parcial.dentro;
+		r.total += parcial.total;
+		mc_pool_replicas(pool, por_replica);
 
-		//printf("P(%d) x=%.15f  y=%.15f \n", i,x,y); // Print auxiliar para verificar geração das coordenadas
+		est = mc_estimar_replicas(por_replica, replicas, prog->confianca);
+		convergiu = (prog->erro_alvo > 0 && est.semi_intervalo <= prog->erro_alvo);
 
-		if((x*x + y*y) <= 1) // Soma os quadrados das coordenadas
-			pdentro++; // Se a soma dos quadrados <= 1, ponto caiu dentro
-		else
-			pfora++; // Se a soma dos quadrados > 1, ponto caiu fora
+		double agora = mc_relogio();
+		if(prog->intervalo > 0 && agora - ultimo >= prog->intervalo){ // Estimativa parcial
+			printf("[%.1fs] %llu pontos: PI = %.10f ± %.3e\n", agora - inicio, (unsigned long long)r.total, est.pi, est.semi_intervalo);
+			fflush(stdout);
+			ultimo = agora;
+		}
+
+		if(ckpt->arquivo && (agora - ultimo_ckpt >= ckpt->periodo || fim == n_blocos || convergiu)){
+			grava_checkpoint(ckpt, &estado, fim, r);
+			ultimo_ckpt = agora;
+		}
 	}
 
-// Cálculo do PI
-valor_pi = 4.0*(((double)pdentro)/((double)N_PONTOS)); //calcula valor aproximado de PI
+est = mc_estimar_replicas(por_replica, replicas, prog->confianca);
 
 // Saída dos resultados
-printf("Pontos dentro: %llu", pdentro);
-printf("\nPontos fora: %llu\n", pfora);
-printf("\n[#]Valor de PI calculado = %.8lf\n", valor_pi);
+printf("Pontos dentro: %llu", (unsigned long long)r.dentro);
+printf("\nPontos fora: %llu\n", (unsigned long long)(r.total - r.dentro));
+if(prog->erro_alvo > 0)
+	printf(convergiu ? "Erro alvo atingido após %llu pontos\n" : "Erro alvo NÃO atingido com %llu pontos\n", (unsigned long long)r.total);
+printf("\n[#]Valor de PI calculado = %.8lf\n", est.pi);
+printf("[#]Erro padrão = %.3e, intervalo de %.0f%% = ± %.3e\n", est.erro_padrao, 100*prog->confianca, est.semi_intervalo);
+
+}
+
+/* Calcula as casas decimais de PI pela série de Chudnovsky */
+int chudnovsky(unsigned long long digitos, int n_threads, size_t memoria_mib, const char *diretorio, const ckpt_config_t *ckpt){
+	if(n_threads <= 0)
+		n_threads = mc_num_cpus();
+	memoria_configurar(memoria_mib << 20, diretorio);
+
+	fprintf(stderr, "##SÉRIE DE CHUDNOVSKY - CÁLCULO DE PI##\n\nDígitos: %llu\nThreads: %d\n", digitos, n_threads);
+	if(memoria_mib > 0)
+		fprintf(stderr, "Memória: %zu MiB (excedente em %s)\n", memoria_mib, diretorio ? diretorio : "/tmp");
+	fputc('\n', stderr);
+
+	double tempo_inicio = mc_relogio();
+	char *pi = chudnovsky_pi(digitos, n_threads, ckpt->arquivo, ckpt->retomar);
+	if(!pi){
+		puts("ERROR: memória insuficiente");
+		return EXIT_FAILURE;
+	}
+	double tempo = mc_relogio() - tempo_inicio;
 
+	puts(pi); // Somente os dígitos vão para a saída padrão, que pode ser redirecionada para um arquivo
+	fprintf(stderr, "\n[#]TEMPO DE EXECUÇÃO: %lf seg\n", tempo);
+	if(memoria_pico_disco() > 0)
+		fprintf(stderr, "[#]Pico em disco: %.1f MiB\n", memoria_pico_disco()/1048576.0);
+	free(pi);
+
+	return 0;
 }
 
-int main(){
+int main(int argc, char *argv[]){
+    unsigned long long n_pontos = 0; // Quantidade de pontos que serão sorteados (0 = padrão)
+    unsigned long long semente = (unsigned long long)time(NULL); // Semente do gerador
+    int n_threads = 0; // Quantidade de threads (0 = todos os processadores)
+    const char *kernel = "auto"; // Kernel do teste do círculo (auto = melhor suportado pela CPU)
+    const char *precisao = "double"; // Teste do círculo: double, float ou inteiro
+    const char *amostragem = "pseudo"; // pseudo, sobol ou halton
+    const char *estimador = "acerto"; // acerto, antitetico, estratificado ou controle
+    const char *afinidade = "nenhuma"; // Política de posicionamento das threads (topologia.h)
+    int replicas = 0; // Réplicas independentes da amostragem (0 = padrão)
+    progresso_t prog = {0, MC_CONFIANCA, 0};
+    unsigned long long digitos = 0; // Casas decimais pela série de Chudnovsky (0 = Método de Monte Carlo)
+    size_t memoria_mib = 0; // Limite de RAM dos inteiros grandes (0 = sem limite)
+    const char *diretorio = NULL; // Diretório dos arquivos temporários (NULL = /tmp)
+    ckpt_config_t ckpt = {NULL, CKPT_PERIODO, 0};
+    ckpt_mc_t retomado;
+    int parametros = 0; // -n, -s, -e ou -g informados (a execução retomada usa os do checkpoint)
+    int opt;
+
+    while((opt = getopt(argc, argv, "n:t:s:k:e:g:i:d:m:w:C:P:Rq:r:p:E:a:")) != -1){
+        switch(opt){
+            case 'n': n_pontos = strtoull(optarg, NULL, 10); if(n_pontos == 0) n_pontos = ~0ULL; parametros = 1; break;
+            case 't': n_threads = atoi(optarg); break;
+            case 's': semente = strtoull(optarg, NULL, 10); parametros = 1; break;
+            case 'k': kernel = optarg; break;
+            case 'e': prog.erro_alvo = atof(optarg); parametros = 1; break;
+            case 'g': prog.confianca = atof(optarg); parametros = 1; break;
+            case 'i': prog.intervalo = atof(optarg); break;
+            case 'd': digitos = strtoull(optarg, NULL, 10); break;
+            case 'm': memoria_mib = (size_t)strtoull(optarg, NULL, 10); break;
+            case 'w': diretorio = optarg; break;
+            case 'C': ckpt.arquivo = optarg; break;
+            case 'P': ckpt.periodo = atof(optarg); break;
+            case 'R': ckpt.retomar = 1; break;
+            case 'q': amostragem = optarg; break;
+            case 'r': replicas = atoi(optarg); break;
+            case 'p': precisao = optarg; break;
+            case 'E': estimador = optarg; break;
+            case 'a': afinidade = optarg; break;
+            default:
+                printf("Use: %s [-n pontos] [-t threads] [-s semente] [-k kernel] [-e erro_alvo] [-g confianca] [-i intervalo] [-d digitos] [-m memoria_MiB] [-w diretorio] [-C checkpoint] [-P periodo] [-R] [-q amostragem] [-r replicas] [-p precisao] [-E estimador] [-a afinidade]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if(ckpt.retomar && !ckpt.arquivo){
+        puts("Informe o checkpoint que será retomado com -C");
+        return EXIT_FAILURE;
+    }
+
+    if(digitos > 0)
+        return chudnovsky(digitos, n_threads, memoria_mib, diretorio, &ckpt);
+
+    if(ckpt.retomar){ // A execução retomada continua com os parâmetros da original
+        if(parametros){
+            puts("A execução retomada usa os pontos, a semente, o erro alvo e a confiança do checkpoint: não informe -n, -s, -e ou -g com -R");
+            return EXIT_FAILURE;
+        }
+        if(ckpt_ler_mc(ckpt.arquivo, &retomado) != 0){
+            printf("Checkpoint inexistente ou inválido: %s\n", ckpt.arquivo);
+            return EXIT_FAILURE;
+        }
+        n_pontos = retomado.n_pontos;
+        semente = retomado.semente;
+        prog.erro_alvo = retomado.erro_alvo;
+        prog.confianca = retomado.confianca;
+    }
+
+    if(n_pontos == 0) // Sem -n: padrão, ou ilimitado quando o cálculo termina pela convergência
+        n_pontos = (prog.erro_alvo > 0) ? MC_PONTOS_ILIMITADO : N_PONTOS;
+
+    if(n_pontos > MC_PONTOS_ILIMITADO){ // -n 0 ou valor inválido
+        puts("Insira uma quantidade positiva de pontos!");
+        return EXIT_FAILURE;
+    }
+
+    if(prog.confianca <= 0 || prog.confianca >= 1){
+        puts("O nível de confiança deve estar entre 0 e 1 (ex. 0.99)");
+        return EXIT_FAILURE;
+    }
+
+    if(mc_selecionar_precisao(precisao) != 0){
+        printf("Precisão inválida: %s (double, float ou inteiro)\n", precisao);
+        return EXIT_FAILURE;
+    }
+
+    if(mc_selecionar_kernel(kernel) != 0){
+        printf("Kernel indisponível nesta CPU: %s\n", kernel);
+        return EXIT_FAILURE;
+    }
+
+    if(mc_selecionar_estimador(mc_estimador_id(estimador)) != 0){
+        printf("Estimador inválido: %s (acerto, antitetico, estratificado ou controle)\n", estimador);
+        return EXIT_FAILURE;
+    }
+
+    if(mc_selecionar_amostragem(amostragem, replicas) != 0){
+        printf("Amostragem inválida: %s com %d réplicas (pseudo, sobol ou halton, até %d réplicas)\n", amostragem, replicas, MC_MAX_REPLICAS);
+        return EXIT_FAILURE;
+    }
+
+    if(ckpt.arquivo && (mc_replicas() > 1 || strcmp(amostragem, "pseudo") != 0 || strcmp(precisao, "double") != 0 || mc_estimador() != MC_ACERTO)){ // O checkpoint guarda somente a contagem total
+        puts("Os checkpoints (-C) exigem o acerto simples pseudoaleatório em double com uma réplica");
+        return EXIT_FAILURE;
+    }
+
+    if((strcmp(amostragem, "pseudo") != 0 || mc_estimador() != MC_ACERTO) && strcmp(precisao, "double") != 0){ // Somente o acerto simples usa os kernels
+        puts("As amostragens sobol e halton e os estimadores são calculados somente em double");
+        return EXIT_FAILURE;
+    }
+
+    if(strcmp(amostragem, "pseudo") != 0 && mc_estimador() != MC_ACERTO){
+        puts("Os estimadores usam somente o sorteio pseudoaleatório");
+        return EXIT_FAILURE;
+    }
+
+    if(topo_politica_id(afinidade) < 0){
+        printf("Afinidade inválida: %s (nenhuma, compacta, espalhada ou fisica)\n", afinidade);
+        return EXIT_FAILURE;
+    }
+    if(topo_configurar((topo_politica_t)topo_politica_id(afinidade), 0) != 0)
+        puts("AVISO: topologia indisponível, as threads não serão fixadas");
+
     printf("##MÉTODO DE MONTE CARLO - CÁLCULO DE PI##\n\n");
 
-    srand(time(NULL)); // Inicializa gerador de numeros com a semente
-    clock_t start_time; // Variável para cálculo do tempo de execução
-    start_time = clock(); // Inicia contagem de tempo
+    mc_pool_t *pool = mc_pool_criar(n_threads); // Cria as threads que realizarão o sorteio
+    if(!pool){
+        puts("ERROR: pool de threads");
+        return EXIT_FAILURE;
+    }
+
+    if(n_pontos == MC_PONTOS_ILIMITADO)
+        printf("Pontos: até atingir o erro alvo\n");
+    else
+        printf("Pontos: %llu\n", n_pontos);
+    printf("Threads: %d\n", mc_pool_threads(pool));
+    if(strcmp(mc_amostragem_nome(), "pseudo") != 0) // As sequências e os estimadores não usam os kernels SIMD (montecarlo_bloco)
+        printf("Kernel: sequência %s (escalar, double)\n", mc_amostragem_nome());
+    else if(mc_estimador() != MC_ACERTO)
+        printf("Kernel: estimador %s (escalar, double)\n", mc_estimador_nome());
+    else
+        printf("Kernel: %s (%s)\n", mc_kernel_nome(), mc_precisao_nome());
+    printf("Amostragem: %s (%d %s)\nEstimador: %s\n", mc_amostragem_nome(), mc_replicas(), mc_replicas() > 1 ? "réplicas" : "réplica", mc_estimador_nome());
+    topo_descrever(stdout);
+    if(prog.erro_alvo > 0)
+        printf("Erro alvo: %.3e (confiança de %.0f%%)\n", prog.erro_alvo, 100*prog.confianca);
+    printf("Semente: %llu\n", semente); // Permite reproduzir a execução informando a mesma semente
+    if(ckpt.retomar)
+        printf("Retomado do checkpoint %s: %llu pontos já sorteados\n", ckpt.arquivo, (unsigned long long)retomado.contagem.total);
+    putchar('\n');
 
-    montecarlo_pi(); // Chamada da função para o cálculo de PI
+    double tempo_inicio = mc_relogio(); // Tempo de parede (clock() soma o tempo de CPU de todas as threads)
 
-    double tempo = (clock() - start_time) / (double)CLOCKS_PER_SEC; // Finaliza contagem do tempo
+    METRICAS_INICIO("montecarlo_pi"); // Marcador para perfiladores (ver metricas.h)
+    montecarlo_pi(pool, n_pontos, semente, &prog, &ckpt, ckpt.retomar ? &retomado : NULL); // Chamada da função para o cálculo de PI
+    METRICAS_FIM();
+
+    double tempo = mc_relogio() - tempo_inicio; // Finaliza contagem do tempo
     printf("[#]TEMPO DE EXECUÇÃO: %lf seg\n\n", tempo);
     puts("[#]Cálculo realizado com sucesso!\n");
 
+    mc_pool_destruir(pool);
+
     return 0;
 }
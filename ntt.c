@@ -0,0 +1,375 @@
+/* Multiplicação pela NTT com três primos (ver ntt.h) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "bigint.h"
+#include "ntt.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#endif
+
+#define NTT_NUM_PRIMOS 3
+
+/* Primo p = c*2^k + 1 com raiz primitiva g (a redução de Montgomery usa R = 2^32) */
+typedef struct{
+	uint32_t p;
+	uint32_t g;
+} ntt_primo_t;
+
+static const ntt_primo_t ntt_primos[NTT_NUM_PRIMOS] = {
+	{167772161, 3}, // 5*2^25 + 1
+	{469762049, 3}, // 7*2^26 + 1
+	{754974721, 11}, // 45*2^24 + 1
+};
+
+/* Aritmética modular escalar */
+
+static uint32_t ntt_pot(uint32_t b, uint64_t e, uint32_t p){
+	uint64_t r = 1, x = b;
+	while(e > 0){
+		if(e & 1)
+			r = r*x % p;
+		x = x*x % p;
+		e >>= 1;
+	}
+	return (uint32_t)r;
+}
+
+static uint32_t ntt_inverso_mont(uint32_t p){ // -p^-1 mod 2^32 pela iteração de Newton
+	uint32_t x = p; // Correto em 3 bits (p ímpar)
+	for(int i=0; i<4; i++)
+		x *= 2 - p*x;
+	return (uint32_t)0 - x;
+}
+
+static inline uint32_t ntt_para_mont(uint32_t x, uint32_t p){ // x*R mod p
+	return (uint32_t)(((uint64_t)x << 32) % p);
+}
+
+/* a*b*R^-1 mod p para a*b < p*2^32 */
+static inline uint32_t ntt_mont(uint32_t a, uint32_t b, uint32_t p, uint32_t pinv){
+	uint64_t t = (uint64_t)a*b;
+	uint32_t m = (uint32_t)t*pinv;
+	uint32_t r = (uint32_t)((t + (uint64_t)m*p) >> 32); // < 2p
+	return (r >= p) ? r - p : r;
+}
+
+static inline uint32_t ntt_somar(uint32_t a, uint32_t b, uint32_t p){
+	uint32_t s = a + b;
+	return (s >= p) ? s - p : s;
+}
+
+static inline uint32_t ntt_subtrair(uint32_t a, uint32_t b, uint32_t p){
+	return (a >= b) ? a - b : a + p - b;
+}
+
+/* Borboletas de um nível da transformada (blocos de 2len pontos): DIF (direta, saída em ordem de bits
+invertida) e DIT (inversa, entrada em ordem de bits invertida), com os fatores w[0..len) em forma de Montgomery */
+typedef void (*ntt_nivel_t)(uint32_t *a, size_t n, const uint32_t *w, size_t len, uint32_t p, uint32_t pinv);
+
+static void ntt_dif_escalar(uint32_t *a, size_t n, const uint32_t *w, size_t len, uint32_t p, uint32_t pinv){
+	for(size_t i=0; i<n; i+=2*len){
+		uint32_t *u = a + i, *v = a + i + len;
+		for(size_t j=0; j<len; j++){
+			uint32_t x = u[j], y = v[j];
+			u[j] = ntt_somar(x, y, p);
+			v[j] = ntt_mont(ntt_subtrair(x, y, p), w[j], p, pinv);
+		}
+	}
+}
+
+static void ntt_dit_escalar(uint32_t *a, size_t n, const uint32_t *w, size_t len, uint32_t p, uint32_t pinv){
+	for(size_t i=0; i<n; i+=2*len){
+		uint32_t *u = a + i, *v = a + i + len;
+		for(size_t j=0; j<len; j++){
+			uint32_t x = u[j], y = ntt_mont(v[j], w[j], p, pinv);
+			u[j] = ntt_somar(x, y, p);
+			v[j] = ntt_subtrair(x, y, p);
+		}
+	}
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+/* Montgomery em 8 palavras: produtos de 64 bits das posições pares e ímpares separadamente */
+__attribute__((target("avx2")))
+static inline __m256i ntt_avx2_mont(__m256i a, __m256i b, __m256i p, __m256i pinv){
+	__m256i pares = _mm256_mul_epu32(a, b);
+	__m256i impares = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+	pares = _mm256_add_epi64(pares, _mm256_mul_epu32(_mm256_mul_epu32(pares, pinv), p));
+	impares = _mm256_add_epi64(impares, _mm256_mul_epu32(_mm256_mul_epu32(impares, pinv), p));
+	__m256i r = _mm256_blend_epi32(_mm256_srli_epi64(pares, 32), impares, 0xAA); // Metades superiores, < 2p
+	return _mm256_min_epu32(r, _mm256_sub_epi32(r, p)); // r - p transborda quando r < p
+}
+
+__attribute__((target("avx2")))
+static inline __m256i ntt_avx2_somar(__m256i a, __m256i b, __m256i p){
+	__m256i s = _mm256_add_epi32(a, b);
+	return _mm256_min_epu32(s, _mm256_sub_epi32(s, p));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i ntt_avx2_subtrair(__m256i a, __m256i b, __m256i p){
+	__m256i d = _mm256_add_epi32(_mm256_sub_epi32(a, b), p);
+	return _mm256_min_epu32(d, _mm256_sub_epi32(d, p));
+}
+
+/* Níveis com len < 8 não preenchem um vetor e usam o kernel escalar */
+__attribute__((target("avx2")))
+static void ntt_dif_avx2(uint32_t *a, size_t n, const uint32_t *w, size_t len, uint32_t p, uint32_t pinv){
+	if(len < 8){
+		ntt_dif_escalar(a, n, w, len, p, pinv);
+		return;
+	}
+	__m256i vp = _mm256_set1_epi32((int)p), vpinv = _mm256_set1_epi32((int)pinv);
+	for(size_t i=0; i<n; i+=2*len){
+		uint32_t *u = a + i, *v = a + i + len;
+		for(size_t j=0; j<len; j+=8){
+			__m256i x = _mm256_loadu_si256((const __m256i *)(u + j));
+			__m256i y = _mm256_loadu_si256((const __m256i *)(v + j));
+			__m256i fw = _mm256_loadu_si256((const __m256i *)(w + j));
+			_mm256_storeu_si256((__m256i *)(u + j), ntt_avx2_somar(x, y, vp));
+			_mm256_storeu_si256((__m256i *)(v + j), ntt_avx2_mont(ntt_avx2_subtrair(x, y, vp), fw, vp, vpinv));
+		}
+	}
+}
+
+__attribute__((target("avx2")))
+static void ntt_dit_avx2(uint32_t *a, size_t n, const uint32_t *w, size_t len, uint32_t p, uint32_t pinv){
+	if(len < 8){
+		ntt_dit_escalar(a, n, w, len, p, pinv);
+		return;
+	}
+	__m256i vp = _mm256_set1_epi32((int)p), vpinv = _mm256_set1_epi32((int)pinv);
+	for(size_t i=0; i<n; i+=2*len){
+		uint32_t *u = a + i, *v = a + i + len;
+		for(size_t j=0; j<len; j+=8){
+			__m256i x = _mm256_loadu_si256((const __m256i *)(u + j));
+			__m256i y = _mm256_loadu_si256((const __m256i *)(v + j));
+			__m256i fw = _mm256_loadu_si256((const __m256i *)(w + j));
+			y = ntt_avx2_mont(y, fw, vp, vpinv);
+			_mm256_storeu_si256((__m256i *)(u + j), ntt_avx2_somar(x, y, vp));
+			_mm256_storeu_si256((__m256i *)(v + j), ntt_avx2_subtrair(x, y, vp));
+		}
+	}
+}
+
+static int ntt_cpu_avx2(void){
+	return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+/* Kernels disponíveis, do mais rápido para o mais lento (todos produzem o mesmo resultado exato) */
+static const struct{
+	const char *nome;
+	ntt_nivel_t dif, dit;
+	int (*suportado)(void); // Verifica o suporte da CPU (NULL = sempre disponível)
+} ntt_kernels[] = {
+#if defined(__x86_64__) && defined(__GNUC__)
+	{"avx2", ntt_dif_avx2, ntt_dit_avx2, ntt_cpu_avx2},
+#endif
+	{"escalar", ntt_dif_escalar, ntt_dit_escalar, NULL},
+};
+
+static int ntt_kernel_atual = 0;
+static pthread_once_t ntt_kernel_once = PTHREAD_ONCE_INIT;
+
+static void ntt_kernel_inicializar(void){
+	while(ntt_kernels[ntt_kernel_atual].suportado && !ntt_kernels[ntt_kernel_atual].suportado())
+		ntt_kernel_atual++;
+}
+
+const char *ntt_kernel_nome(void){
+	pthread_once(&ntt_kernel_once, ntt_kernel_inicializar);
+	return ntt_kernels[ntt_kernel_atual].nome;
+}
+
+/* Transformadas */
+
+/* Fatores de cada nível: w[len + j] = (raiz de ordem 2len)^j, em forma de Montgomery. A raiz de
+ordem 2len é sempre g^((p-1)/2len), então a tabela de n pontos serve para qualquer transformada menor */
+static uint32_t *ntt_fatores(size_t n, uint32_t p, uint32_t raiz_n){
+	uint32_t *w = (uint32_t *)malloc(n*sizeof(uint32_t));
+	if(!w)
+		return NULL;
+
+	uint32_t raiz = raiz_n;
+	for(size_t len=n/2; len>=1; len/=2){
+		uint64_t x = 1;
+		for(size_t j=0; j<len; j++){
+			w[len + j] = ntt_para_mont((uint32_t)x, p);
+			x = x*raiz % p;
+		}
+		raiz = (uint32_t)((uint64_t)raiz*raiz % p);
+	}
+	return w;
+}
+
+/* Tabelas de fatores compartilhadas entre as multiplicações. Quando uma transformada maior é pedida as
+tabelas são recalculadas, e as antigas não são liberadas porque outras threads podem estar usando-as
+(a soma dos tamanhos é menor que o dobro da maior tabela) */
+static pthread_mutex_t ntt_fatores_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t *ntt_w[NTT_NUM_PRIMOS], *ntt_winv[NTT_NUM_PRIMOS];
+static size_t ntt_fatores_n = 0;
+
+static int ntt_preparar_fatores(size_t n, uint32_t *w[NTT_NUM_PRIMOS], uint32_t *winv[NTT_NUM_PRIMOS]){
+	int ok = 1;
+
+	pthread_mutex_lock(&ntt_fatores_mutex);
+	if(n > ntt_fatores_n){
+		for(int k=0; k<NTT_NUM_PRIMOS && ok; k++){
+			uint32_t p = ntt_primos[k].p;
+			uint32_t raiz = ntt_pot(ntt_primos[k].g, (p - 1)/n, p); // Raiz n-ésima primitiva da unidade
+			ntt_w[k] = ntt_fatores(n, p, raiz);
+			ntt_winv[k] = ntt_fatores(n, p, ntt_pot(raiz, p - 2, p));
+			ok = ntt_w[k] && ntt_winv[k];
+		}
+		ntt_fatores_n = ok ? n : 0;
+	}
+	for(int k=0; k<NTT_NUM_PRIMOS; k++){
+		w[k] = ntt_w[k];
+		winv[k] = ntt_winv[k];
+	}
+	pthread_mutex_unlock(&ntt_fatores_mutex);
+
+	return ok;
+}
+
+static void ntt_direta(uint32_t *a, size_t n, const uint32_t *w, uint32_t p, uint32_t pinv){
+	ntt_nivel_t dif = ntt_kernels[ntt_kernel_atual].dif;
+	for(size_t len=n/2; len>=1; len/=2)
+		dif(a, n, w + len, len, p, pinv);
+}
+
+static void ntt_inversa(uint32_t *a, size_t n, const uint32_t *w, uint32_t p, uint32_t pinv){
+	ntt_nivel_t dit = ntt_kernels[ntt_kernel_atual].dit;
+	for(size_t len=1; len<n; len*=2)
+		dit(a, n, w + len, len, p, pinv);
+}
+
+/* Trabalho de uma multiplicação, dividido em tarefas independentes entre as threads */
+typedef struct{
+	const uint32_t *a, *b;
+	size_t an, bn, n;
+	uint32_t *ta[NTT_NUM_PRIMOS], *tb[NTT_NUM_PRIMOS]; // Transformadas de cada operando para cada primo
+	uint32_t *w[NTT_NUM_PRIMOS], *winv[NTT_NUM_PRIMOS];
+	int etapa; // 0 = transformadas diretas (2 por primo), 1 = produto e transformada inversa (1 por primo)
+	atomic_int proxima;
+} ntt_trabalho_t;
+
+/* Copia o operando para a forma de Montgomery e aplica a transformada direta */
+static void ntt_tarefa_direta(ntt_trabalho_t *t, int k, int operando){
+	const ntt_primo_t *P = &ntt_primos[k];
+	uint32_t pinv = ntt_inverso_mont(P->p), r2 = ntt_para_mont(ntt_para_mont(1, P->p), P->p); // R^2 mod p
+	const uint32_t *x = operando ? t->b : t->a;
+	size_t xn = operando ? t->bn : t->an;
+	uint32_t *dst = operando ? t->tb[k] : t->ta[k];
+
+	for(size_t i=0; i<xn; i++)
+		dst[i] = ntt_mont(x[i], r2, P->p, pinv); // x < 10^9 < 2^30, então x*r2 < p*2^32
+	memset(dst + xn, 0, (t->n - xn)*sizeof(uint32_t));
+	ntt_direta(dst, t->n, t->w[k], P->p, pinv);
+}
+
+/* Produto ponto a ponto e transformada inversa; o resultado sai da forma de Montgomery já dividido por n */
+static void ntt_tarefa_inversa(ntt_trabalho_t *t, int k){
+	const ntt_primo_t *P = &ntt_primos[k];
+	uint32_t pinv = ntt_inverso_mont(P->p);
+	uint32_t n_inv = ntt_pot((uint32_t)(t->n % P->p), P->p - 2, P->p);
+	uint32_t *x = t->ta[k], *y = t->tb[k];
+
+	for(size_t i=0; i<t->n; i++)
+		x[i] = ntt_mont(x[i], y[i], P->p, pinv);
+	ntt_inversa(x, t->n, t->winv[k], P->p, pinv);
+	for(size_t i=0; i<t->n; i++)
+		x[i] = ntt_mont(x[i], n_inv, P->p, pinv);
+}
+
+static void *ntt_trabalhador(void *arg){
+	ntt_trabalho_t *t = (ntt_trabalho_t *)arg;
+	int total = (t->etapa == 0) ? 2*NTT_NUM_PRIMOS : NTT_NUM_PRIMOS;
+	int i;
+
+	while((i = atomic_fetch_add(&t->proxima, 1)) < total){
+		if(t->etapa == 0)
+			ntt_tarefa_direta(t, i/2, i%2);
+		else
+			ntt_tarefa_inversa(t, i);
+	}
+	return NULL;
+}
+
+/* Executa as tarefas da etapa em até n_threads threads (a thread atual participa) */
+static void ntt_executar(ntt_trabalho_t *t, int etapa, int n_threads){
+	pthread_t threads[2*NTT_NUM_PRIMOS];
+	int total = (etapa == 0) ? 2*NTT_NUM_PRIMOS : NTT_NUM_PRIMOS, criadas = 0;
+
+	t->etapa = etapa;
+	atomic_store(&t->proxima, 0);
+	for(int i=1; i<n_threads && i<total; i++, criadas++)
+		if(pthread_create(&threads[criadas], NULL, ntt_trabalhador, t) != 0)
+			break;
+	ntt_trabalhador(t);
+	for(int i=0; i<criadas; i++)
+		pthread_join(threads[i], NULL);
+}
+
+/* Reconstrói cada coeficiente pelos restos módulo os três primos (Garner) e propaga o vai-um na base 10^9 */
+static void ntt_reconstruir(uint32_t *r, size_t rn, uint32_t *const res[NTT_NUM_PRIMOS], size_t n_coef){
+	const uint64_t p1 = ntt_primos[0].p, p2 = ntt_primos[1].p, p3 = ntt_primos[2].p;
+	const uint64_t inv12 = ntt_pot((uint32_t)(p1 % p2), p2 - 2, (uint32_t)p2); // p1^-1 mod p2
+	const uint64_t inv123 = ntt_pot((uint32_t)(p1*p2 % p3), p3 - 2, (uint32_t)p3); // (p1*p2)^-1 mod p3
+	unsigned __int128 carry = 0;
+
+	for(size_t i=0; i<rn; i++){
+		unsigned __int128 x = carry;
+		if(i < n_coef){
+			uint64_t v1 = res[0][i];
+			uint64_t v2 = (res[1][i] + p2 - v1 % p2) % p2*inv12 % p2;
+			uint64_t v3 = (res[2][i] + p3 - (v1 + v2*p1) % p3) % p3*inv123 % p3;
+			x += v1 + (unsigned __int128)v2*p1 + (unsigned __int128)v3*p1*p2;
+		}
+		r[i] = (uint32_t)(x % BIGINT_BASE);
+		carry = x / BIGINT_BASE;
+	}
+}
+
+/* r[0..an+bn) = a*b para an + bn <= NTT_TAM_MAXIMO */
+void ntt_multiplicar(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn, int n_threads){
+	ntt_trabalho_t t;
+	size_t n = 1;
+	int ok = 1;
+
+	pthread_once(&ntt_kernel_once, ntt_kernel_inicializar);
+	while(n < an + bn - 1)
+		n *= 2;
+
+	memset(&t, 0, sizeof(t));
+	t.a = a; t.an = an;
+	t.b = b; t.bn = bn;
+	t.n = n;
+	ok = ntt_preparar_fatores(n, t.w, t.winv);
+	for(int k=0; k<NTT_NUM_PRIMOS; k++){
+		t.ta[k] = (uint32_t *)malloc(n*sizeof(uint32_t));
+		t.tb[k] = (uint32_t *)malloc(n*sizeof(uint32_t));
+		ok = ok && t.ta[k] && t.tb[k];
+	}
+	if(!ok){
+		perror("ERROR: ntt");
+		exit(EXIT_FAILURE);
+	}
+
+	ntt_executar(&t, 0, n_threads);
+	ntt_executar(&t, 1, n_threads);
+	ntt_reconstruir(r, an + bn, t.ta, an + bn - 1);
+
+	for(int k=0; k<NTT_NUM_PRIMOS; k++){
+		free(t.ta[k]);
+		free(t.tb[k]);
+	}
+}
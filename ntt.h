@@ -0,0 +1,21 @@
+/* Multiplicação de inteiros grandes pela transformada teórica dos números (NTT)
+
+Os vetores de palavras de base 10^9 (bigint.h) são convoluídos módulo três primos da forma
+c*2^k + 1 e os coeficientes exatos são reconstruídos pelo teorema chinês do resto (Garner).
+Cada coeficiente da convolução é menor que n*10^18, abaixo do produto dos três primos para
+transformadas de até NTT_TAM_MAXIMO pontos. A aritmética modular usa a redução de Montgomery
+de 32 bits, com borboletas AVX2 escolhidas em tempo de execução conforme a CPU; as
+transformadas dos três primos e dos dois operandos são independentes e rodam em threads. */
+
+#ifndef NTT_H
+#define NTT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define NTT_TAM_MAXIMO ((size_t)1 << 24) // Maior transformada suportada pelos três primos
+
+void ntt_multiplicar(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn, int n_threads);
+const char *ntt_kernel_nome(void);
+
+#endif
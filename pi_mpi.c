@@ -1,128 +1,496 @@
 /* COMPILAÇÃO:
-mpicc pi_mpi.c -o pi_mpi
+mpicc -O2 -pthread pi_mpi.c montecarlo.c topologia.c bbp.c checkpoint.c -o pi_mpi -lm
 */
 
 /* EXECUÇÃO:
-mpirun -np [numero_processos] pi_mpi [numero_pontos]
+mpirun -np [numero_processos] pi_mpi [numero_pontos] [-t threads_por_processo] [-s semente] [-e erro_alvo] [-g confianca] [-i intervalo_seg]
+                                     [-q amostragem] [-r replicas] [-p precisao] [-E estimador] [-a afinidade]
 OU
-mpirun --oversubscribe -np [numero_processos] pi_mpi [numero_pontos] */
+mpirun --oversubscribe -np [numero_processos] pi_mpi [numero_pontos] [-t threads_por_processo] [-s semente]
+
+Modo híbrido: um processo por máquina com várias threads, ex. mpirun -np 4 --map-by node pi_mpi 100000000000 -t 64
+Modo progressivo: com -e todos os processos param assim que o intervalo de confiança for menor que
+erro_alvo (numero_pontos = 0 ou omitido: sem limite de pontos)
+
+Reduções: a cada rodada (BLOCOS_RODADA blocos por thread) as contagens são somadas entre os processos
+sem interromper o sorteio da rodada seguinte; -i exibe a estimativa parcial no processo 0 e Ctrl+C
+(SIGINT ou SIGTERM em qualquer processo) encerra todos ao fim da rodada, com o resultado parcial
+
+Checkpoints: com -C arquivo [-P periodo_seg] o processo 0 grava as contagens exatas e os blocos já
+sorteados (padrão: a cada 60 s); mpirun ... pi_mpi -C arquivo -R retoma a execução interrompida com
+o mesmo resultado, inclusive com outra quantidade de processos ou threads
+
+Quasi-Monte Carlo: -q sobol ou -q halton (com -r réplicas, padrão 16) usa as sequências de baixa
+discrepância aleatorizadas (ver montecarlo.h); cada processo sorteia os seus blocos, que são trechos
+disjuntos das sequências, e as contagens de cada réplica são somadas a cada rodada
+
+Precisão: -p float ou -p inteiro usa os kernels de 32 bits do teste do círculo (ver montecarlo.c)
+
+Redução de variância: -E antitetico, estratificado ou controle (ver montecarlo.c), com o erro estimado
+pelas réplicas somadas entre os processos
+
+Afinidade: -a compacta, espalhada ou fisica fixa as threads de cada processo (ver topologia.h); os processos
+da mesma máquina ocupam CPUs consecutivas da ordem da política, ex. mpirun -np 2 pi_mpi 1000000000 -t 8 -a fisica.
+Com o binding do mpirun (--bind-to) cada processo fixa as suas threads somente nas CPUs que recebeu
+
+Extração de dígitos: mpirun -np [numero_processos] pi_mpi -x posicao [-f bbp|bellard] [-t threads_por_processo]
+exibe os dígitos hexadecimais de PI após as primeiras `posicao` casas (fórmulas BBP ou Bellard, ver bbp.h) */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <locale.h>
 #include <mpi.h>
 #include <unistd.h>
 #include <math.h>
 #include <time.h>
+#include <signal.h>
+#include "montecarlo.h"
+#include "bbp.h"
+#include "checkpoint.h"
+#include "topologia.h"
 
-double gera_coord();
-double montecarlo_pi(long long int, int, int);
+#define BLOCOS_RODADA 64 // Blocos por thread entre duas reduções
+#define BLOCOS_PASSO 8 // Blocos por thread entre duas chamadas de MPI_Test (progresso da redução em andamento)
 
-/* Gera coordenadas para o Método de Monte Carlo */
-double gera_coord(){ // Utiliza somente a parte decimal, visto que 0<x,y<1
-    double aux = 100.0*((double)(rand())/RAND_MAX);
-    aux = aux-(int)(aux);
+static volatile sig_atomic_t interrompido = 0; // SIGINT ou SIGTERM recebido: para na próxima rodada
 
-    return aux; // Retorna coordenada com valor entre 0 e 1
+/* Configuração do modo progressivo */
+typedef struct{
+    double erro_alvo; // Encerra quando PI ± erro_alvo (0 = sorteia todos os pontos)
+    double confianca; // Nível de confiança do intervalo
+    double intervalo; // Segundos entre duas estimativas parciais (0 = não exibe)
+} progresso_t;
+
+void divide_blocos(uint64_t, uint64_t, int, int, uint64_t *, uint64_t *);
+mc_resultado_t montecarlo_pi(mc_pool_t *, unsigned long long, unsigned long long, const progresso_t *, const ckpt_config_t *,
+                             const ckpt_mc_t *, mc_resultado_t *, mc_resultado_t *, int, int);
+void extrai_digitos(unsigned long long, bbp_formula_t, int, int, int);
+
+/* Ctrl+C (ou SIGTERM): o pedido de parada segue com a próxima redução para todos os processos */
+static void interrompe(int sig){
+    (void)sig;
+    interrompido = 1;
+}
+
+/* Divide os blocos [ini, fim) entre os processos: os primeiros ((fim-ini) % size) processos recebem um bloco a mais */
+void divide_blocos(uint64_t ini, uint64_t fim, int rank, int size, uint64_t *bloco_ini, uint64_t *bloco_fim){
+    uint64_t por_processo = (fim - ini)/size, resto = (fim - ini)%size;
+    *bloco_ini = ini + rank*por_processo + ((uint64_t)rank < resto ? (uint64_t)rank : resto);
+    *bloco_fim = *bloco_ini + por_processo + ((uint64_t)rank < resto ? 1 : 0);
 }
 
-/* Realiza o cálculo do valor PI com o Método de Monte Carlo */
-double montecarlo_pi(long long int N_PONTOS, int rank, int size){
-    printf("Processo %d de %d, pontos sorteados: %llu", rank+1, size, N_PONTOS);
-
-    double x = 0, y = 0; // Coordenadas
-    long long int i = 0, pdentro = 0, pfora = 0; // Pontos dentro e fora do círculo
-    double valor_pi = 0; // Valor do PI que será retornado
-
-    for(i=0; i<N_PONTOS; i++){
-        x = gera_coord(); // Gera coordenada x do ponto
-        y = gera_coord(); // Gera coordenada y do ponto
-        
-        if((x*x + y*y) <= 1) // Soma os quadrados das coordenadas
-            pdentro++; // Se a soma dos quadrados <= 1, ponto caiu dentro
-        else
-            pfora++; // Se a soma dos quadrados > 1, ponto caiu fora
+/* Sorteia os blocos [bloco_ini, bloco_fim) em passos de BLOCOS_PASSO blocos por thread. Entre os passos a thread
+principal chama MPI_Test, que faz a redução da rodada anterior (pedido) progredir durante o sorteio mesmo sem
+uma thread de progresso assíncrono no MPI. Soma a replicas_local a contagem de cada réplica */
+static mc_resultado_t sorteia_rodada(mc_pool_t *pool, unsigned long long N_PONTOS, unsigned long long semente, uint64_t bloco_ini,
+                                     uint64_t bloco_fim, MPI_Request *pedido, mc_resultado_t *replicas_local){
+    mc_resultado_t parcial = {0, 0}, r;
+    uint64_t passo = (uint64_t)mc_pool_threads(pool)*BLOCOS_PASSO;
+    int feito;
+
+    for(uint64_t p=bloco_ini; p<bloco_fim; p+=passo){
+        r = mc_pool_executar(pool, semente, N_PONTOS, p, (bloco_fim - p < passo) ? bloco_fim : p + passo);
+        parcial.dentro += r.dentro;
+        parcial.total += r.total;
+        mc_pool_replicas(pool, replicas_local);
+        if(*pedido != MPI_REQUEST_NULL) // Concluída, a redução libera o pedido (MPI_REQUEST_NULL)
+            MPI_Test(pedido, &feito, MPI_STATUS_IGNORE);
     }
+    return parcial;
+}
 
-    // Cálculo do PI
-    valor_pi = 4.0*(((double)pdentro)/((double)N_PONTOS));
+/* Empacota a contagem da rodada e de cada réplica, e o pedido de parada, para a redução */
+static void empacota_rodada(mc_resultado_t parcial, const mc_resultado_t *replicas_local, int replicas, uint64_t parar, uint64_t *contagem){
+    contagem[0] = parcial.dentro;
+    contagem[1] = parcial.total;
+    for(int r=0; r<replicas; r++){
+        contagem[2 + 2*r] = replicas_local[r].dentro;
+        contagem[3 + 2*r] = replicas_local[r].total;
+    }
+    contagem[2 + 2*replicas] = parar;
+}
 
-    return valor_pi; // Retorna o valor de PI 
+/* Realiza o cálculo do valor PI com o Método de Monte Carlo a partir do estado inicial (checkpoint retomado
+ou início, igual em todos os processos). Retorna a contagem de todos os processos e preenche em local a
+contagem deste processo e em por_replica a de cada réplica da amostragem, somada entre os processos.
+Somente o processo 0 grava os checkpoints (ckpt->arquivo).
+
+As reduções são assíncronas: a contagem de uma rodada é somada (MPI_Iallreduce) enquanto os processos
+sorteiam a rodada seguinte (sorteia_rodada chama MPI_Test entre os passos do sorteio) e só é aguardada
+depois dela, então um processo mais lento atrasa os outros em no máximo uma rodada. A decisão de parar (convergência ou interrupção) vem da soma, igual em todos os
+processos, e vale a partir da rodada seguinte à já sorteada, que também entra na contagem */
+mc_resultado_t montecarlo_pi(mc_pool_t *pool, unsigned long long N_PONTOS, unsigned long long semente,
+                             const progresso_t *prog, const ckpt_config_t *ckpt, const ckpt_mc_t *estado_inicial,
+                             mc_resultado_t *local, mc_resultado_t *por_replica, int rank, int size){
+    mc_resultado_t total = estado_inicial->contagem, parcial;
+    mc_resultado_t replicas_local[MC_MAX_REPLICAS]; // Contagem de cada réplica nesta rodada
+    uint64_t contagem_local[2][3 + 2*MC_MAX_REPLICAS], contagem_rodada[2][3 + 2*MC_MAX_REPLICAS]; // {dentro, total}, o par de cada réplica e o pedido de parada
+    int replicas = mc_replicas(), n_contagens = 3 + 2*replicas;
+    int atual = 0; // Par de buffers da rodada sorteada (o outro está em redução)
+    MPI_Request pedido = MPI_REQUEST_NULL; // Redução em andamento (MPI_REQUEST_NULL depois de concluída)
+    int reduzindo = 0; // Soma de uma rodada ainda não incorporada ao total
+    uint64_t n_blocos = mc_num_blocos(N_PONTOS), bloco_ini, bloco_fim;
+    uint64_t por_rodada = estado_inicial->por_rodada;
+    uint64_t b = estado_inicial->bloco, fim_reduzindo = b; // Próximo bloco e fim da rodada em redução
+    double inicio = MPI_Wtime(), ultimo = inicio, ultimo_ckpt = inicio;
+    int convergiu = (estado_inicial->bloco > 0 && mc_convergiu(total, prog->erro_alvo, prog->confianca));
+    int parou = 0; // Algum processo foi interrompido
+    ckpt_mc_t estado = *estado_inicial;
+
+    local->dentro = local->total = 0;
+    memset(por_replica, 0, replicas*sizeof(mc_resultado_t));
+    por_replica[0] = total; // Checkpoints somente com uma réplica
+
+    /* Cada rodada é dividida entre os processos; a soma da anterior chega enquanto ela é sorteada */
+    while(1){
+        int sorteia = (b < n_blocos && !convergiu && !parou);
+        uint64_t fim = b;
+        if(sorteia){
+            fim = (n_blocos - b < por_rodada) ? n_blocos : b + por_rodada;
+            divide_blocos(b, fim, rank, size, &bloco_ini, &bloco_fim);
+
+            // Cada thread do processo sorteia blocos com o seu próprio acumulador
+            memset(replicas_local, 0, replicas*sizeof(mc_resultado_t));
+            parcial = sorteia_rodada(pool, N_PONTOS, semente, bloco_ini, bloco_fim, &pedido, replicas_local);
+            local->dentro += parcial.dentro;
+            local->total += parcial.total;
+            empacota_rodada(parcial, replicas_local, replicas, interrompido, contagem_local[atual]);
+        }
+
+        /* Contagens exatas (inteiras) da rodada anterior, somadas entre todos os processos */
+        if(reduzindo){
+            uint64_t *soma = contagem_rodada[1 - atual];
+            MPI_Wait(&pedido, MPI_STATUS_IGNORE); // Retorna imediatamente se MPI_Test já a concluiu
+            reduzindo = 0;
+            total.dentro += soma[0];
+            total.total += soma[1];
+            for(int r=0; r<replicas; r++){
+                por_replica[r].dentro += soma[2 + 2*r];
+                por_replica[r].total += soma[3 + 2*r];
+            }
+            parou |= (soma[2 + 2*replicas] > 0);
+
+            mc_estimativa_t est = mc_estimar_replicas(por_replica, replicas, prog->confianca);
+            convergiu |= (prog->erro_alvo > 0 && est.semi_intervalo <= prog->erro_alvo); // Mesmo valor em todos os processos
+
+            double agora = MPI_Wtime();
+            if(rank == 0 && prog->intervalo > 0 && agora - ultimo >= prog->intervalo){ // Estimativa parcial
+                printf("[%.1fs] %llu pontos: PI = %.10f ± %.3e\n", agora - inicio, (unsigned long long)total.total, est.pi, est.semi_intervalo);
+                fflush(stdout);
+                ultimo = agora;
+            }
+
+            /* Depois da parada só o estado final é gravado: a rodada já sorteada ainda entra na contagem */
+            if(rank == 0 && ckpt->arquivo && (!sorteia || (agora - ultimo_ckpt >= ckpt->periodo && !convergiu && !parou))){
+                estado.bloco = fim_reduzindo;
+                estado.contagem = total;
+                if(ckpt_gravar_mc(ckpt->arquivo, &estado) != 0)
+                    fprintf(stderr, "AVISO: não foi possível gravar o checkpoint %s\n", ckpt->arquivo);
+                ultimo_ckpt = agora;
+            }
+        }
+        if(!sorteia)
+            break;
+
+        MPI_Iallreduce(contagem_local[atual], // Contagem local de pontos
+                       contagem_rodada[atual], // Contagem de todos os processos
+                       n_contagens, // Número de dados que serão reduzidos
+                       MPI_UINT64_T, // Tipo de dado que será reduzido
+                       MPI_SUM, // Operação que será aplicada
+                       MPI_COMM_WORLD,
+                       &pedido);
+        reduzindo = 1;
+        fim_reduzindo = fim;
+        atual = 1 - atual;
+        b = fim;
+    }
+    if(parou && rank == 0)
+        printf("Interrompido: %llu pontos sorteados\n", (unsigned long long)total.total);
+
+    return total; // Retorna a contagem exata de pontos, somada entre os processos
+}
+
+/* Calcula os dígitos hexadecimais de PI a partir da posição informada. Cada processo soma um intervalo
+de termos da série e o processo 0 reduz as somas (ponto fixo módulo 1, o resultado não depende da divisão) */
+void extrai_digitos(unsigned long long posicao, bbp_formula_t formula, int n_threads, int rank, int size){
+    uint64_t n_termos = bbp_num_termos(formula, posicao), termo_ini, termo_fim;
+    uint64_t soma_local, soma;
+    double inicio = MPI_Wtime();
+
+    divide_blocos(0, n_termos, rank, size, &termo_ini, &termo_fim);
+    soma_local = bbp_soma(formula, posicao, termo_ini, termo_fim, n_threads);
+    printf("Processo %d de %d (%d threads), termos [%llu, %llu) em %lf seg\n", rank+1, size, n_threads,
+           (unsigned long long)termo_ini, (unsigned long long)termo_fim, MPI_Wtime() - inicio);
+
+    /* A soma de inteiros sem sinal transborda módulo 2^64, exatamente a parte fracionária */
+    MPI_Reduce(&soma_local, &soma, 1, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if(rank == 0){
+        char hex[17];
+        bbp_hexadecimal(soma, bbp_digitos_confiaveis(formula, posicao), hex);
+        puts("\n[#]Cálculo realizado com sucesso!");
+        printf("\n[#]Dígitos hexadecimais de PI após a posição %llu: %s\n", posicao, hex);
+        printf("[#]TEMPO DE EXECUÇÃO (em segundos): %lf\n\n", MPI_Wtime() - inicio);
+    }
 }
 
 int main(int argc, char *argv[]){
     setlocale(LC_ALL,"Portuguese");
 
-    long long int n_pontos; // Quantidade de pontos que serão sorteados
+    long long int n_pontos = -1; // Quantidade de pontos que serão sorteados
+    unsigned long long semente = (unsigned long long)time(NULL); // Semente comum a todos os processos
+    int n_threads = 1; // Threads por processo
+    mc_pool_t *pool; // Threads do processo
+    mc_resultado_t local = {0, 0}, total; // Contagem do processo e de todos os processos
+    mc_resultado_t por_replica[MC_MAX_REPLICAS]; // Contagem de cada réplica da amostragem, de todos os processos
+    char amostragem[16] = "pseudo"; // pseudo, sobol ou halton
+    char precisao[16] = "double"; // Teste do círculo: double, float ou inteiro
+    int estimador = MC_ACERTO; // Estimador de PI/4 (-1 = nome inválido)
+    int replicas = 0; // Réplicas independentes da amostragem (0 = padrão)
+    int afinidade = TOPO_NENHUMA; // Posicionamento das threads (-1 = nome inválido)
+    mc_estimativa_t est; // Valor resultante de PI e seu erro
+    progresso_t prog = {0, MC_CONFIANCA, 0};
+    long long int posicao = -1; // Posição dos dígitos hexadecimais (-1 = Método de Monte Carlo)
+    int formula = BBP_BELLARD; // Fórmula da extração de dígitos
+    ckpt_config_t ckpt = {NULL, CKPT_PERIODO, 0}; // Checkpoints (somente o processo 0 grava)
+    ckpt_mc_t estado = {0, 0, 0, 0, 0, 0, {0, 0}}; // Estado inicial: início ou checkpoint retomado
+    uint64_t estado_bcast[4]; // {por_rodada, bloco, dentro, total}
+    uint64_t processo[3], *processos = NULL; // {threads, dentro, total} deste processo e de todos (processo 0)
 
     int rank, // Identificador de processo
         size, // Número de processos
-        namelen; // Comprimento (em caracteres) do nome do processador
+        namelen, // Comprimento (em caracteres) do nome do processador
+        rank_local, // Posição do processo entre os da mesma máquina
+        provided, // Nível de suporte a threads fornecido pelo MPI
+        opt;
 
-    double pi_local, // Valor de PI de cada processo
-           soma_pi, // Valor de PI somado (soma de todos os PI calculados pelos processos)
-           media_pi, // Média do PI (valor resultante)
-           tempo_inicio, // Tempo inicial
+    double tempo_inicio, // Tempo inicial
            tempo_fim, // Tempo final
            tempo_decorrido; // Diferença entre o tempo final e inicial
 
     char processor_name[MPI_MAX_PROCESSOR_NAME]; // Nome do processador
 
-    MPI_Init(&argc, &argv); // Inicialização dos processos MPI
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided); // Somente a thread principal chama o MPI
     MPI_Comm_size(MPI_COMM_WORLD, &size); // Determinação do número de processos no comunicador
     tempo_inicio = MPI_Wtime(); // Inicia contagem do tempo
     MPI_Comm_rank(MPI_COMM_WORLD, &rank); // Identifica o processo dentro do grupo de processos iniciados pelo comunicador
     MPI_Get_processor_name(processor_name, &namelen); // Obtém o nome do processador
 
+    /* As threads do pool sorteiam enquanto a thread principal chama o MPI (MPI_Test durante as rodadas) */
+    if(provided < MPI_THREAD_FUNNELED){
+        if (rank == 0)
+            puts("A biblioteca MPI não suporta threads (MPI_THREAD_FUNNELED)");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
     /* Apenas o processo 0 conhece o número de pontos e o tempo execução */
     if (rank == 0){
-        n_pontos = atol(argv[1]); // Atribui o número de pontos a serem sorteados à variável n_pontos
-        puts("#=== CÁLCULO DE PI COM MPI - MÉTODO DE MONTE CARLO ===#");
-        fprintf(stdout,"#Processador: %s\n", processor_name); // Imprime o nome do processador
-        printf("#Quantidade total de pontos que serão sorteados: %lld\n\n", n_pontos); // Imprime o número total de pontos
+        while((opt = getopt(argc, argv, "t:s:e:g:i:x:f:C:P:Rq:r:p:E:a:")) != -1){
+            switch(opt){
+                case 't': n_threads = atoi(optarg); break;
+                case 's': semente = strtoull(optarg, NULL, 10); break;
+                case 'e': prog.erro_alvo = atof(optarg); break;
+                case 'g': prog.confianca = atof(optarg); break;
+                case 'i': prog.intervalo = atof(optarg); break;
+                case 'x': posicao = atoll(optarg); break;
+                case 'f': formula = (strcmp(optarg, "bbp") == 0) ? BBP_BBP : (strcmp(optarg, "bellard") == 0) ? BBP_BELLARD : -1; break;
+                case 'C': ckpt.arquivo = optarg; break;
+                case 'P': ckpt.periodo = atof(optarg); break;
+                case 'R': ckpt.retomar = 1; break;
+                case 'q': snprintf(amostragem, sizeof(amostragem), "%s", optarg); break;
+                case 'r': replicas = atoi(optarg); break;
+                case 'p': snprintf(precisao, sizeof(precisao), "%s", optarg); break;
+                case 'E': estimador = mc_estimador_id(optarg); break;
+                case 'a': afinidade = topo_politica_id(optarg); break;
+                default:
+                    printf("Use: mpirun -np [numero_processos] %s [numero_pontos] [-t threads] [-s semente] [-e erro_alvo] [-g confianca] [-i intervalo] [-x posicao] [-f bbp|bellard] [-C checkpoint] [-P periodo] [-R] [-q amostragem] [-r replicas] [-p precisao] [-E estimador] [-a afinidade]\n", argv[0]);
+                    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+                    break;
+            }
+        }
+        if(formula < 0){
+            puts("Fórmula inválida (bbp ou bellard)");
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+        if(ckpt.retomar){ // A execução retomada continua com os parâmetros da original
+            if(!ckpt.arquivo || ckpt_ler_mc(ckpt.arquivo, &estado) != 0){
+                printf("Checkpoint inexistente ou inválido: %s\n", ckpt.arquivo ? ckpt.arquivo : "(informe com -C)");
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+            n_pontos = (long long int)estado.n_pontos;
+            semente = estado.semente;
+            prog.erro_alvo = estado.erro_alvo;
+            prog.confianca = estado.confianca;
+        }
+        if(optind < argc){
+            if(ckpt.retomar){ // Outra quantidade de pontos muda o tamanho dos blocos e a contagem deixaria de ser a da original
+                printf("A execução retomada sorteia os %lld pontos do checkpoint: não informe numero_pontos com -R\n", n_pontos);
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+            n_pontos = atoll(argv[optind]); // Atribui o número de pontos a serem sorteados à variável n_pontos
+        }
+        if(prog.erro_alvo > 0 && n_pontos <= 0)
+            n_pontos = MC_PONTOS_ILIMITADO; // Termina somente pela convergência
+        if(n_threads <= 0)
+            n_threads = mc_num_cpus();
+        if(prog.confianca <= 0 || prog.confianca >= 1)
+            prog.confianca = MC_CONFIANCA;
+
+        if(posicao >= 0){
+            puts("#=== CÁLCULO DE PI COM MPI - EXTRAÇÃO DE DÍGITOS ===#");
+            fprintf(stdout,"#Processador: %s\n", processor_name);
+            printf("#Fórmula: %s\n#Posição: %lld\n#Termos da série: %llu\n", formula == BBP_BBP ? "BBP" : "Bellard",
+                   posicao, (unsigned long long)bbp_num_termos(formula, posicao));
+            printf("#Threads por processo: %d\n\n", n_threads);
+        } else{
+            puts("#=== CÁLCULO DE PI COM MPI - MÉTODO DE MONTE CARLO ===#");
+            fprintf(stdout,"#Processador: %s\n", processor_name); // Imprime o nome do processador
+            printf("#Quantidade total de pontos que serão sorteados: %lld\n", n_pontos); // Imprime o número total de pontos
+            printf("#Threads por processo: %d\n", n_threads);
+            printf("#Amostragem: %s\n#Precisão: %s\n", amostragem, precisao);
+            if(prog.erro_alvo > 0)
+                printf("#Erro alvo: %.3e (confiança de %.0f%%)\n", prog.erro_alvo, 100*prog.confianca);
+            printf("#Semente: %llu\n", semente); // Imprime a semente para permitir reproduzir a execução
+            if(ckpt.retomar)
+                printf("#Retomado do checkpoint %s: %llu pontos já sorteados\n", ckpt.arquivo, (unsigned long long)estado.contagem.total);
+            putchar('\n');
+        }
         puts("Calculando...\n");
     }
 
-    srand(time(NULL) + rank); // Inicializa gerador de números com semente aleatória para geração de coordenadas (Monte Carlo)
-
     /* O processo 0 distribui para o resto dos processos o número de iterações que calcularemos para a estimativa de PI */
     MPI_Bcast(&n_pontos, // Ponteiro para os dados que serão enviados
                1, // Número de dados para os quais o ponteiro aponta
                MPI_LONG_LONG_INT, // Tipo de dado que será enviado (long long int)
                0, // Identificação do processo que envia os dados
                MPI_COMM_WORLD);
-     
+
+    /* Todos os processos usam a mesma semente e a mesma quantidade de threads */
+    MPI_Bcast(&semente, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&n_threads, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&prog, 3, MPI_DOUBLE, 0, MPI_COMM_WORLD); // progresso_t: três doubles
+    MPI_Bcast(&posicao, 1, MPI_LONG_LONG_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&formula, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(amostragem, sizeof(amostragem), MPI_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&replicas, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(precisao, sizeof(precisao), MPI_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&estimador, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&afinidade, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    /* Posicionamento: as threads de cada processo começam depois das dos processos anteriores da mesma máquina */
+    if(afinidade < 0){
+        if (rank == 0)
+            puts("Afinidade inválida (nenhuma, compacta, espalhada ou fisica)");
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+    MPI_Comm maquina;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &maquina);
+    MPI_Comm_rank(maquina, &rank_local);
+    MPI_Comm_free(&maquina);
+    if(topo_configurar((topo_politica_t)afinidade, rank_local*n_threads) != 0 && rank == 0)
+        puts("AVISO: topologia indisponível, as threads não serão fixadas");
+    if(rank == 0 && afinidade != TOPO_NENHUMA)
+        topo_descrever(stdout);
+
+    /* Extração de dígitos: não sorteia pontos */
+    if(posicao >= 0){
+        extrai_digitos(posicao, (bbp_formula_t)formula, n_threads, rank, size);
+        MPI_Finalize();
+        return 0;
+    }
+
     /* Encerra caso quantidade de pontos <= 0 */
     if (n_pontos <= 0){
-        puts("Insira uma quantidade positiva de pontos!");
+        if (rank == 0)
+            puts("Insira uma quantidade positiva de pontos!");
         MPI_Finalize();
-    } else{
-        // Cálculo de PI (para cada processo)
-        pi_local = montecarlo_pi(n_pontos/size, rank, size); // Chama a função que calcula o PI pelo Método de Monte Carlo
-        printf(" - PI calculado = %.8f\n", pi_local); // Imprime o valor de PI calculado para cada processo
+        return EXIT_FAILURE;
     }
 
-    /* Todos os processos agora compartilham seu valor de PI local */ 
-    MPI_Reduce(&pi_local, // Valor local de PI
-               &soma_pi, // Valor resultante de PI
-               1, // Número de dados que serão reduzidos
-               MPI_DOUBLE, // Tipo de dado que será reduzido
-               MPI_SUM, // Operação que será aplicada 
-               0, // Processo que receberá os dados reduzidos
-               MPI_COMM_WORLD);
+    /* Mesmo estimador em todos os processos (somente com o sorteio pseudoaleatório em double) */
+    if(mc_selecionar_estimador(estimador) != 0 || (estimador != MC_ACERTO && (ckpt.arquivo || strcmp(amostragem, "pseudo") != 0))){
+        if (rank == 0)
+            puts("Estimador inválido (acerto, antitetico, estratificado ou controle; os demais somente com -q pseudo e sem checkpoints)");
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    /* Mesma amostragem em todos os processos; o checkpoint guarda somente a contagem total */
+    if(mc_selecionar_amostragem(amostragem, replicas) != 0 || (ckpt.arquivo && (mc_replicas() > 1 || strcmp(amostragem, "pseudo") != 0))){
+        if (rank == 0)
+            printf("Amostragem inválida: %s com %d réplicas (pseudo, sobol ou halton, até %d réplicas; checkpoints somente com pseudo e uma réplica)\n",
+                   amostragem, replicas, MC_MAX_REPLICAS);
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
 
-    /* Apenas o processo 0 imprime a mensagem com o valor resultante de PI e o tempo de execução, 
-    pois é o único que conhece esses valores */
+    /* Os kernels de 32 bits têm contagens próprias, que o checkpoint não identifica; as sequências usam somente double */
+    if(mc_selecionar_precisao(precisao) != 0 || (strcmp(precisao, "double") != 0 && (ckpt.arquivo || strcmp(amostragem, "pseudo") != 0 || estimador != MC_ACERTO))){
+        if (rank == 0)
+            printf("Precisão inválida: %s (double, float ou inteiro; checkpoints, amostragens sobol e halton e estimadores somente em double)\n", precisao);
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    /* Estado inicial e tamanho das rodadas: a execução retomada repete as rodadas da original */
+    estado_bcast[0] = estado.por_rodada;
+    estado_bcast[1] = estado.bloco;
+    estado_bcast[2] = estado.contagem.dentro;
+    estado_bcast[3] = estado.contagem.total;
+    MPI_Bcast(estado_bcast, 4, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+    estado.semente = semente;
+    estado.n_pontos = (uint64_t)n_pontos;
+    estado.erro_alvo = prog.erro_alvo;
+    estado.confianca = prog.confianca;
+    estado.por_rodada = estado_bcast[0];
+    estado.bloco = estado_bcast[1];
+    estado.contagem.dentro = estado_bcast[2];
+    estado.contagem.total = estado_bcast[3];
+    if(estado.por_rodada == 0) // Rodadas com BLOCOS_RODADA blocos por thread, múltiplo do número de réplicas
+        estado.por_rodada = ((uint64_t)size*n_threads*BLOCOS_RODADA + mc_replicas() - 1)/mc_replicas()*mc_replicas();
+
+    pool = mc_pool_criar(n_threads);
+    if(!pool){
+        puts("ERROR: pool de threads");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    /* Cálculo de PI: os blocos são divididos entre os processos (os primeiros recebem um bloco a mais
+    e o último bloco contém o resto dos pontos, portanto nenhum ponto é descartado) */
+    signal(SIGINT, interrompe);
+    signal(SIGTERM, interrompe);
+    total = montecarlo_pi(pool, n_pontos, semente, &prog, &ckpt, &estado, &local, por_replica, rank, size); // Chama a função que calcula o PI pelo Método de Monte Carlo
+    tempo_fim = MPI_Wtime(); // Finaliza contagem do tempo: a última soma já chegou a todos os processos
+
+    /* O processo 0 recebe a contagem de cada processo e as exibe em ordem, antes do resultado */
+    processo[0] = (uint64_t)mc_pool_threads(pool);
+    processo[1] = local.dentro;
+    processo[2] = local.total;
+    if (rank == 0)
+        processos = (uint64_t *)malloc(3*sizeof(uint64_t)*size);
+    MPI_Gather(processo, 3, MPI_UINT64_T, processos, 3, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+
+    /* Apenas o processo 0 imprime a mensagem com o valor resultante de PI e o tempo de execução */
     if (rank == 0){
-        tempo_fim = MPI_Wtime(); // Finaliza contagem do tempo
-        media_pi = soma_pi/size; // Calcula a média dos valores de PI calculados pelos processos
+        for(int p=0; p<size; p++){ // Valor de PI calculado por cada processo
+            uint64_t *c = &processos[3*p];
+            printf("Processo %d de %d (%llu threads), pontos sorteados: %llu - PI calculado = %.8f\n", p+1, size,
+                   (unsigned long long)c[0], (unsigned long long)c[2], c[2] ? 4.0*c[1]/c[2] : 0.0);
+        }
+        free(processos);
+        est = mc_estimar_replicas(por_replica, mc_replicas(), prog.confianca); // PI a partir da contagem total de pontos
         tempo_decorrido = tempo_fim - tempo_inicio; // Calcula o tempo decorrido
-        sleep(1); // Sleep para mostrar os resultados somente ao final
         // Exibe o valor final de PI e o tempo de execução em segundos
         puts("\n[#]Cálculo realizado com sucesso!");
-        printf("\n[#]VALOR FINAL DO PI (média) = %.8f\n", media_pi); 
+        printf("\n[#]Pontos dentro: %llu de %llu\n", (unsigned long long)total.dentro, (unsigned long long)total.total);
+        printf("[#]VALOR FINAL DO PI = %.8f (estimador %s)\n", est.pi, mc_estimador_nome());
+        printf("[#]Erro padrão = %.3e, intervalo de %.0f%% = ± %.3e\n", est.erro_padrao, 100*prog.confianca, est.semi_intervalo);
         printf("[#]TEMPO DE EXECUÇÃO (em segundos): %lf\n\n", tempo_decorrido);
     }
 
+    mc_pool_destruir(pool);
     MPI_Finalize();
-}
\ No newline at end of file
+}
@@ -0,0 +1,229 @@
+/* Protocolo binário entre server.c, client.c e submete.c (ver protocolo.h) */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <endian.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "protocolo.h"
+
+/* Envia todos os bytes (write pode enviar somente parte do buffer) */
+static int proto_enviar_tudo(int fd, const uint8_t *buf, size_t n){
+	while(n > 0){
+		ssize_t enviado = send(fd, buf, n, MSG_NOSIGNAL);
+		if(enviado < 0){
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += enviado;
+		n -= enviado;
+	}
+	return 0;
+}
+
+static void proto_escrever_u64(uint8_t *p, uint64_t v){
+	v = htobe64(v);
+	memcpy(p, &v, 8);
+}
+
+static uint64_t proto_ler_u64(const uint8_t *p){
+	uint64_t v;
+	memcpy(&v, p, 8);
+	return be64toh(v);
+}
+
+static void proto_escrever_double(uint8_t *p, double v){
+	uint64_t bits;
+	memcpy(&bits, &v, 8);
+	proto_escrever_u64(p, bits);
+}
+
+static double proto_ler_double(const uint8_t *p){
+	uint64_t bits = proto_ler_u64(p);
+	double v;
+	memcpy(&v, &bits, 8);
+	return v;
+}
+
+/* Escreve o cabeçalho do quadro e retorna o tamanho total */
+static size_t proto_cabecalho(uint8_t *buf, proto_tipo_t tipo, size_t tam_dados){
+	uint32_t tam = htobe32((uint32_t)(1 + tam_dados));
+	memcpy(buf, &tam, 4);
+	buf[4] = (uint8_t)tipo;
+	return PROTO_TAM_CABECALHO + tam_dados;
+}
+
+/* Converte os dados de um quadro em mensagem. Retorna -1 se o quadro é inválido */
+static int proto_decodificar(proto_tipo_t tipo, const uint8_t *dados, size_t tam, proto_msg_t *msg){
+	memset(msg, 0, sizeof(*msg));
+	msg->tipo = tipo;
+
+	switch(tipo){
+		case PROTO_REGISTRO:
+			if(tam == 0 || tam >= PROTO_TAM_NOME)
+				return -1;
+			memcpy(msg->nome, dados, tam);
+			msg->nome[tam] = '\0';
+			return 0;
+		case PROTO_LOTE:
+			if(tam != 6*8)
+				return -1;
+			msg->lote.id = proto_ler_u64(dados);
+			msg->lote.semente = proto_ler_u64(dados + 8);
+			msg->lote.n_pontos = proto_ler_u64(dados + 16);
+			msg->lote.bloco_ini = proto_ler_u64(dados + 24);
+			msg->lote.bloco_fim = proto_ler_u64(dados + 32);
+			msg->lote.estimador = proto_ler_u64(dados + 40);
+			return 0;
+		case PROTO_RESULTADO:
+		case PROTO_PARCIAL:
+		case PROTO_CONCLUSAO:
+			if(tam != ((tipo == PROTO_CONCLUSAO) ? 5*8 : 3*8))
+				return -1;
+			msg->id = proto_ler_u64(dados);
+			msg->resultado.dentro = proto_ler_u64(dados + 8);
+			msg->resultado.total = proto_ler_u64(dados + 16);
+			if(tipo == PROTO_CONCLUSAO){
+				msg->estimativa.erro_padrao = proto_ler_double(dados + 24);
+				msg->estimativa.semi_intervalo = proto_ler_double(dados + 32);
+			}
+			return 0;
+		case PROTO_SUBMISSAO:
+			if(tam != 6*8)
+				return -1;
+			msg->submissao.n_pontos = proto_ler_u64(dados);
+			msg->submissao.erro_alvo = proto_ler_double(dados + 8);
+			msg->submissao.confianca = proto_ler_double(dados + 16);
+			msg->submissao.prioridade = proto_ler_u64(dados + 24);
+			msg->submissao.blocos_por_lote = proto_ler_u64(dados + 32);
+			msg->submissao.estimador = proto_ler_u64(dados + 40);
+			return 0;
+		case PROTO_ACEITO:
+			if(tam != 2*8)
+				return -1;
+			msg->id = proto_ler_u64(dados);
+			msg->semente = proto_ler_u64(dados + 8);
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+/* Extrai a próxima mensagem completa já recebida. Retorna 1 se extraiu uma mensagem, 0 se ainda
+faltam bytes e -1 se o quadro é inválido */
+int proto_extrair(proto_leitor_t *leitor, proto_msg_t *msg){
+	uint32_t tam;
+
+	if(leitor->n < PROTO_TAM_CABECALHO)
+		return 0;
+
+	memcpy(&tam, leitor->buf, 4);
+	tam = be32toh(tam);
+	if(tam < 1 || tam > PROTO_TAM_MAX - 4)
+		return -1;
+	if(leitor->n < 4 + (size_t)tam)
+		return 0; // Quadro incompleto
+
+	if(proto_decodificar((proto_tipo_t)leitor->buf[4], leitor->buf + PROTO_TAM_CABECALHO, tam - 1, msg) < 0)
+		return -1;
+
+	size_t consumido = 4 + (size_t)tam;
+	memmove(leitor->buf, leitor->buf + consumido, leitor->n - consumido);
+	leitor->n -= consumido;
+	return 1;
+}
+
+/* Espaço livre no buffer de recepção, para leituras diretas do socket */
+uint8_t *proto_espaco(proto_leitor_t *leitor, size_t *livre){
+	*livre = sizeof(leitor->buf) - leitor->n;
+	return leitor->buf + leitor->n;
+}
+
+/* Lê a próxima mensagem (socket bloqueante). Retorna 1 se recebeu uma mensagem, 0 se a conexão foi encerrada e -1 em caso de erro */
+int proto_ler(int fd, proto_leitor_t *leitor, proto_msg_t *msg){
+	while(1){
+		int r = proto_extrair(leitor, msg);
+		if(r != 0)
+			return r;
+
+		size_t livre;
+		uint8_t *espaco = proto_espaco(leitor, &livre);
+		ssize_t recebido = recv(fd, espaco, livre, 0);
+		if(recebido == 0)
+			return 0;
+		if(recebido < 0){
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		leitor->n += recebido;
+	}
+}
+
+/* Codificação das mensagens; buf deve ter pelo menos PROTO_TAM_MAX bytes. Retornam o tamanho do quadro */
+size_t proto_codificar_registro(uint8_t *buf, const char *nome){
+	size_t tam = strnlen(nome, PROTO_TAM_NOME - 1);
+	memcpy(buf + PROTO_TAM_CABECALHO, nome, tam);
+	return proto_cabecalho(buf, PROTO_REGISTRO, tam);
+}
+
+size_t proto_codificar_lote(uint8_t *buf, const lote_t *lote){
+	uint8_t *dados = buf + PROTO_TAM_CABECALHO;
+	proto_escrever_u64(dados, lote->id);
+	proto_escrever_u64(dados + 8, lote->semente);
+	proto_escrever_u64(dados + 16, lote->n_pontos);
+	proto_escrever_u64(dados + 24, lote->bloco_ini);
+	proto_escrever_u64(dados + 32, lote->bloco_fim);
+	proto_escrever_u64(dados + 40, lote->estimador);
+	return proto_cabecalho(buf, PROTO_LOTE, 6*8);
+}
+
+static size_t proto_codificar_contagem(uint8_t *buf, proto_tipo_t tipo, uint64_t id, const mc_resultado_t *r){
+	uint8_t *dados = buf + PROTO_TAM_CABECALHO;
+	proto_escrever_u64(dados, id);
+	proto_escrever_u64(dados + 8, r->dentro);
+	proto_escrever_u64(dados + 16, r->total);
+	return proto_cabecalho(buf, tipo, 3*8);
+}
+
+size_t proto_codificar_resultado(uint8_t *buf, uint64_t id, const mc_resultado_t *resultado){
+	return proto_codificar_contagem(buf, PROTO_RESULTADO, id, resultado);
+}
+
+size_t proto_codificar_parcial(uint8_t *buf, uint64_t id, const mc_resultado_t *parcial){
+	return proto_codificar_contagem(buf, PROTO_PARCIAL, id, parcial);
+}
+
+static size_t proto_codificar_submissao(uint8_t *buf, const submissao_t *submissao){
+	uint8_t *dados = buf + PROTO_TAM_CABECALHO;
+	proto_escrever_u64(dados, submissao->n_pontos);
+	proto_escrever_double(dados + 8, submissao->erro_alvo);
+	proto_escrever_double(dados + 16, submissao->confianca);
+	proto_escrever_u64(dados + 24, submissao->prioridade);
+	proto_escrever_u64(dados + 32, submissao->blocos_por_lote);
+	proto_escrever_u64(dados + 40, submissao->estimador);
+	return proto_cabecalho(buf, PROTO_SUBMISSAO, 6*8);
+}
+
+size_t proto_codificar_aceito(uint8_t *buf, uint64_t trabalho, uint64_t semente){
+	uint8_t *dados = buf + PROTO_TAM_CABECALHO;
+	proto_escrever_u64(dados, trabalho);
+	proto_escrever_u64(dados + 8, semente);
+	return proto_cabecalho(buf, PROTO_ACEITO, 2*8);
+}
+
+size_t proto_codificar_conclusao(uint8_t *buf, uint64_t trabalho, const mc_resultado_t *resultado, const mc_estimativa_t *estimativa){
+	uint8_t *dados = buf + PROTO_TAM_CABECALHO;
+	proto_codificar_contagem(buf, PROTO_CONCLUSAO, trabalho, resultado);
+	proto_escrever_double(dados + 24, estimativa->erro_padrao);
+	proto_escrever_double(dados + 32, estimativa->semi_intervalo);
+	return proto_cabecalho(buf, PROTO_CONCLUSAO, 5*8);
+}
+
+int proto_enviar_submissao(int fd, const submissao_t *submissao){
+	uint8_t buf[PROTO_TAM_MAX];
+	return proto_enviar_tudo(fd, buf, proto_codificar_submissao(buf, submissao));
+}
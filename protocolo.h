@@ -0,0 +1,100 @@
+/* Protocolo binário entre server.c, client.c e submete.c
+
+Cada mensagem é um quadro com tamanho prefixado:
+	uint32 tamanho   bytes que seguem este campo (tipo + dados)
+	uint8  tipo      proto_tipo_t
+	dados            campos inteiros de 64 bits, todos em ordem de rede (big-endian)
+
+	REGISTRO   cliente -> servidor   nome (texto, sem terminador)
+	LOTE       servidor -> cliente   id, semente, n_pontos, bloco_ini, bloco_fim, estimador
+	RESULTADO  cliente -> servidor   id, dentro, total
+	PARCIAL    cliente -> servidor   id, dentro, total (contagem parcial do lote em andamento)
+	SUBMISSAO  submete -> servidor   n_pontos, erro_alvo, confianca, prioridade, blocos_por_lote, estimador
+	ACEITO     servidor -> submete   trabalho, semente
+	CONCLUSAO  servidor -> submete   trabalho, dentro, total (contagens finais do trabalho), erro_padrao,
+	                                 semi_intervalo (erro do estimador, ver escalonador_estimar)
+
+O cliente responde cada LOTE com um RESULTADO, que também funciona como pedido do próximo lote. Sem lotes
+disponíveis o cliente fica ocioso até o próximo trabalho, e o fechamento da conexão encerra o cliente.
+Os bloco_ini..bloco_fim do lote identificam os fluxos do gerador (montecarlo.h), e o resultado
+traz as contagens exatas de pontos. Enquanto calcula um lote o cliente envia PARCIAL periodicamente,
+que é também o sinal de vida do cliente: qualquer mensagem recebida renova o seu prazo no servidor
+(timeout de clientes mortos), então não há mensagem própria de heartbeat.
+
+Os clientes não identificam o trabalho (fila.h) dos lotes: cada cliente calcula um lote de cada vez e o
+servidor sabe a qual trabalho ele pertence, e o estimador (mc_estimador_t) de cada lote é o do trabalho.
+Os campos double (erro_alvo, confianca, erro_padrao, semi_intervalo) vão pelos seus bits. */
+
+#ifndef PROTOCOLO_H
+#define PROTOCOLO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "montecarlo.h"
+
+#define PROTO_TAM_CABECALHO 5 // tamanho (4) + tipo (1)
+#define PROTO_TAM_MAX 128 // Tamanho máximo de um quadro
+#define PROTO_TAM_NOME 32 // Tamanho máximo do nome do cliente (com terminador)
+
+/* Lote de trabalho: blocos [bloco_ini, bloco_fim) de um sorteio de n_pontos com a semente informada */
+typedef struct{
+	uint64_t id;
+	uint64_t semente;
+	uint64_t n_pontos;
+	uint64_t bloco_ini;
+	uint64_t bloco_fim;
+	uint64_t estimador; // mc_estimador_t
+} lote_t;
+
+/* Trabalho submetido ao servidor */
+typedef struct{
+	uint64_t n_pontos; // Limite de pontos sorteados
+	double erro_alvo; // Encerra quando PI ± erro_alvo (0 = sorteia todos os pontos)
+	double confianca;
+	uint64_t prioridade; // >= 1
+	uint64_t blocos_por_lote; // 0 = padrão do servidor
+	uint64_t estimador; // mc_estimador_t
+} submissao_t;
+
+typedef enum{
+	PROTO_INVALIDA = 0,
+	PROTO_REGISTRO,
+	PROTO_LOTE,
+	PROTO_RESULTADO,
+	PROTO_PARCIAL,
+	PROTO_SUBMISSAO,
+	PROTO_ACEITO,
+	PROTO_CONCLUSAO
+} proto_tipo_t;
+
+typedef struct{
+	proto_tipo_t tipo;
+	char nome[PROTO_TAM_NOME]; // PROTO_REGISTRO
+	lote_t lote; // PROTO_LOTE
+	uint64_t id; // PROTO_RESULTADO, PROTO_PARCIAL, PROTO_ACEITO e PROTO_CONCLUSAO (trabalho)
+	mc_resultado_t resultado; // PROTO_RESULTADO, PROTO_PARCIAL e PROTO_CONCLUSAO
+	submissao_t submissao; // PROTO_SUBMISSAO
+	uint64_t semente; // PROTO_ACEITO
+	mc_estimativa_t estimativa; // PROTO_CONCLUSAO (somente erro_padrao e semi_intervalo)
+} proto_msg_t;
+
+/* Acumula os bytes recebidos até completar um quadro (recv pode retornar quadros parciais ou vários juntos) */
+typedef struct{
+	uint8_t buf[2*PROTO_TAM_MAX];
+	size_t n;
+} proto_leitor_t;
+
+int proto_extrair(proto_leitor_t *leitor, proto_msg_t *msg);
+uint8_t *proto_espaco(proto_leitor_t *leitor, size_t *livre);
+int proto_ler(int fd, proto_leitor_t *leitor, proto_msg_t *msg);
+
+size_t proto_codificar_registro(uint8_t *buf, const char *nome);
+size_t proto_codificar_lote(uint8_t *buf, const lote_t *lote);
+size_t proto_codificar_resultado(uint8_t *buf, uint64_t id, const mc_resultado_t *resultado);
+size_t proto_codificar_parcial(uint8_t *buf, uint64_t id, const mc_resultado_t *parcial);
+size_t proto_codificar_aceito(uint8_t *buf, uint64_t trabalho, uint64_t semente);
+size_t proto_codificar_conclusao(uint8_t *buf, uint64_t trabalho, const mc_resultado_t *resultado, const mc_estimativa_t *estimativa);
+
+int proto_enviar_submissao(int fd, const submissao_t *submissao);
+
+#endif
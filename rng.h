@@ -0,0 +1,71 @@
+/* Gerador de números pseudoaleatórios compartilhado pelos programas de cálculo de PI
+
+xoshiro256++ (Blackman e Vigna): estado de 256 bits, período 2^256 - 1, sem trava
+e sem estado global, ou seja, cada thread/processo/cliente possui o seu próprio gerador.
+
+O estado é derivado do par (semente, fluxo) com o splitmix64. A mesma semente com
+fluxos diferentes gera sequências independentes e reprodutíveis, permitindo que
+processos MPI, threads e clientes da rede sorteiem pontos sem compartilhar nada. */
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+#include <string.h>
+
+/* Estado do gerador */
+typedef struct{
+	uint64_t s[4];
+} rng_t;
+
+/* Avança o splitmix64, utilizado somente na inicialização do estado */
+static inline uint64_t splitmix64(uint64_t *x){
+	uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static inline uint64_t rng_rotl(uint64_t x, int k){
+	return (x << k) | (x >> (64 - k));
+}
+
+/* Inicializa o gerador para o fluxo informado (ex.: rank MPI, thread ou cliente) */
+static inline void rng_semear(rng_t *rng, uint64_t semente, uint64_t fluxo){
+	uint64_t x = semente;
+	x = splitmix64(&x) ^ (fluxo * 0xD1B54A32D192ED03ULL); // Mistura semente e fluxo (bijetora no fluxo)
+
+	for(int i=0; i<4; i++)
+		rng->s[i] = splitmix64(&x);
+}
+
+/* Próximo número de 64 bits da sequência */
+static inline uint64_t rng_proximo(rng_t *rng){
+	uint64_t *s = rng->s;
+	uint64_t resultado = rng_rotl(s[0] + s[3], 23) + s[0];
+	uint64_t t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rng_rotl(s[3], 45);
+
+	return resultado;
+}
+
+/* Converte 64 bits aleatórios em double no intervalo [0,1) usando os 52 bits mais altos como mantissa */
+static inline double rng_double(uint64_t u){
+	uint64_t bits = (u >> 12) | 0x3FF0000000000000ULL; // Número em [1,2)
+	double d;
+	memcpy(&d, &bits, sizeof(d));
+	return d - 1.0;
+}
+
+/* Gera coordenadas para o Método de Monte Carlo */
+static inline double gera_coord(rng_t *rng){
+	return rng_double(rng_proximo(rng)); // Retorna coordenada com valor entre 0 e 1
+}
+
+#endif
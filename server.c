@@ -1,244 +1,919 @@
 /* COMPILAÇÃO:
-gcc -pthread -o server server.c
+gcc -O2 -pthread -o server server.c escalonador.c fila.c protocolo.c canal.c montecarlo.c topologia.c checkpoint.c metricas.c -lm
 
 EXECUÇÃO:
-./server [port] */
+./server [port] [-c clientes] [-n pontos] [-l blocos_por_lote] [-e erro_alvo] [-g confianca] [-i intervalo_seg]
+         [-E estimador] [-C checkpoint] [-P periodo_seg] [-R] [-T timeout_seg] [-t reatores] [-j trabalhos_ativos] [-M porta_metricas]
+
+Vários trabalhos: além do trabalho inicial das opções (-n 0 = nenhum), o servidor aceita trabalhos de
+submete.c e divide os clientes conectados entre até trabalhos_ativos (padrão 4) deles, com prioridades e
+compartilhamento justo (fila.h); os demais aguardam na fila. Ao fim de um trabalho os clientes continuam
+conectados e passam a calcular os lotes dos outros
+
+Reatores: cada uma das threads (padrão 4, no máximo uma por núcleo) tem o seu socket de escuta na mesma
+porta (SO_REUSEPORT, o núcleo distribui as conexões), o seu epoll e os seus clientes. Os resultados vão
+para o escalonador sem travas e nenhuma thread escreve nos sockets de outra: os avisos entre reatores
+(início, lote devolvido, fim) passam por um eventfd
+
+Clientes locais: o servidor também escuta o socket unix abstrato da porta e troca as mensagens com os clientes
+da mesma máquina por anéis em memória compartilhada (canal.h); o socket de escuta unix é compartilhado pelos
+reatores (EPOLLEXCLUSIVE) e os clientes de outras máquinas continuam no TCP
+
+Modo progressivo: com -i o servidor exibe a estimativa parcial (lotes concluídos e contagens parciais
+enviadas pelos clientes) de cada trabalho ativo e com -e encerra o trabalho assim que PI ± erro_alvo for
+atingido (sem -n o limite é QTD_PONTOS_ALVO pontos); os lotes do trabalho encerrado ainda em andamento
+são descartados quando chegam
+
+Estimadores: com -E (acerto, antitetico, estratificado ou controle, ver montecarlo.h) os clientes sorteiam os
+lotes do trabalho inicial com o estimador escolhido; os trabalhos de submete.c informam o seu. Com os
+estimadores de redução de variância o erro e a parada vêm da variância entre os lotes (escalonador.h)
+
+Tolerância a falhas: um cliente que se desconecta, ou que passa timeout_seg (padrão 10) sem enviar
+nada enquanto calcula um lote, é removido e o seu lote é entregue a outro cliente (inclusive a um que
+se conecte depois); o cálculo termina enquanto houver ao menos um cliente
+
+Checkpoints: com -C o servidor grava os lotes concluídos do trabalho inicial no arquivo a cada periodo_seg (padrão 60)
+e ao final; com -R retoma o trabalho gravado (semente, pontos e erro alvo vêm do checkpoint) e
+entrega aos clientes somente os lotes que faltam, com o mesmo resultado da execução ininterrupta
+
+Métricas: cada reator grava contadores e histogramas (lotes, latência dos lotes, RTT das conexões,
+períodos ociosos) na sua fatia e cada cliente tem a sua vazão e os seus tempos (metricas.h); com -M
+elas ficam em http://127.0.0.1:porta_metricas/metrics no formato do Prometheus, com a fila de trabalhos,
+ex. curl -s localhost:9100/metrics | grep pi_trabalhador_vazao */
+
+#define _GNU_SOURCE // accept4
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <locale.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <string.h>
-#include <pthread.h>
 #include <sys/types.h>
 #include <math.h>
 #include <time.h>
-
-#define NUM_CLIENTS 2 // Número de clientes que realizarão o cálculo
-#define QTD_PONTOS 1000LL // Quantidade de pontos que serão sorteados (LL para suportar 10^10 pontos)
-#define PTS_ENVIO (QTD_PONTOS/NUM_CLIENTS) // Divisão de pontos entre os clientes
-#define BUFFER_SZ 2048 // Tamanho do buffer
+#include <pthread.h>
+#include <stdatomic.h>
+#include "escalonador.h"
+#include "fila.h"
+#include "protocolo.h"
+#include "checkpoint.h"
+#include "metricas.h"
+#include "canal.h"
+
+#define NUM_CLIENTS 2 // Número de clientes que realizarão o cálculo (padrão)
+#define QTD_PONTOS 1000LL // Quantidade de pontos que serão sorteados (padrão)
+#define QTD_PONTOS_ALVO 1000000000000LL // Limite de pontos com erro alvo e sem -n
+#define BLOCOS_POR_LOTE 16 // Blocos (de MC_TAM_BLOCO pontos) entregues a cada pedido de um cliente (padrão)
+#define MAX_EVENTOS 256 // Eventos tratados a cada chamada do epoll_wait
+#define TIMEOUT_CLIENTE 10.0 // Segundos sem mensagens até um cliente com lote ser considerado morto (padrão)
+#define INTERVALO_VERIFICACAO 1.0 // Segundos entre duas verificações dos timeouts
+#define REATORES 4 // Threads que atendem os clientes (padrão)
 
 /* Variáveis globais */
-static _Atomic unsigned int cli_count = 0; // Contador de clientes que será manipulado pelas threads
-static int uid = 20;
-float soma_pi = 0;
-int cont = 0;
+static atomic_uint cli_count = 0; // Clientes registrados (com nome)
+static atomic_int uid = 20;
+static int num_clients = NUM_CLIENTS; // Clientes aguardados para iniciar o cálculo
+fila_t *fila; // Trabalhos ativos e em espera, cada um com o escalonador que distribui os seus lotes
+trabalho_t *trabalho_inicial = NULL; // Trabalho das opções de linha de comando (referência mantida pelos checkpoints)
+unsigned long long blocos_por_lote = BLOCOS_POR_LOTE; // Tamanho dos lotes dos trabalhos que não o informam
+atomic_int iniciado = 0; // Indica se todos os clientes aguardados já se conectaram
+static _Atomic uint64_t submissoes = 0; // Trabalhos submetidos (diferencia as sementes)
+double erro_alvo = 0; // Encerra quando PI ± erro_alvo (0 = sorteia todos os pontos)
+double confianca = MC_CONFIANCA; // Nível de confiança do intervalo
+mc_estimador_t estimador = MC_ACERTO; // Estimador do trabalho inicial
+double intervalo = 0; // Segundos entre duas estimativas parciais (0 = não exibe)
+double relogio_inicio, ultima_estimativa; // Início do cálculo e momento da última estimativa parcial (mc_relogio)
+ckpt_config_t ckpt = {NULL, CKPT_PERIODO, 0}; // Checkpoints do escalonador
+double ultimo_checkpoint; // Momento do último checkpoint (mc_relogio)
+pthread_mutex_t mutex_checkpoint = PTHREAD_MUTEX_INITIALIZER; // O checkpoint final e o periódico podem coincidir
+double timeout_cliente = TIMEOUT_CLIENTE;
+int porta_metricas = 0; // Porta do endpoint das métricas (0 = sem endpoint)
+int canal_escuta = -1; // Socket unix de escuta dos clientes locais (canal.h), o mesmo em todos os reatores
+
+typedef struct reator reator_t;
 
 /* Estrutura do cliente */
 typedef struct{
+	reator_t *reator; // Único reator que lê e escreve no socket do cliente
 	struct sockaddr_in address;
-	long int sockfd; 
+	int sockfd; // Socket TCP, ou o socket unix do canal
+	canal_t *canal; // Anéis em memória compartilhada de um cliente local (NULL = TCP)
 	int uid; // ID do cliente
-	char name[32]; // Nome do cliente
+	char name[PROTO_TAM_NOME]; // Nome do cliente
+	int registrado; // Já enviou a mensagem de registro
+	int ocioso; // Aguarda um lote (todos estão em andamento em outros clientes)
+	int com_lote; // Calcula lote_atual (o lote é devolvido ao escalonador se o cliente cair)
+	trabalho_t *trabalho; // Trabalho do lote em andamento (referência)
+	uint64_t lote_atual; // Lote em andamento no cliente
+	trabalho_t *submetido; // Conexão de submete.c: trabalho cuja conclusão aguarda (referência)
+	double ultimo_contato; // Momento da última mensagem recebida ou do último lote entregue (mc_relogio)
+	mc_resultado_t parcial; // Última contagem parcial do lote em andamento
+	double lote_enviado; // Momento da entrega do lote em andamento (mc_relogio)
+	double ocioso_desde; // Momento em que o cliente passou a aguardar um lote (mc_relogio)
+	met_trabalhador_t *metricas; // Medidas do cliente registrado
+
+	proto_leitor_t leitor; // Bytes recebidos ainda não processados
+	uint8_t *saida; // Bytes ainda não enviados (o socket não aceitou tudo)
+	size_t saida_n, saida_cap;
 } client_t;
 
-client_t *clients[NUM_CLIENTS];
+/* Thread com o seu epoll e a lista dos seus clientes conectados */
+struct reator{
+	pthread_t thread;
+	int epfd; // Descritor do epoll
+	int listenfd;
+	int avisofd; // eventfd: outro reator pede que os clientes sem lote sejam atendidos
+	client_t **clients;
+	size_t clients_n, clients_cap;
+	double ultima_verificacao; // Momento da última verificação dos timeouts (mc_relogio)
+	met_fatia_t *metricas; // Contadores gravados somente por este reator
+};
+
+reator_t *reatores;
+int n_reatores = REATORES;
+
+/* Exibe o valor final de PI do trabalho a partir da contagem exata de pontos de todos os lotes */
+void exibe_resultado(trabalho_t *t){
+	uint64_t n, semente;
+	double alvo, conf;
+	mc_estimador_t e;
+	mc_resultado_t r = escalonador_resultado(t->esc);
+	mc_estimativa_t est = escalonador_estimar(t->esc, t->confianca);
+	escalonador_parametros(t->esc, &n, &semente, &alvo, &conf, &e);
+
+	printf("\n[#]TRABALHO %llu (semente %llu, estimador %s)", (unsigned long long)t->id, (unsigned long long)semente, mc_estimador_nome_id(e));
+	if(alvo > 0)
+		printf(est.semi_intervalo <= alvo ? "\n[#]Erro alvo atingido após %llu pontos" : "\n[#]Erro alvo NÃO atingido com %llu pontos", (unsigned long long)r.total);
+	printf("\n[#]Pontos dentro: %llu de %llu", (unsigned long long)r.dentro, (unsigned long long)r.total);
+	printf("\n[#]VALOR FINAL DO PI = %.8f", est.pi);
+	printf("\n[#]Erro padrão = %.3e, intervalo de %.0f%% = ± %.3e", est.erro_padrao, 100*t->confianca, est.semi_intervalo);
+	double inicio = (t->inicio > relogio_inicio) ? t->inicio : relogio_inicio; // Ativação do trabalho ou início do cálculo
+	printf("\n[#]TEMPO DE EXECUÇÃO: %lf seg", mc_relogio() - inicio); // Exibe o tempo de execução do cálculo em segundos
+	puts("\n\n[#]Cálculo realizado com sucesso!\n");
+}
+
+/* Medidas da fila para o endpoint das métricas: trabalhos ativos e em espera e o andamento de cada ativo */
+void exporta_fila(FILE *f){
+	trabalho_t *ativos[FILA_LIMITE_ATIVOS];
+	size_t n = fila_ativos(fila, ativos, FILA_LIMITE_ATIVOS);
+
+	fprintf(f, "# HELP pi_trabalhos_ativos Trabalhos que recebem clientes\n# TYPE pi_trabalhos_ativos gauge\npi_trabalhos_ativos %zu\n", n);
+	fprintf(f, "# HELP pi_trabalhos_espera Trabalhos na fila de espera\n# TYPE pi_trabalhos_espera gauge\npi_trabalhos_espera %zu\n", fila_espera(fila));
+	fprintf(f, "# HELP pi_trabalho_lotes Lotes do trabalho ativo\n# TYPE pi_trabalho_lotes gauge\n");
+	for(size_t i=0; i<n; i++)
+		fprintf(f, "pi_trabalho_lotes{trabalho=\"%llu\"} %llu\n", (unsigned long long)ativos[i]->id, (unsigned long long)escalonador_num_lotes(ativos[i]->esc));
+	fprintf(f, "# HELP pi_trabalho_lotes_concluidos Lotes concluídos do trabalho ativo\n# TYPE pi_trabalho_lotes_concluidos gauge\n");
+	for(size_t i=0; i<n; i++){
+		uint64_t concluidos;
+		escalonador_andamento(ativos[i]->esc, &concluidos);
+		fprintf(f, "pi_trabalho_lotes_concluidos{trabalho=\"%llu\"} %llu\n", (unsigned long long)ativos[i]->id, (unsigned long long)concluidos);
+		trabalho_liberar(ativos[i]);
+	}
+}
 
-/* Inicializa um mutex estático com atributos padrão */
-pthread_mutex_t clients_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Exibe a estimativa parcial de cada trabalho ativo: lotes concluídos mais as contagens parciais dos lotes em andamento */
+void exibe_estimativa(){
+	trabalho_t *ativos[FILA_LIMITE_ATIVOS];
+	size_t n = fila_ativos(fila, ativos, FILA_LIMITE_ATIVOS);
+
+	ultima_estimativa = mc_relogio();
+	for(size_t i=0; i<n; i++){
+		uint64_t concluidos;
+		mc_resultado_t r = escalonador_andamento(ativos[i]->esc, &concluidos);
+		r.dentro += atomic_load(&ativos[i]->parcial_dentro);
+		r.total += atomic_load(&ativos[i]->parcial_total);
+		if(r.dentro > r.total) // As somas parciais são lidas sem travas e podem estar no meio de uma atualização
+			r.dentro = r.total;
+
+		mc_estimativa_t est = mc_estimar(r, ativos[i]->confianca);
+		printf("[%.1fs] trabalho %llu: %llu pontos (%llu de %llu lotes): PI = %.10f ± %.3e\n", ultima_estimativa - relogio_inicio,
+		       (unsigned long long)ativos[i]->id, (unsigned long long)r.total, (unsigned long long)concluidos,
+		       (unsigned long long)escalonador_num_lotes(ativos[i]->esc), est.pi, est.semi_intervalo);
+		trabalho_liberar(ativos[i]);
+	}
+	fflush(stdout);
+}
 
-/* Tempo */
-struct timespec tempo_inicio, tempo_fim;
-double tempo_decorrido;
+/* Grava os lotes concluídos do trabalho inicial no checkpoint (uma falha não interrompe o servidor) */
+void grava_checkpoint(){
+	pthread_mutex_lock(&mutex_checkpoint);
+	if(escalonador_salvar(trabalho_inicial->esc, ckpt.arquivo) != 0)
+		fprintf(stderr, "AVISO: não foi possível gravar o checkpoint %s\n", ckpt.arquivo);
+	ultimo_checkpoint = mc_relogio();
+	pthread_mutex_unlock(&mutex_checkpoint);
+}
 
-/* Cálculo da média do PI */
-void media_pi(float pi){
-	soma_pi += pi;
-	if(cont == NUM_CLIENTS){ // Exibe o valor final de PI, realizando a média dos valores enviados pelos clientes
-		printf("\n[#]VALOR FINAL DO PI = %.8f", (soma_pi/NUM_CLIENTS)); 
-		clock_gettime(CLOCK_MONOTONIC, &tempo_fim); // Finaliza contagem do tempo
-		tempo_decorrido = (tempo_fim.tv_sec - tempo_inicio.tv_sec);
-		tempo_decorrido += (tempo_fim.tv_nsec - tempo_inicio.tv_nsec) / 1000000000.0;
-		printf("\n[#]TEMPO DE EXECUÇÃO: %lf seg", tempo_decorrido); // Exibe o tempo de execução do cálculo em segundos
-		puts("\n\n[#]Cálculo realizado com sucesso!\n");
+/* Acorda todos os reatores para atenderem os seus clientes sem lote */
+void avisa_reatores(){
+	uint64_t um = 1;
+	for(int i=0; i<n_reatores; i++)
+		if(write(reatores[i].avisofd, &um, sizeof(um)) < 0 && errno != EAGAIN)
+			perror("ERROR: eventfd");
+}
+
+/* Substitui a contagem parcial do cliente, mantendo a soma do trabalho do lote */
+void define_parcial(client_t *cli, mc_resultado_t parcial){
+	if(cli->trabalho){
+		atomic_fetch_add(&cli->trabalho->parcial_total, parcial.total - cli->parcial.total); // Diferenças módulo 2^64
+		atomic_fetch_add(&cli->trabalho->parcial_dentro, parcial.dentro - cli->parcial.dentro);
 	}
+	cli->parcial = parcial;
 }
 
-/* Adiciona o cliente na fila */
-void queue_add(client_t *cl){ 
-	pthread_mutex_lock(&clients_mutex); /* Adquire a propriedade do mutex especificado */
+/* O cliente deixa de calcular o lote atual (concluído, descartado ou abandonado) */
+void libera_lote(client_t *cli){
+	mc_resultado_t zero = {0, 0};
 
-	for(int i=0; i<NUM_CLIENTS; ++i){ // Percorre a lista de clientes para adicionar um novo cliente
-		if(!clients[i]){
-			clients[i] = cl;
-			break;
+	define_parcial(cli, zero);
+	trabalho_liberar(cli->trabalho);
+	cli->trabalho = NULL;
+	cli->com_lote = 0;
+}
+
+/* Adiciona o cliente na lista do reator */
+void queue_add(reator_t *r, client_t *cl){
+	if(r->clients_n == r->clients_cap){
+		r->clients_cap = r->clients_cap ? 2*r->clients_cap : 64;
+		r->clients = (client_t **)realloc(r->clients, r->clients_cap*sizeof(client_t *));
+		if(!r->clients){
+			perror("ERROR: realloc");
+			exit(EXIT_FAILURE);
 		}
 	}
+	r->clients[r->clients_n++] = cl;
+}
 
-	pthread_mutex_unlock(&clients_mutex); /* Desbloqueia o mutex especificado */
+/* Remove cliente da lista do reator */
+void queue_remove(reator_t *r, int uid){
+	for(size_t i=0; i<r->clients_n; ++i){ // Percorre o vetor de clientes para remover um cliente
+		if(r->clients[i]->uid == uid){
+			r->clients[i] = r->clients[--r->clients_n];
+			break;
+		}
+	}
 }
 
-/* Remove cliente da fila */
-void queue_remove(int uid){
-	pthread_mutex_lock(&clients_mutex);
+/* Altera os eventos monitorados do cliente (EPOLLOUT somente enquanto houver dados pendentes). Os clientes
+do canal consomem o anel a cada lote, e o que não coube é enviado no próximo evento do cliente */
+void atualiza_eventos(client_t *cli){
+	struct epoll_event ev;
+	if(cli->canal)
+		return;
+	ev.events = EPOLLIN | (cli->saida_n ? EPOLLOUT : 0);
+	ev.data.ptr = cli;
+	epoll_ctl(cli->reator->epfd, EPOLL_CTL_MOD, cli->sockfd, &ev);
+}
 
-	for(int i=0; i<NUM_CLIENTS; ++i){ // Percorre o vetor de clientes para remover um cliente
-		if(clients[i]){
-			if(clients[i]->uid == uid){
-				clients[i] = NULL;
+/* Envia o que for possível sem bloquear. Retorna -1 se a conexão falhou */
+int envia_pendente(client_t *cli){
+	size_t enviado = 0;
+
+	while(enviado < cli->saida_n){
+		ssize_t n = cli->canal ? canal_enviar(cli->canal, cli->saida + enviado, cli->saida_n - enviado) :
+		                         send(cli->sockfd, cli->saida + enviado, cli->saida_n - enviado, MSG_NOSIGNAL);
+		if(n == 0)
+			break; // Anel cheio
+		if(n < 0){
+			if(errno == EINTR)
+				continue;
+			if(errno == EAGAIN || errno == EWOULDBLOCK)
 				break;
-			}
+			perror("ERROR: write to descriptor failed");
+			return -1;
 		}
+		enviado += n;
 	}
 
-	pthread_mutex_unlock(&clients_mutex);
+	memmove(cli->saida, cli->saida + enviado, cli->saida_n - enviado);
+	cli->saida_n -= enviado;
+	atualiza_eventos(cli);
+
+	return 0;
 }
 
-/* Envia mensagem para todos os clientes */
-void send_message(char *s, int uid){
-	pthread_mutex_lock(&clients_mutex);
+/* Coloca uma mensagem na fila de saída do cliente e tenta enviá-la */
+void envia_mensagem(client_t *cli, const uint8_t *s, size_t n){
+	if(cli->saida_n + n > cli->saida_cap){
+		cli->saida_cap = 2*(cli->saida_n + n);
+		cli->saida = (uint8_t *)realloc(cli->saida, cli->saida_cap);
+		if(!cli->saida){
+			perror("ERROR: realloc");
+			exit(EXIT_FAILURE);
+		}
+	}
+	memcpy(cli->saida + cli->saida_n, s, n);
+	cli->saida_n += n;
+	envia_pendente(cli);
+}
 
-	for(int i=0; i<NUM_CLIENTS; ++i){ // Percorre o vetor de clientes para enviar mensagem 
-		if(clients[i]){
-			if(clients[i]->uid != uid){
-				if(write(clients[i]->sockfd, s, strlen(s)) < 0){
-					perror("ERROR: write to descriptor failed");
-					break;
-				}
+/* Entrega ao cliente o próximo lote de algum trabalho ativo, ou o marca como ocioso se não há nenhum disponível */
+void envia_lote(client_t *cli){
+	uint8_t msg[PROTO_TAM_MAX];
+	lote_t lote;
+	trabalho_t *t = NULL;
+	met_fatia_t *met = cli->reator->metricas;
+	double agora = mc_relogio();
+
+	if(!cli->ocioso)
+		cli->ocioso_desde = agora;
+	cli->ocioso = 0;
+	libera_lote(cli);
+	esc_situacao_t situacao = fila_proximo(fila, &lote, &t);
+	switch(situacao){
+		case ESC_REEMISSAO:
+		case ESC_REATRIBUICAO:
+			printf(situacao == ESC_REEMISSAO ? "[#]Reemitindo lote %llu do trabalho %llu para %s\n" : "[#]Reatribuindo lote %llu do trabalho %llu para %s\n",
+			       (unsigned long long)lote.id, (unsigned long long)t->id, cli->name);
+			if(situacao == ESC_REEMISSAO)
+				atomic_store(&t->reemitido, 1);
+			/* fall through */
+		case ESC_NOVO:
+			metricas_contar(met, situacao == ESC_REEMISSAO ? MET_LOTES_REEMITIDOS : MET_LOTES_EMITIDOS, 1);
+			if(agora > cli->ocioso_desde){ // Aguardou um lote
+				metricas_observar(met, MET_OCIOSO, agora - cli->ocioso_desde);
+				metricas_ocioso(cli->metricas, 0, agora - cli->ocioso_desde);
 			}
-		}
+			cli->com_lote = 1;
+			cli->trabalho = t;
+			cli->lote_atual = lote.id;
+			cli->ultimo_contato = cli->lote_enviado = agora;
+			envia_mensagem(cli, msg, proto_codificar_lote(msg, &lote));
+			break;
+		default: // Nenhum trabalho ativo com lotes disponíveis
+			cli->ocioso = 1;
+			metricas_ocioso(cli->metricas, 1, 0);
+			break;
 	}
+}
+
+/* Envia à conexão de submete.c o resultado do trabalho concluído */
+void envia_conclusao(client_t *cli){
+	uint8_t msg[PROTO_TAM_MAX];
+	mc_resultado_t r = escalonador_resultado(cli->submetido->esc);
+	mc_estimativa_t est = escalonador_estimar(cli->submetido->esc, cli->submetido->confianca);
 
-	pthread_mutex_unlock(&clients_mutex);
+	envia_mensagem(cli, msg, proto_codificar_conclusao(msg, cli->submetido->id, &r, &est));
+	trabalho_liberar(cli->submetido);
+	cli->submetido = NULL;
 }
 
-/* Responsabiliza-se por toda a comunicação com o cliente */
-void *handle_client(void *arg){
-	char buff_out[BUFFER_SZ];
-	char name[32];
-	int leave_flag = 0;
+/* Detecta o fim do trabalho (último lote ou erro alvo atingido): somente o primeiro reator que o percebe
+exibe o valor final de PI; o próximo trabalho da fila se torna ativo e todos os reatores são avisados
+(clientes ociosos recebem lotes e quem submeteu o trabalho recebe o resultado) */
+void verifica_fim(trabalho_t *t){
+	if(!fila_encerrar(fila, t))
+		return;
+
+	exibe_resultado(t);
+	if(ckpt.arquivo && t == trabalho_inicial)
+		grava_checkpoint();
+	avisa_reatores();
+}
+
+/* Inicia o cálculo: todos os clientes aguardados se conectaram. Cada reator entrega os lotes aos seus clientes */
+void inicia_calculo(){
+	printf("\n[#]Número de clientes alcançado!\n[#]Enviando tarefas...\n");
+	if(trabalho_inicial)
+		printf("[#]%llu lotes\n\n", (unsigned long long)escalonador_num_lotes(trabalho_inicial->esc));
+	relogio_inicio = ultima_estimativa = ultimo_checkpoint = mc_relogio();
+	atomic_store(&iniciado, 1);
+
+	avisa_reatores();
+	if(trabalho_inicial)
+		verifica_fim(trabalho_inicial); // Checkpoint de um trabalho já concluído
+}
+
+/* Atende os avisos de outros reatores: entrega lotes aos clientes registrados que estão sem lote
+(antes do início ou ociosos) e os resultados dos trabalhos concluídos a quem os submeteu. As cópias de
+lotes concluídos em outro reator deixam de contar na estimativa parcial */
+void atende_aviso(reator_t *r){
+	uint64_t avisos;
+	mc_resultado_t zero = {0, 0};
+	if(read(r->avisofd, &avisos, sizeof(avisos)) < 0)
+		return;
+
+	for(size_t i=0; i<r->clients_n; i++){
+		client_t *cli = r->clients[i];
+		if(cli->com_lote && escalonador_concluido(cli->trabalho->esc, cli->lote_atual))
+			define_parcial(cli, zero);
+		if(cli->submetido && atomic_load(&cli->submetido->concluido))
+			envia_conclusao(cli);
+		else if(cli->registrado && atomic_load(&iniciado) && !cli->com_lote)
+			envia_lote(cli);
+	}
+}
 
-	cli_count++;
-	client_t *cli = (client_t *)arg;
+/* Cria o trabalho recebido de submete.c. Retorna -1 se a submissão é inválida */
+int submete_trabalho(client_t *cli, const submissao_t *s){
+	uint8_t msg[PROTO_TAM_MAX];
+	uint64_t n_pontos = s->n_pontos;
+
+	if(cli->registrado || cli->submetido) // Uma submissão por conexão, e nunca de um cliente que calcula
+		return -1;
+	if(n_pontos == 0 && s->erro_alvo > 0)
+		n_pontos = QTD_PONTOS_ALVO;
+	if(n_pontos == 0 || !(s->erro_alvo >= 0) || !(s->confianca > 0 && s->confianca < 1) || s->prioridade < 1 || s->estimador > MC_CONTROLE){
+		printf("Submissão inválida\n");
+		return -1;
+	}
 
-	// Recebe o nome do cliente
-	if(recv(cli->sockfd, name, 32, 0) <= 0 || strlen(name) <  2 || strlen(name) >= 32-1){
+	uint64_t semente = (uint64_t)time(NULL) + atomic_fetch_add(&submissoes, 1);
+	escalonador_t *esc = escalonador_criar(n_pontos, semente, s->blocos_por_lote ? s->blocos_por_lote : blocos_por_lote, (mc_estimador_t)s->estimador);
+	if(!esc)
+		return -1;
+	if(s->erro_alvo > 0)
+		escalonador_definir_alvo(esc, s->erro_alvo, s->confianca);
+	trabalho_t *t = fila_submeter(fila, esc, s->prioridade, s->confianca);
+	if(!t){
+		escalonador_destruir(esc);
+		return -1;
+	}
+
+	cli->submetido = t;
+	printf("[#]Trabalho %llu submetido: %llu pontos, prioridade %llu, %zu na fila de espera\n", (unsigned long long)t->id,
+	       (unsigned long long)n_pontos, (unsigned long long)t->prioridade, fila_espera(fila));
+	envia_mensagem(cli, msg, proto_codificar_aceito(msg, t->id, semente));
+	avisa_reatores(); // Clientes ociosos recebem lotes do novo trabalho
+	return 0;
+}
+
+/* Registra o cliente com o nome recebido. Retorna -1 se o nome é inválido */
+int registra_cliente(client_t *cli, const char *nome){
+	if(cli->registrado)
+		return 0;
+	if(strlen(nome) < 2){
 		printf("O nome não foi inserido.\n");
-		leave_flag = 1;
-	} else{
-		strcpy(cli->name, name);
-		sprintf(buff_out, "%s conectou-se\n", cli->name);
-		printf("%s", buff_out);
+		return -1;
 	}
 
-	bzero(buff_out, BUFFER_SZ);
+	strcpy(cli->name, nome);
+	cli->registrado = 1;
+	cli->metricas = metricas_registrar(cli->name, cli->uid);
+	unsigned int registrados = atomic_fetch_add(&cli_count, 1) + 1;
+	printf(cli->canal ? "%s conectou-se (memória compartilhada)\n" : "%s conectou-se\n", cli->name);
+
+	/* Verifica se todos os clientes aguardados se conectaram; clientes que chegam depois recebem lotes imediatamente */
+	int nao_iniciado = 0;
+	if(atomic_load(&iniciado))
+		envia_lote(cli);
+	else if(registrados >= (unsigned int)num_clients && atomic_compare_exchange_strong(&iniciado, &nao_iniciado, 2)) // 2: iniciando
+		inicia_calculo();
+
+	return 0;
+}
+
+/* Métricas do lote concluído pelo cliente: latência desde o envio, vazão e o RTT atual da conexão */
+void registra_conclusao(client_t *cli, uint64_t pontos){
+	met_fatia_t *met = cli->reator->metricas;
+	double latencia = mc_relogio() - cli->lote_enviado;
+	struct tcp_info info;
+	socklen_t n = sizeof(info);
+
+	metricas_contar(met, MET_LOTES_CONCLUIDOS, 1);
+	metricas_contar(met, MET_PONTOS, pontos);
+	metricas_observar(met, MET_LATENCIA_LOTE, latencia);
+	metricas_lote(cli->metricas, pontos, latencia);
+	if(getsockopt(cli->sockfd, IPPROTO_TCP, TCP_INFO, &info, &n) == 0)
+		metricas_observar(met, MET_RTT, info.tcpi_rtt/1e6);
+}
+
+/* Trata uma mensagem do cliente. Retorna -1 se a conexão deve ser encerrada */
+int trata_mensagem(client_t *cli, proto_msg_t *msg){
+	switch(msg->tipo){
+		case PROTO_REGISTRO:
+			return cli->submetido ? -1 : registra_cliente(cli, msg->nome);
+		case PROTO_SUBMISSAO:
+			return submete_trabalho(cli, &msg->submissao);
+		case PROTO_PARCIAL: // Progresso do lote em andamento, usado somente na estimativa parcial (ignorado depois que outra cópia o concluiu)
+			if(cli->registrado && cli->com_lote && msg->id == cli->lote_atual && msg->resultado.dentro <= msg->resultado.total &&
+			   !escalonador_concluido(cli->trabalho->esc, msg->id))
+				define_parcial(cli, msg->resultado);
+			return 0;
+		case PROTO_RESULTADO:
+			break;
+		default:
+			return -1; // Mensagem que o cliente não deveria enviar
+	}
 
-	/* Verifica se todos os clientes aguardados se conectaram
-	e envia a quantidade de pontos para todos */
-	if((cli_count) == NUM_CLIENTS){
-		printf("\n[#]Número de clientes alcançado!\n[#]Enviando tarefas...\n");
-		clock_gettime(CLOCK_MONOTONIC, &tempo_inicio); // Inicia contagem do tempo
-		sprintf(buff_out, "%llu", PTS_ENVIO); // Coloca a quantidade de pontos no buffer
-		printf("[#]Enviando %s pontos para cada cliente...\n\n", buff_out);
-		send_message(buff_out, cli->sockfd); // Envia a mensagem para os clientes
+	if(!cli->registrado)
+		return -1;
+
+	/* Resultado de um lote (contagens exatas), que também é o pedido do próximo. O lote de um trabalho já
+	encerrado é descartado pelo escalonador */
+	if(cli->com_lote && msg->id == cli->lote_atual && escalonador_concluir(cli->trabalho->esc, msg->id, &msg->resultado)){
+		registra_conclusao(cli, msg->resultado.total);
+		if(intervalo <= 0) // No modo progressivo as estimativas parciais substituem o resultado de cada lote
+			printf("Trabalho %llu, lote %llu -> %s, PI = %.8f\n", (unsigned long long)cli->trabalho->id, (unsigned long long)msg->id,
+			       cli->name, 4.0*msg->resultado.dentro/msg->resultado.total);
+		reator_t *r = cli->reator;
+		mc_resultado_t zero = {0, 0};
+		for(size_t i=0; i<r->clients_n; i++){ // Cópias do lote em outros clientes do reator deixam de contar na estimativa parcial
+			client_t *outro = r->clients[i];
+			if(outro != cli && outro->com_lote && outro->trabalho == cli->trabalho && outro->lote_atual == msg->id)
+				define_parcial(outro, zero);
+		}
+		if(n_reatores > 1 && atomic_load(&cli->trabalho->reemitido)) // Cópias em clientes dos outros reatores (atende_aviso)
+			avisa_reatores();
+		verifica_fim(cli->trabalho);
+	} else{
+		metricas_contar(cli->reator->metricas, MET_LOTES_DESCARTADOS, 1);
 	}
 
-	bzero(buff_out, BUFFER_SZ);
+	envia_lote(cli); // Próximo lote, ou ocioso até haver lotes disponíveis
+	return 0;
+}
 
-	while(1){
-		if (leave_flag){
-			break; // Termina o processo
-		}
-
-		/* Recebe o valor de PI calculado pelo cliente */
-		int receive = recv(cli->sockfd, buff_out, BUFFER_SZ, 0);
-		if (receive > 0){
-			if(strlen(buff_out) > 0){ // Verifica se está chegando dados
-				printf("%s -> %s\n", buff_out, cli->name);
-				float pi = atof(buff_out); // Converte o PI string para float
-				cont++;
-				media_pi(pi); // Chamada da função para cálculo da média do PI
-			}
-		} 
-		/* Verifica se o cliente resolveu sair com "exit" */
-		else if (receive == 0 || strcmp(buff_out, "exit") == 0){ // Verifica se o cliente desejou sair com "exit"
-			sprintf(buff_out, "%s desconectou-se\n", cli->name); // Coloca mensagem de saída no buffer
-			printf("%s", buff_out); 
-			leave_flag = 1; // Sinaliza saída do cliente
-		} 
+/* Lê tudo o que estiver disponível no socket e processa as mensagens completas. Retorna -1 se o cliente saiu */
+int recebe_dados(client_t *cli){
+	proto_msg_t msg;
 
-		bzero(buff_out, BUFFER_SZ);
+	while(1){
+		size_t livre;
+		uint8_t *espaco = proto_espaco(&cli->leitor, &livre);
+		ssize_t n = cli->canal ? canal_receber(cli->canal, espaco, livre, 0) : recv(cli->sockfd, espaco, livre, 0);
+		if(n == 0)
+			return -1; // Cliente desconectou-se
+		if(n < 0){
+			if(errno == EINTR)
+				continue;
+			if(errno == EAGAIN || errno == EWOULDBLOCK)
+				return 0;
+			return -1;
+		}
+		cli->leitor.n += n;
+		cli->ultimo_contato = mc_relogio(); // Qualquer mensagem indica que o cliente está vivo: durante o lote, o PARCIAL periódico (protocolo.h)
+
+		int r;
+		while((r = proto_extrair(&cli->leitor, &msg)) > 0){
+			metricas_contar(cli->reator->metricas, MET_MENSAGENS, 1);
+			if(trata_mensagem(cli, &msg) < 0)
+				return -1;
+		}
+		if(r < 0)
+			return -1; // Quadro inválido
 	}
+}
 
-  /* Remove o cliente da fila, desliga a thread e libera recursos */
+/* Remove o cliente da lista e libera recursos. O lote em andamento volta ao escalonador e os clientes
+ociosos pedem trabalho de novo (o lote devolvido ou uma reemissão) */
+void encerra_cliente(client_t *cli){
+	int devolveu = 0;
+
+	reator_t *r = cli->reator;
+
+	if(cli->registrado){
+		printf("%s desconectou-se\n", cli->name);
+		atomic_fetch_sub(&cli_count, 1);
+	}
+	if(cli->com_lote && !atomic_load(&cli->trabalho->concluido)){
+		escalonador_abandonar(cli->trabalho->esc, cli->lote_atual);
+		devolveu = 1;
+	}
+	libera_lote(cli);
+	trabalho_liberar(cli->submetido); // Quem submeteu desistiu de aguardar; o trabalho continua
+	metricas_remover(cli->metricas);
+	epoll_ctl(r->epfd, EPOLL_CTL_DEL, cli->sockfd, NULL);
+	canal_fechar(cli->canal);
 	close(cli->sockfd);
-	queue_remove(cli->uid);
+	queue_remove(r, cli->uid);
+	free(cli->saida);
 	free(cli);
-	cli_count--;
-	pthread_detach(pthread_self());
 
-	return NULL;
+	if(devolveu)
+		avisa_reatores();
 }
 
-int main(int argc, char **argv){
-	setlocale(LC_ALL,"Portuguese");
+/* Remove os clientes que calculam um lote e não enviam nada há mais de timeout_cliente segundos */
+void verifica_clientes(reator_t *r){
+	double agora = mc_relogio();
+	r->ultima_verificacao = agora;
+
+	for(size_t i=r->clients_n; i-- > 0;){ // Do fim para o início: encerra_cliente move o último cliente para a posição i
+		client_t *cli = r->clients[i];
+		if(cli->com_lote && agora - cli->ultimo_contato > timeout_cliente){
+			printf("%s não responde há %.1f seg\n", cli->name, agora - cli->ultimo_contato);
+			metricas_contar(r->metricas, MET_TIMEOUTS, 1);
+			encerra_cliente(cli);
+		}
+	}
+}
 
-	// Execução deve ser ./Server <port>. Ex: ./Server 5000
-	if(argc != 2){
-		printf("Use: %s <porta>\n", argv[0]);
-		return EXIT_FAILURE;
+/* Aceita todas as conexões pendentes do socket TCP do reator ou, com local, do socket unix dos clientes
+locais, que recebem o canal em memória compartilhada */
+void aceita_clientes(reator_t *r, int local){
+	struct sockaddr_in cli_addr;
+	socklen_t clilen;
+
+	while(1){
+		clilen = sizeof(cli_addr);
+		int connfd = local ? accept4(canal_escuta, NULL, NULL, SOCK_NONBLOCK) : accept4(r->listenfd, (struct sockaddr*)&cli_addr, &clilen, SOCK_NONBLOCK);
+		if(connfd < 0){
+			if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				perror("ERROR: accept");
+			return;
+		}
+
+		/* Configuração do cliente */
+		client_t *cli = (client_t *)calloc(1, sizeof(client_t));
+		canal_t *canal = (cli && local) ? canal_aceitar(connfd) : NULL;
+		if(!cli || (local && !canal)){
+			free(cli);
+			close(connfd);
+			continue;
+		}
+		cli->reator = r;
+		if(!local)
+			cli->address = cli_addr;
+		cli->sockfd = connfd;
+		cli->canal = canal;
+		cli->uid = atomic_fetch_add(&uid, 1);
+
+		/* Adiciona o cliente à lista e ao epoll do reator */
+		queue_add(r, cli);
+		struct epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.ptr = cli;
+		epoll_ctl(r->epfd, EPOLL_CTL_ADD, connfd, &ev);
 	}
+}
 
-	char *ip = "127.0.0.1"; // Endereço ip do servidor, nesse caso localhost
-	int port = atoi(argv[1]); // Recebe a porta informada pelo usuário para a criação do servidor
+/* Socket de escuta de um reator. Todos usam a mesma porta (SO_REUSEPORT) e o núcleo distribui as conexões.
+Retorna -1 em caso de erro */
+int cria_socket_escuta(const char *ip, int port){
 	int option = 1;
-	int listenfd = 0, connfd = 0;
-  	struct sockaddr_in serv_addr; 
-  	struct sockaddr_in cli_addr; 
-  	pthread_t tid; //Valor que permite identificar a thread
+	struct sockaddr_in serv_addr;
 
 	/* Configurações do socket */
-	listenfd = socket(AF_INET, SOCK_STREAM, 0);
+	int listenfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if(listenfd < 0){
+		perror("ERROR: socket");
+		return -1;
+	}
+	memset(&serv_addr, 0, sizeof(serv_addr));
 	serv_addr.sin_family = AF_INET;
 	serv_addr.sin_addr.s_addr = inet_addr(ip);
 	serv_addr.sin_port = htons(port);
 
-  	/*Atribui parâmetros de comunicação para o socket */
-	if(setsockopt(listenfd, SOL_SOCKET,(SO_REUSEPORT | SO_REUSEADDR),(char*)&option,sizeof(option)) < 0){
+	/*Atribui parâmetros de comunicação para o socket */
+	if(setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, (char*)&option, sizeof(option)) < 0 ||
+	   setsockopt(listenfd, SOL_SOCKET, SO_REUSEPORT, (char*)&option, sizeof(option)) < 0){
 		perror("ERROR: setsockopt failed");
-    	return EXIT_FAILURE;
+		close(listenfd);
+		return -1;
 	}
 
 	/* Bind */
 	if(bind(listenfd, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) < 0) {
 		perror("ERROR: Socket binding failed");
-		return EXIT_FAILURE;
+		close(listenfd);
+		return -1;
 	}
 
-	printf("#=== SERVIDOR CRIADO - PORTA %d ===#\n", port);
-	printf(">Número de clientes aguardados: %d\n", NUM_CLIENTS);
-	printf(">Quantidade de pontos que serão sorteados: %llu\n\n", QTD_PONTOS);
-	puts("Aguardando conexões...\n");
-
 	/* Listen */
-	if (listen(listenfd, 10) < 0) {
+	if (listen(listenfd, SOMAXCONN) < 0) {
 		perror("ERROR: Socket listening failed");
-		return EXIT_FAILURE;
+		close(listenfd);
+		return -1;
 	}
 
-	/* Loop infinito para o servidor aceitar um pedido de conexão de um cliente e criar a thread */
+	return listenfd;
+}
+
+/* Cria o epoll do reator com o socket de escuta e o eventfd dos avisos. Retorna -1 em caso de erro */
+int cria_reator(reator_t *r, const char *ip, int port){
+	struct epoll_event ev;
+
+	r->listenfd = cria_socket_escuta(ip, port);
+	r->avisofd = eventfd(0, EFD_NONBLOCK);
+	r->epfd = epoll_create1(0);
+	if(r->listenfd < 0 || r->avisofd < 0 || r->epfd < 0){
+		perror("ERROR: epoll");
+		return -1;
+	}
+
+	ev.events = EPOLLIN;
+	ev.data.ptr = &r->listenfd; // Identifica o socket de escuta
+	epoll_ctl(r->epfd, EPOLL_CTL_ADD, r->listenfd, &ev);
+	ev.data.ptr = &r->avisofd; // Identifica o eventfd
+	epoll_ctl(r->epfd, EPOLL_CTL_ADD, r->avisofd, &ev);
+	if(canal_escuta >= 0){ // Cada conexão local acorda somente um dos reatores
+		ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+		ev.data.ptr = &canal_escuta;
+		epoll_ctl(r->epfd, EPOLL_CTL_ADD, canal_escuta, &ev);
+	}
+	return 0;
+}
+
+/* Laço de eventos do reator: aceita conexões, entrega lotes e recebe resultados sem bloquear em nenhum
+cliente. O primeiro reator também exibe as estimativas parciais e grava os checkpoints periódicos */
+void *executa_reator(void *arg){
+	reator_t *r = (reator_t *)arg;
+	int principal = (r == &reatores[0]);
+	struct epoll_event eventos[MAX_EVENTOS];
+
 	while(1){
-		socklen_t clilen = sizeof(cli_addr);
-		connfd = accept(listenfd, (struct sockaddr*)&cli_addr, &clilen);
+		int espera = -1; // Antes do início o epoll_wait aguarda somente eventos
+		if(atomic_load(&iniciado) == 1){
+			double agora = mc_relogio(), prazo = r->ultima_verificacao + INTERVALO_VERIFICACAO; // Próxima tarefa periódica
+			if(principal && intervalo > 0 && ultima_estimativa + intervalo < prazo)
+				prazo = ultima_estimativa + intervalo;
+			if(principal && ckpt.arquivo && trabalho_inicial && ultimo_checkpoint + ckpt.periodo < prazo)
+				prazo = ultimo_checkpoint + ckpt.periodo;
+			espera = (prazo > agora) ? (int)((prazo - agora)*1000) + 1 : 0;
+		}
 
-		/* Configuração do cliente */
-		client_t *cli = (client_t *)malloc(sizeof(client_t));
-		cli->address = cli_addr;
-		cli->sockfd = connfd;
-		cli->uid = uid++;
+		int n = epoll_wait(r->epfd, eventos, MAX_EVENTOS, espera);
+		if(n < 0){
+			if(errno == EINTR)
+				continue;
+			perror("ERROR: epoll_wait");
+			break;
+		}
 
-		/* Adiciona o cliente à fila e duplica a thread atual no SO*/
-		queue_add(cli);
-		pthread_create(&tid, NULL, &handle_client, (void*)cli);
+		for(int i=0; i<n; i++){
+			if(eventos[i].data.ptr == &r->listenfd || eventos[i].data.ptr == &canal_escuta){
+				aceita_clientes(r, eventos[i].data.ptr == &canal_escuta);
+				continue;
+			}
+			if(eventos[i].data.ptr == &r->avisofd){
+				atende_aviso(r);
+				continue;
+			}
 
-		/* Reduz o uso da CPU*/
-		sleep(1);
+			client_t *cli = (client_t *)eventos[i].data.ptr;
+			int sair = 0;
+			if(eventos[i].events & EPOLLIN) // Lê antes de tratar EPOLLHUP, para não perder o último resultado
+				sair = (recebe_dados(cli) < 0);
+			if(!sair && ((eventos[i].events & EPOLLOUT) || (cli->canal && cli->saida_n)))
+				sair = (envia_pendente(cli) < 0);
+			if(!sair && (eventos[i].events & (EPOLLERR | EPOLLHUP)))
+				sair = 1;
+			if(sair)
+				encerra_cliente(cli);
+		}
+
+		if(atomic_load(&iniciado) != 1)
+			continue;
+		if(principal && intervalo > 0 && mc_relogio() - ultima_estimativa >= intervalo)
+			exibe_estimativa();
+		if(principal && ckpt.arquivo && trabalho_inicial && !atomic_load(&trabalho_inicial->concluido) && mc_relogio() - ultimo_checkpoint >= ckpt.periodo)
+			grava_checkpoint();
+		if(mc_relogio() - r->ultima_verificacao >= INTERVALO_VERIFICACAO)
+			verifica_clientes(r);
 	}
 
+	return NULL;
+}
+
+int main(int argc, char **argv){
+	setlocale(LC_ALL,"Portuguese");
+
+	unsigned long long qtd_pontos = QTD_PONTOS; // Quantidade de pontos que serão sorteados (0 = sem trabalho inicial)
+	int max_ativos = FILA_MAX_ATIVOS;
+	int opt;
+
+	int tem_pontos = 0;
+
+	while((opt = getopt(argc, argv, "c:n:l:e:g:i:E:C:P:RT:t:j:M:")) != -1){
+		switch(opt){
+			case 'c': num_clients = atoi(optarg); break;
+			case 'n': qtd_pontos = strtoull(optarg, NULL, 10); tem_pontos = 1; break;
+			case 'l': blocos_por_lote = strtoull(optarg, NULL, 10); break;
+			case 'e': erro_alvo = atof(optarg); break;
+			case 'g': confianca = atof(optarg); break;
+			case 'i': intervalo = atof(optarg); break;
+			case 'E': estimador = (mc_estimador_t)mc_estimador_id(optarg); break;
+			case 'C': ckpt.arquivo = optarg; break;
+			case 'P': ckpt.periodo = atof(optarg); break;
+			case 'R': ckpt.retomar = 1; break;
+			case 'T': timeout_cliente = atof(optarg); break;
+			case 't': n_reatores = atoi(optarg); break;
+			case 'j': max_ativos = atoi(optarg); break;
+			case 'M': porta_metricas = atoi(optarg); break;
+			default: optind = argc + 1; break;
+		}
+	}
+	if(erro_alvo > 0 && !tem_pontos)
+		qtd_pontos = QTD_PONTOS_ALVO;
+
+	// Execução deve ser ./Server <port>. Ex: ./Server 5000
+	if(optind != argc - 1 || num_clients < 1 || confianca <= 0 || confianca >= 1 || (ckpt.retomar && !ckpt.arquivo) ||
+	   (ckpt.arquivo && qtd_pontos == 0 && !ckpt.retomar) || timeout_cliente <= 0 || n_reatores < 1 || max_ativos < 1 || max_ativos > FILA_LIMITE_ATIVOS || porta_metricas < 0 || (int)estimador < 0){
+		printf("Use: %s <porta> [-c clientes] [-n pontos] [-l blocos_por_lote] [-e erro_alvo] [-g confianca] [-i intervalo] [-E estimador] [-C checkpoint] [-P periodo] [-R] [-T timeout] [-t reatores] [-j trabalhos_ativos] [-M porta_metricas]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	fila = fila_criar(max_ativos);
+	if(!fila){
+		perror("ERROR: fila");
+		return EXIT_FAILURE;
+	}
+
+	/* Trabalho inicial: divide os pontos em lotes, entregues conforme os clientes pedem (ou retoma os lotes do checkpoint) */
+	unsigned long long semente = (unsigned long long)time(NULL);
+	escalonador_t *esc = NULL;
+	if(ckpt.retomar){
+		esc = escalonador_carregar(ckpt.arquivo);
+		if(!esc){
+			printf("Checkpoint inexistente ou inválido: %s\n", ckpt.arquivo);
+			return EXIT_FAILURE;
+		}
+		uint64_t n, s;
+		escalonador_parametros(esc, &n, &s, &erro_alvo, &confianca, &estimador);
+		qtd_pontos = n;
+		semente = s;
+	} else if(qtd_pontos > 0){
+		esc = escalonador_criar(qtd_pontos, semente, blocos_por_lote, estimador);
+		if(!esc){
+			perror("ERROR: escalonador");
+			return EXIT_FAILURE;
+		}
+		if(erro_alvo > 0)
+			escalonador_definir_alvo(esc, erro_alvo, confianca);
+	}
+	if(esc){
+		atomic_fetch_add(&submissoes, 1); // Os trabalhos submetidos no mesmo segundo usam outras sementes
+		trabalho_inicial = fila_submeter(fila, esc, 1, confianca); // A referência de quem submeteu fica com os checkpoints
+		if(!trabalho_inicial){
+			perror("ERROR: fila");
+			return EXIT_FAILURE;
+		}
+	}
+
+	char *ip = "127.0.0.1"; // Endereço ip do servidor, nesse caso localhost
+	int port = atoi(argv[optind]); // Recebe a porta informada pelo usuário para a criação do servidor
+
+	/* Reatores: no máximo um por núcleo */
+	long nucleos = sysconf(_SC_NPROCESSORS_ONLN);
+	if(nucleos > 0 && n_reatores > nucleos)
+		n_reatores = (int)nucleos;
+	canal_escuta = canal_escutar(port);
+	if(canal_escuta < 0)
+		fprintf(stderr, "AVISO: sem memória compartilhada (%s), os clientes locais usarão TCP\n", strerror(errno));
+	reatores = (reator_t *)calloc(n_reatores, sizeof(reator_t));
+	if(!reatores || metricas_iniciar(n_reatores) < 0){
+		perror("ERROR: malloc");
+		return EXIT_FAILURE;
+	}
+	for(int i=0; i<n_reatores; i++){
+		reatores[i].metricas = metricas_fatia(i);
+		if(cria_reator(&reatores[i], ip, port) < 0)
+			return EXIT_FAILURE;
+	}
+	if(porta_metricas && metricas_servir(ip, porta_metricas, exporta_fila) < 0){
+		perror("ERROR: métricas");
+		return EXIT_FAILURE;
+	}
+
+	printf("#=== SERVIDOR CRIADO - PORTA %d ===#\n", port);
+	printf(">Número de clientes aguardados: %d\n", num_clients);
+	printf(">Reatores: %d\n", n_reatores);
+	printf(">Trabalhos ativos: até %d\n", max_ativos);
+	if(porta_metricas)
+		printf(">Métricas: http://%s:%d/metrics\n", ip, porta_metricas);
+	if(trabalho_inicial){
+		printf(">Quantidade de pontos que serão sorteados: %llu\n", qtd_pontos);
+		if(erro_alvo > 0)
+			printf(">Erro alvo: %.3e (confiança de %.0f%%)\n", erro_alvo, 100*confianca);
+		printf(">Semente: %llu\n", semente);
+	} else{
+		printf(">Sem trabalho inicial: aguardando submissões\n");
+	}
+	if(ckpt.retomar){
+		uint64_t concluidos;
+		escalonador_andamento(esc, &concluidos);
+		printf(">Retomado do checkpoint %s: %llu de %llu lotes concluídos\n", ckpt.arquivo,
+		       (unsigned long long)concluidos, (unsigned long long)escalonador_num_lotes(esc));
+	}
+	putchar('\n');
+	puts("Aguardando conexões...\n");
+
+	/* O primeiro reator executa na thread principal */
+	for(int i=1; i<n_reatores; i++){
+		if(pthread_create(&reatores[i].thread, NULL, executa_reator, &reatores[i]) != 0){
+			perror("ERROR: pthread");
+			return EXIT_FAILURE;
+		}
+	}
+	executa_reator(&reatores[0]);
+
+	for(int i=0; i<n_reatores; i++){
+		close(reatores[i].epfd);
+		close(reatores[i].avisofd);
+		close(reatores[i].listenfd);
+	}
+	if(canal_escuta >= 0)
+		close(canal_escuta);
+	trabalho_liberar(trabalho_inicial);
+	fila_destruir(fila);
+
 	return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
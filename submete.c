@@ -0,0 +1,89 @@
+/* COMPILAÇÃO:
+gcc -O2 -pthread -o submete submete.c protocolo.c montecarlo.c topologia.c -lm
+
+EXECUÇÃO:
+./submete [port] [-n pontos] [-e erro_alvo | -d digitos] [-g confianca] [-p prioridade] [-l blocos_por_lote] [-E estimador]
+
+Submete um trabalho ao servidor (server.c), que o coloca na fila e divide os clientes conectados entre
+os trabalhos ativos, e aguarda o resultado. Com -d o erro alvo é meia unidade na casa decimal pedida
+(sem -n o servidor limita o trabalho a QTD_PONTOS_ALVO pontos); a prioridade (padrão 1) é o peso do
+trabalho na divisão dos clientes e a sua ordem na fila de espera. O estimador (padrão acerto, ver montecarlo.h)
+é usado pelos clientes em todos os lotes do trabalho, e o erro exibido é o calculado pelo servidor */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <locale.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "montecarlo.h"
+#include "protocolo.h"
+
+int main(int argc, char **argv){
+	setlocale(LC_ALL,"Portuguese");
+
+	submissao_t s = {0, 0, MC_CONFIANCA, 1, 0, MC_ACERTO};
+	int opt, estimador = MC_ACERTO;
+
+	while((opt = getopt(argc, argv, "n:e:d:g:p:l:E:")) != -1){
+		switch(opt){
+			case 'n': s.n_pontos = strtoull(optarg, NULL, 10); break;
+			case 'e': s.erro_alvo = atof(optarg); break;
+			case 'd': s.erro_alvo = 0.5*pow(10.0, -atof(optarg)); break;
+			case 'g': s.confianca = atof(optarg); break;
+			case 'p': s.prioridade = strtoull(optarg, NULL, 10); break;
+			case 'l': s.blocos_por_lote = strtoull(optarg, NULL, 10); break;
+			case 'E': estimador = mc_estimador_id(optarg); break;
+			default: optind = argc + 1; break;
+		}
+	}
+
+	// Execução deve ser ./submete <port>. Ex: ./submete 5000 -d 4
+	if(optind != argc - 1 || (s.n_pontos == 0 && s.erro_alvo <= 0) || s.erro_alvo < 0 || s.confianca <= 0 || s.confianca >= 1 || s.prioridade < 1 || estimador < 0){
+		printf("Use: %s <porta> [-n pontos] [-e erro_alvo | -d digitos] [-g confianca] [-p prioridade] [-l blocos_por_lote] [-E estimador]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	s.estimador = (uint64_t)estimador;
+
+	char *ip = "127.0.0.1"; // Endereço ip do servidor, nesse caso localhost
+	int port = atoi(argv[optind]);
+	struct sockaddr_in server_addr;
+
+	/* Configurações do socket */
+	int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+	server_addr.sin_family = AF_INET;
+	server_addr.sin_addr.s_addr = inet_addr(ip);
+	server_addr.sin_port = htons(port);
+
+	if(connect(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1){
+		printf("ERROR: connect\n");
+		return EXIT_FAILURE;
+	}
+	proto_enviar_submissao(sockfd, &s);
+
+	/* Aguarda a confirmação e depois o resultado (o servidor encerra a conexão se a submissão é inválida) */
+	proto_leitor_t leitor = {0};
+	proto_msg_t msg;
+	while(proto_ler(sockfd, &leitor, &msg) > 0){
+		if(msg.tipo == PROTO_ACEITO){
+			printf("[#]Trabalho %llu aceito (semente %llu), aguardando o resultado...\n", (unsigned long long)msg.id, (unsigned long long)msg.semente);
+			fflush(stdout);
+		} else if(msg.tipo == PROTO_CONCLUSAO){
+			mc_estimativa_t est = msg.estimativa; // Erro do estimador, calculado pelo servidor
+			est.pi = 4.0*msg.resultado.dentro/msg.resultado.total;
+			printf("[#]Pontos dentro: %llu de %llu\n", (unsigned long long)msg.resultado.dentro, (unsigned long long)msg.resultado.total);
+			printf("[#]VALOR FINAL DO PI = %.10f\n", est.pi);
+			printf("[#]Erro padrão = %.3e, intervalo de %.0f%% = ± %.3e\n", est.erro_padrao, 100*s.confianca, est.semi_intervalo);
+			close(sockfd);
+			return EXIT_SUCCESS;
+		}
+	}
+
+	printf("O servidor recusou a submissão ou desconectou-se\n");
+	close(sockfd);
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,221 @@
+/* Topologia da máquina e posicionamento das threads de cálculo (ver topologia.h) */
+
+#define _GNU_SOURCE // sched_getaffinity, pthread_setaffinity_np
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "topologia.h"
+
+#ifndef TOPO_RAIZ
+#define TOPO_RAIZ "/sys/devices/system" // -DTOPO_RAIZ=... lê uma cópia da árvore (outra máquina)
+#endif
+
+#define TOPO_MAX_NOS 1024
+
+/* CPU que o processo pode usar */
+typedef struct{
+	int cpu, no, pacote, nucleo;
+	int irmao; // Posição entre os irmãos SMT do núcleo físico (0 = primeiro)
+	int chave[5]; // Ordem da política
+} topo_cpu_t;
+
+static const char *topo_politicas[] = {"nenhuma", "compacta", "espalhada", "fisica"};
+static topo_politica_t topo_politica_atual = TOPO_NENHUMA;
+static topo_cpu_t *topo_ordem = NULL;
+static int topo_n = 0, topo_deslocamento = 0;
+static int topo_n_nos = 0, topo_n_pacotes = 0, topo_n_nucleos = 0;
+
+/* Índice da política pelo nome, ou -1 se não existe */
+int topo_politica_id(const char *nome){
+	for(int i=0; i<(int)(sizeof(topo_politicas)/sizeof(topo_politicas[0])); i++)
+		if(strcmp(nome, topo_politicas[i]) == 0)
+			return i;
+	return -1;
+}
+
+/* Lê um inteiro de um arquivo do sysfs (padrao com um %d). Retorna padrao_valor se o arquivo não existe */
+static int topo_ler_int(const char *formato, int n, int padrao_valor){
+	char caminho[256];
+	int v;
+	snprintf(caminho, sizeof(caminho), formato, n);
+	FILE *f = fopen(caminho, "r");
+	if(!f)
+		return padrao_valor;
+	if(fscanf(f, "%d", &v) != 1)
+		v = padrao_valor;
+	fclose(f);
+	return v;
+}
+
+/* Marca em no_da_cpu as CPUs de uma lista do sysfs ("0-3,8-11") */
+static void topo_ler_lista(const char *caminho, int no, int *no_da_cpu){
+	FILE *f = fopen(caminho, "r");
+	if(!f)
+		return;
+	int ini, fim;
+	char sep;
+	while(fscanf(f, "%d", &ini) == 1){
+		fim = ini;
+		if(fscanf(f, "%c", &sep) == 1 && sep == '-'){
+			if(fscanf(f, "%d", &fim) != 1)
+				break;
+			if(fscanf(f, "%c", &sep) != 1)
+				sep = '\n';
+		}
+		for(int c=ini; c<=fim && c<CPU_SETSIZE; c++)
+			if(c >= 0)
+				no_da_cpu[c] = no;
+		if(sep != ',')
+			break;
+	}
+	fclose(f);
+}
+
+static int topo_comparar(const void *a, const void *b){
+	const topo_cpu_t *x = (const topo_cpu_t *)a, *y = (const topo_cpu_t *)b;
+	for(int i=0; i<5; i++)
+		if(x->chave[i] != y->chave[i])
+			return (x->chave[i] < y->chave[i]) ? -1 : 1;
+	return 0;
+}
+
+static void topo_ordenar(void (*chave)(topo_cpu_t *c)){
+	for(int i=0; i<topo_n; i++)
+		chave(&topo_ordem[i]);
+	qsort(topo_ordem, topo_n, sizeof(topo_cpu_t), topo_comparar);
+}
+
+static void topo_chave_compacta(topo_cpu_t *c){
+	int chave[5] = {c->no, c->pacote, c->nucleo, c->cpu, 0};
+	memcpy(c->chave, chave, sizeof(chave));
+}
+
+static void topo_chave_fisica(topo_cpu_t *c){
+	int chave[5] = {c->irmao, c->no, c->pacote, c->nucleo, c->cpu};
+	memcpy(c->chave, chave, sizeof(chave));
+}
+
+/* Lê a topologia das CPUs permitidas e as ordena conforme a política. deslocamento é a posição da primeira
+thread do processo, ignorado se o processo já está restrito a parte das CPUs. Retorna -1 se a
+topologia não pode ser lida (as threads ficam sem fixação) */
+int topo_configurar(topo_politica_t politica, int deslocamento){
+	cpu_set_t permitidas;
+	static int no_da_cpu[CPU_SETSIZE];
+
+	topo_politica_atual = politica;
+	free(topo_ordem);
+	topo_ordem = NULL;
+	topo_n = topo_n_nos = topo_n_pacotes = topo_n_nucleos = 0;
+	if(politica == TOPO_NENHUMA)
+		return 0;
+
+	if(sched_getaffinity(0, sizeof(permitidas), &permitidas) != 0)
+		goto falha;
+	topo_ordem = (topo_cpu_t *)calloc(CPU_COUNT(&permitidas), sizeof(topo_cpu_t));
+	if(!topo_ordem)
+		goto falha;
+
+	/* Nó NUMA de cada CPU (sem nós no sysfs, tudo no nó 0) */
+	memset(no_da_cpu, 0, sizeof(no_da_cpu));
+	for(int no=0; no<TOPO_MAX_NOS; no++){
+		char caminho[256];
+		snprintf(caminho, sizeof(caminho), TOPO_RAIZ "/node/node%d/cpulist", no);
+		if(access(caminho, R_OK) != 0)
+			continue;
+		topo_ler_lista(caminho, no, no_da_cpu);
+		topo_n_nos++;
+	}
+	if(topo_n_nos == 0)
+		topo_n_nos = 1;
+
+	for(int c=0; c<CPU_SETSIZE; c++){
+		if(!CPU_ISSET(c, &permitidas))
+			continue;
+		topo_cpu_t *t = &topo_ordem[topo_n++];
+		t->cpu = c;
+		t->no = no_da_cpu[c];
+		t->pacote = topo_ler_int(TOPO_RAIZ "/cpu/cpu%d/topology/physical_package_id", c, 0);
+		t->nucleo = topo_ler_int(TOPO_RAIZ "/cpu/cpu%d/topology/core_id", c, c); // Sem topologia: um núcleo por CPU
+	}
+
+	/* Irmãos SMT: CPUs consecutivas do mesmo núcleo físico na ordem compacta */
+	topo_ordenar(topo_chave_compacta);
+	for(int i=0; i<topo_n; i++){
+		topo_cpu_t *t = &topo_ordem[i], *ant = (i > 0) ? &topo_ordem[i - 1] : NULL;
+		int mesmo_pacote = ant && ant->pacote == t->pacote;
+		t->irmao = (mesmo_pacote && ant->nucleo == t->nucleo) ? ant->irmao + 1 : 0;
+		topo_n_pacotes += !mesmo_pacote;
+		topo_n_nucleos += (t->irmao == 0);
+	}
+
+	if(politica == TOPO_FISICA){
+		topo_ordenar(topo_chave_fisica);
+	} else if(politica == TOPO_ESPALHADA){
+		/* Posição de cada CPU no seu nó entre as do mesmo nível SMT; os nós se alternam a cada posição */
+		topo_ordenar(topo_chave_fisica);
+		for(int i=0, k=0; i<topo_n; i++){
+			topo_cpu_t *t = &topo_ordem[i];
+			k = (i > 0 && topo_ordem[i - 1].irmao == t->irmao && topo_ordem[i - 1].no == t->no) ? k + 1 : 0;
+			int chave[5] = {t->irmao, k, t->no, t->pacote, t->nucleo};
+			memcpy(t->chave, chave, sizeof(chave));
+		}
+		qsort(topo_ordem, topo_n, sizeof(topo_cpu_t), topo_comparar);
+	}
+
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	topo_deslocamento = (online > 0 && topo_n >= online && deslocamento > 0) ? deslocamento : 0;
+	return 0;
+
+falha:
+	free(topo_ordem);
+	topo_ordem = NULL;
+	topo_n = 0;
+	topo_politica_atual = TOPO_NENHUMA;
+	return -1;
+}
+
+topo_politica_t topo_politica(void){
+	return topo_politica_atual;
+}
+
+const char *topo_politica_nome(void){
+	return topo_politicas[topo_politica_atual];
+}
+
+/* Fixa a thread atual na CPU da posição (módulo o número de CPUs). Retorna a CPU, ou -1 sem política ou se
+a fixação falhou */
+int topo_fixar(int posicao){
+	if(topo_politica_atual == TOPO_NENHUMA || topo_n == 0 || posicao < 0)
+		return -1;
+
+	int cpu = topo_ordem[(topo_deslocamento + posicao) % topo_n].cpu;
+	cpu_set_t conjunto;
+	CPU_ZERO(&conjunto);
+	CPU_SET(cpu, &conjunto);
+	return (pthread_setaffinity_np(pthread_self(), sizeof(conjunto), &conjunto) == 0) ? cpu : -1;
+}
+
+/* Aloca tam bytes zerados em páginas próprias, tocadas pela thread atual (ficam no seu nó NUMA). Liberar com free */
+void *topo_alocar_local(size_t tam){
+	long pagina = sysconf(_SC_PAGESIZE);
+	if(pagina <= 0)
+		pagina = 4096;
+	size_t arredondado = (tam + pagina - 1)/pagina*pagina;
+	void *p = aligned_alloc((size_t)pagina, arredondado ? arredondado : (size_t)pagina);
+	if(p)
+		memset(p, 0, arredondado);
+	return p;
+}
+
+/* Exibe a topologia lida e a política */
+void topo_descrever(FILE *f){
+	if(topo_politica_atual == TOPO_NENHUMA){
+		fprintf(f, "Posicionamento: nenhum (threads sem fixação)\n");
+		return;
+	}
+	fprintf(f, "Posicionamento: %s em %d CPUs (%d núcleos físicos, %d pacotes, %d nós NUMA)\n", topo_politica_nome(),
+	        topo_n, topo_n_nucleos, topo_n_pacotes, topo_n_nos);
+}
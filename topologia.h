@@ -0,0 +1,39 @@
+/* Topologia da máquina e posicionamento das threads de cálculo
+
+topo_configurar lê /sys/devices/system/cpu/cpuN/topology (pacote e núcleo de cada CPU) e
+/sys/devices/system/node/nodeK/cpulist (nó NUMA), somente das CPUs que o processo pode usar
+(sched_getaffinity, então taskset e o binding do mpirun são respeitados), e ordena as CPUs
+conforme a política:
+	nenhuma    sem fixação, o escalonador do sistema decide (padrão)
+	compacta   ordem (nó, pacote, núcleo, CPU): enche um nó antes do próximo, irmãos SMT lado a lado
+	espalhada  um por núcleo físico alternando entre os nós, depois os irmãos SMT da mesma forma
+	fisica     um por núcleo físico em ordem compacta (ignora o SMT), depois os irmãos SMT
+A thread da posição i (topo_fixar) fica na CPU i da ordem (módulo o número de CPUs), deslocada por
+topo_configurar para que vários processos da mesma máquina (ranks MPI) não dividam as mesmas CPUs.
+
+Memória local: o Linux coloca cada página no nó da thread que a toca primeiro, então cada thread
+fixada aloca e zera o seu próprio estado (topo_alocar_local, acumuladores do pool em montecarlo.c);
+o estado do gerador de cada bloco fica na pilha da própria thread. */
+
+#ifndef TOPOLOGIA_H
+#define TOPOLOGIA_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+typedef enum{
+	TOPO_NENHUMA,
+	TOPO_COMPACTA,
+	TOPO_ESPALHADA,
+	TOPO_FISICA
+} topo_politica_t;
+
+int topo_politica_id(const char *nome);
+int topo_configurar(topo_politica_t politica, int deslocamento);
+topo_politica_t topo_politica(void);
+const char *topo_politica_nome(void);
+int topo_fixar(int posicao);
+void *topo_alocar_local(size_t tam);
+void topo_descrever(FILE *f);
+
+#endif